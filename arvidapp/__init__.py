@@ -31,6 +31,7 @@ from collections import defaultdict, MutableSet
 from functools import wraps
 import re
 import atexit
+from .astcache import ASTCache
 
 __author__ = 'Dmitri Rubinstein'
 
@@ -336,44 +337,52 @@ def semantic_parents(cursor):
 _CURSOR_CACHE = {}
 
 
-class CacheEntry(object):
-    pass
-
-
 # Prevent gc problems by deleting cursor cache before clang.cindex configuration is deleted
 @atexit.register
 def clear_cache():
     _CURSOR_CACHE.clear()
 
 
+def cursor_cache_key(cursor):
+    """Declarations are identified by their USR, so cached values are shared by all
+    translation units parsed in one run, other cursors by themselves"""
+    if cursor.kind.is_declaration():
+        usr = cursor.get_usr()
+        if usr:
+            return usr
+    return cursor
+
+
 def cursor_cached(f):
     """Decorator for cached cursor access functions"""
 
-    key = f.__name__
-    if key.startswith('get_'):
-        key = key[4:]
+    name = f.__name__
+    if name.startswith('get_'):
+        name = name[4:]
 
     @wraps(f)
     def wrapper(*args, **kwargs):
         global _CURSOR_CACHE
         cursor = None
         centry = None
+        extra_args = args[1:]
         if len(args) and args[0] is not None:
             cursor = args[0]
         if not cursor:
             cursor = kwargs.get('cursor', None)
         if cursor:
-            centry = _CURSOR_CACHE.get(cursor)
-            if not centry:
-                centry = CacheEntry()
-                _CURSOR_CACHE[cursor] = centry
-            else:
-                value = getattr(centry, key, None)
-                if value is not None:
-                    return value
+            # Values depend on the other arguments as well
+            key = name
+            other_kwargs = tuple(sorted((k, v) for k, v in kwargs.items() if k != 'cursor'))
+            if extra_args or other_kwargs:
+                key = (name, extra_args, other_kwargs)
+            centry = _CURSOR_CACHE.setdefault(cursor_cache_key(cursor), {})
+            value = centry.get(key)
+            if value is not None:
+                return value
         value = f(*args, **kwargs)
-        if centry:
-            setattr(centry, key, value)
+        if centry is not None:
+            centry[key] = value
         return value
 
     return wrapper
@@ -732,15 +741,27 @@ class CursorWrapper(object):
             return CursorWrapper(c)
 
 
-def build_translation_unit(config_file_name, compiler_command_line, libpath='', resource_dir=''):
+def read_config(config_file_name, libpath='', resource_dir=''):
+    """Returns the configuration file with defaults of the options of section Main"""
     config = configparser.ConfigParser()
     config.add_section('Main')
     config.set('Main', 'libpath', libpath)
     config.set('Main', 'resource-dir', resource_dir)
+    config.set('Main', 'ast-cache', '')
     if os.path.exists(config_file_name):
         config.read(config_file_name)
+    return config
+
+
+def build_translation_unit(config_file_name, compiler_command_line, libpath='', resource_dir='', ast_cache_dir=None):
+    """Parses compiler_command_line with libclang. When ast_cache_dir is given, or the
+    ast-cache option of the configuration file is set, unchanged translation units
+    are loaded from the AST cache in that directory instead."""
+    config = read_config(config_file_name, libpath, resource_dir)
     libpath = config.get('Main', 'libpath')
     resource_dir = config.get('Main', 'resource-dir')
+    if ast_cache_dir is None:
+        ast_cache_dir = config.get('Main', 'ast-cache')
 
     if not clang.cindex.Config.loaded:
         clang.cindex.Config.set_library_path(libpath)
@@ -750,7 +771,16 @@ def build_translation_unit(config_file_name, compiler_command_line, libpath='',
     if resource_dir:
         options.extend(['-resource-dir', resource_dir])
 
-    tu = index.parse(None, options + compiler_command_line)
+    args = options + list(compiler_command_line)
+    cache = ASTCache(os.path.expanduser(ast_cache_dir)) if ast_cache_dir else None
+    if cache:
+        tu = cache.load(index, args)
+        if tu is not None:
+            return tu
+
+    tu = index.parse(None, args)
+    if cache:
+        cache.store(tu, args)
     return tu
 
 
@@ -1389,6 +1419,11 @@ class Environment(object):
                     members = cls.find_members(member_name)
                     for member in members:
                         member.add_annotation('absolute-path', path)
+                elif ca.name == 'arvida-member-packed':
+                    member_name = str(ca.params[0])
+                    members = cls.find_members(member_name)
+                    for member in members:
+                        member.add_annotation('packed', ())
                 elif ca.name == 'arvida-member-create-element':
                     member_name = str(ca.params[0])
                     name = str(ca.params[1])
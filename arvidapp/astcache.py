@@ -0,0 +1,151 @@
+#  ARVIDAPP - ARVIDA C++ Preprocessor
+#
+#  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+from __future__ import absolute_import
+from builtins import object
+import clang.cindex
+import hashlib
+import json
+import os
+import tempfile
+
+# Increment when the format of cached entries changes
+CACHE_VERSION = 1
+
+
+def clang_version():
+    try:
+        return str(clang.cindex.conf.lib.clang_getClangVersion())
+    except Exception:
+        return ''
+
+
+def file_hash(path):
+    h = hashlib.sha256()
+    with open(path, 'rb') as f:
+        for chunk in iter(lambda: f.read(1 << 16), b''):
+            h.update(chunk)
+    return h.hexdigest()
+
+
+class ASTCache(object):
+    """Translation units saved by libclang in a directory.
+
+    An entry is keyed on the libclang version, the working directory and the
+    compiler command line, and is valid while all files of the translation unit
+    have the content hashes recorded when it was saved. Files are only hashed
+    when their size or modification time changed. Headers added later in front
+    of an included file on the include path are not detected.
+    """
+
+    def __init__(self, directory):
+        self.directory = directory
+        self.hits = 0
+        self.misses = 0
+
+    def _key(self, args):
+        h = hashlib.sha256()
+        h.update(json.dumps({'version': CACHE_VERSION,
+                             'clang': clang_version(),
+                             'cwd': os.getcwd(),
+                             'args': list(args)}, sort_keys=True).encode('utf-8'))
+        return h.hexdigest()
+
+    def _paths(self, args):
+        key = self._key(args)
+        return os.path.join(self.directory, key + '.json'), os.path.join(self.directory, key + '.ast')
+
+    @staticmethod
+    def _is_unchanged(entry):
+        try:
+            st = os.stat(entry['path'])
+        except OSError:
+            return False
+        if st.st_size != entry['size']:
+            return False
+        if st.st_mtime == entry['mtime']:
+            return True
+        try:
+            return file_hash(entry['path']) == entry['sha256']
+        except (IOError, OSError):
+            return False
+
+    def load(self, index, args):
+        """Returns cached translation unit for args or None"""
+        manifest_path, ast_path = self._paths(args)
+        try:
+            with open(manifest_path, 'r') as f:
+                manifest = json.load(f)
+        except (IOError, OSError, ValueError):
+            self.misses += 1
+            return None
+
+        if manifest.get('args') != list(args) or \
+                not all(self._is_unchanged(e) for e in manifest.get('files', [])):
+            self.misses += 1
+            return None
+
+        try:
+            tu = clang.cindex.TranslationUnit.from_ast_file(ast_path, index)
+        except clang.cindex.TranslationUnitLoadError:
+            self.misses += 1
+            return None
+        self.hits += 1
+        return tu
+
+    def store(self, tu, args):
+        """Saves tu parsed from args, translation units with errors are not cached
+        since diagnostics are not restored from saved files"""
+        for diag in tu.diagnostics:
+            if diag.severity in (clang.cindex.Diagnostic.Error, clang.cindex.Diagnostic.Fatal):
+                return False
+
+        paths = set([tu.spelling])
+        for inclusion in tu.get_includes():
+            paths.add(inclusion.include.name)
+
+        files = []
+        for path in sorted(paths):
+            try:
+                st = os.stat(path)
+                files.append({'path': path, 'size': st.st_size, 'mtime': st.st_mtime,
+                              'sha256': file_hash(path)})
+            except (IOError, OSError):
+                return False
+
+        manifest_path, ast_path = self._paths(args)
+        tmp_files = []
+        try:
+            if not os.path.isdir(self.directory):
+                os.makedirs(self.directory)
+            # Write to temporary files first, concurrent runs may share the directory
+            fd, tmp_ast = tempfile.mkstemp(dir=self.directory, suffix='.ast.tmp')
+            os.close(fd)
+            tmp_files.append(tmp_ast)
+            tu.save(tmp_ast)
+            fd, tmp_manifest = tempfile.mkstemp(dir=self.directory, suffix='.json.tmp')
+            tmp_files.append(tmp_manifest)
+            with os.fdopen(fd, 'w') as f:
+                json.dump({'args': list(args), 'files': files}, f)
+            os.rename(tmp_ast, ast_path)
+            os.rename(tmp_manifest, manifest_path)
+        except (IOError, OSError, clang.cindex.TranslationUnitSaveError):
+            for path in tmp_files:
+                if os.path.exists(path):
+                    os.remove(path)
+            return False
+        return True
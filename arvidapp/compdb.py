@@ -0,0 +1,96 @@
+#  ARVIDAPP - ARVIDA C++ Preprocessor
+#
+#  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+from __future__ import absolute_import
+from builtins import object
+import json
+import os
+import shlex
+
+# Options of the compile commands that are not used for parsing, with the number of
+# arguments that follow
+IGNORED_OPTIONS = {'-c': 0, '-o': 1, '-MF': 1, '-MT': 1, '-MQ': 1, '-MD': 0, '-MMD': 0}
+
+
+def _common_prefix_length(a, b):
+    length = 0
+    for x, y in zip(a.split(os.sep), b.split(os.sep)):
+        if x != y:
+            break
+        length += 1
+    return length
+
+
+class CompilationDatabase(object):
+    """Commands of a compile_commands.json file.
+
+    Headers have usually no entry in the database, they are parsed with the command
+    of the source file that shares the longest directory prefix with the header,
+    the first one in the database wins on ties.
+    """
+
+    def __init__(self, entries):
+        self.entries = []
+        self.by_file = {}
+        for entry in entries:
+            directory = entry.get('directory', '')
+            path = os.path.realpath(os.path.join(directory, entry['file']))
+            if 'arguments' in entry:
+                arguments = list(entry['arguments'])
+            else:
+                arguments = shlex.split(entry['command'])
+            self.entries.append((path, directory, arguments))
+            self.by_file.setdefault(path, len(self.entries) - 1)
+
+    @staticmethod
+    def from_file(file_name):
+        with open(file_name, 'r') as f:
+            return CompilationDatabase(json.load(f))
+
+    def get_command(self, source_file):
+        """Returns (directory, compiler command line) for parsing source_file, or None
+        when the database is empty. The command line contains source_file but not the
+        compiler and options for output files."""
+        source_file = os.path.realpath(source_file)
+        index = self.by_file.get(source_file)
+        if index is None:
+            best = -1
+            for i, (path, directory, arguments) in enumerate(self.entries):
+                length = _common_prefix_length(os.path.dirname(path), os.path.dirname(source_file))
+                if length > best:
+                    best = length
+                    index = i
+        if index is None:
+            return None
+
+        path, directory, arguments = self.entries[index]
+        result = []
+        skip = 0
+        for arg in arguments[1:]:
+            if skip:
+                skip -= 1
+                continue
+            if arg in IGNORED_OPTIONS:
+                skip = IGNORED_OPTIONS[arg]
+                continue
+            if arg.startswith('-o') and len(arg) > 2:
+                continue
+            if not arg.startswith('-') and os.path.realpath(os.path.join(directory, arg)) == path:
+                continue
+            result.append(arg)
+        result.append(source_file)
+        return directory, result
@@ -18,8 +18,14 @@ from past.builtins import cmp
 from builtins import next
 from builtins import object
 import arvidapp
+import clang.cindex
 import itertools
+import hashlib
+import io
 import jinja2
+import jinja2.meta
+import json
+import os
 from collections import OrderedDict
 
 
@@ -132,6 +138,21 @@ def subst(str, subst_list):
     return str
 
 
+def path_segments(unquoted_path, path_subst_list=DEFAULT_PATH_SUBST_LIST):
+    """Returns list of C++ expressions of path segments, joined they form the path"""
+    segments = []
+    if unquoted_path:
+        for i in parse_inline_template(unquoted_path):
+            value = ''
+            if isinstance(i, TextValue):
+                value = arvidapp.quote_string_literal(i.value)
+            elif isinstance(i, SubstValue):
+                value = "(" + subst(i.value, path_subst_list) + ")"
+            if len(value):
+                segments.append(value)
+    return segments
+
+
 def process_path_annotation(path_annotation_list, path_subst_list=DEFAULT_PATH_SUBST_LIST):
     """Returns tuple (quoted_path, unquoted_path, preprocessed_path)"""
     paths = [normalize_annotation_value(p) for p in path_annotation_list]
@@ -139,19 +160,12 @@ def process_path_annotation(path_annotation_list, path_subst_list=DEFAULT_PATH_S
     path = arvidapp.quote_string_literal(unquoted_path) if unquoted_path else None
     pp_path = '""'
     if unquoted_path:
-        subst_list = parse_inline_template(unquoted_path)
         pp_path = ''
-        for i in subst_list:
-            value = ''
-            if isinstance(i, TextValue):
-                value = arvidapp.quote_string_literal(i.value)
-            elif isinstance(i, SubstValue):
-                value = "(" + subst(i.value, path_subst_list) + ")"
-            if len(value):
-                if len(pp_path):
-                    pp_path = 'Arvida::RDF::joinPath(%s,%s)' % (pp_path, value)
-                else:
-                    pp_path = value
+        for value in path_segments(unquoted_path, path_subst_list):
+            if len(pp_path):
+                pp_path = 'Arvida::RDF::joinPath(%s,%s)' % (pp_path, value)
+            else:
+                pp_path = value
 
     return path, unquoted_path, pp_path
 
@@ -233,6 +247,9 @@ class MemberTripleContainer(TemplateObject):
             if annot:
                 self.create_element = arvidapp.first(normalize_annotation_value(annot))
 
+        # RdfPacked / arvida_member_packed
+        self.packed = bool(member is not None and member.annotations.get('packed', None))
+
         if isinstance(self.member, arvidapp.Field) or isinstance(self.member, arvidapp.Function):
             self.getter = self.member.is_getter()
             self.setter = self.member.is_setter()
@@ -261,7 +278,9 @@ class MemberTripleContainer(TemplateObject):
     def get_setter_value_type(self):
         r = ''
         if self.is_setter():
-            if self.is_function():
+            if self.is_field():
+                r = 'decltype(value.%s)' % self.member.name
+            elif self.is_function():
                 args = self.member.cw.arguments
                 if args and len(args) > 0:
                     arg = args[0]
@@ -271,6 +290,29 @@ class MemberTripleContainer(TemplateObject):
                             r = vt.full_specialized_name
         return r
 
+    def get_setter_argument(self, name):
+        """Returns expression passing local variable name to the setter. The value is moved
+        unless the setter takes a non-const lvalue reference, rvalue reference and by value
+        arguments take ownership of the string storage that fromRDF has allocated."""
+        if self.is_function():
+            args = self.member.cw.arguments
+            if args and args[0] and args[0].type.kind == clang.cindex.TypeKind.LVALUEREFERENCE:
+                pointee = args[0].remove_reference()
+                if pointee and not pointee.is_const():
+                    return name
+        return 'std::move(%s)' % name
+
+    def get_getter_output_type(self):
+        """Returns the value type of a getter that writes the value to its only argument,
+        e.g. void getX(float &value) const, or an empty string for other getters."""
+        if self.is_getter() and self.is_function():
+            args = self.member.cw.arguments
+            if args and args[0] and args[0].type.kind == clang.cindex.TypeKind.LVALUEREFERENCE:
+                pointee = args[0].remove_reference()
+                if pointee and not pointee.is_const():
+                    return args[0].value_type.full_specialized_name
+        return ''
+
     def has_that_element_ref(self):
         for triple in self.triples:
             for i in triple:
@@ -292,6 +334,15 @@ class MemberTripleContainer(TemplateObject):
                     return True
         return False
 
+    def blanks(self):
+        # Returns BlankData of blank nodes used in the triples, ordered by index
+        result = {}
+        for triple in self.triples:
+            for i in triple:
+                if i.is_blank_node():
+                    result[i.index] = i.data
+        return [result[i] for i in sorted(result)]
+
     def is_common(self):
         # Returns True if triple is not reader/writer-specific
         return not self.is_setter() and not self.is_getter()
@@ -337,6 +388,9 @@ class MemberTripleContainer(TemplateObject):
                     has_element_ref = True
                     break
             if has_element_ref:
+                if self.packed:
+                    raise Exception('Packed member %s cannot refer to elements in triple annotation' %
+                                    self.member.name)
                 self.member_element_triples.append(triple)
             else:
                 self.member_triples.append(triple)
@@ -386,9 +440,10 @@ class TripleNode(TemplateObject):
 
 
 class BlankData(object):
-    def __init__(self, label, var_name):
+    def __init__(self, label, var_name, index):
         self.label = label
         self.var_name = var_name
+        self.index = index
 
 
 class Blank(TripleNode):
@@ -408,6 +463,10 @@ class Blank(TripleNode):
     def var_name(self):
         return self.data.var_name
 
+    @property
+    def index(self):
+        return self.data.index
+
     def __repr__(self):
         return 'Blank(%r, %r)' % (self.label, self.var_name)
 
@@ -631,9 +690,51 @@ class Triple(TemplateObject):
         return 'Triple(%r)' % (self.value,)
 
 
+class Vocabulary(object):
+    """Table of all prefixed names used in triple annotations, emitted once per generated file"""
+
+    def __init__(self, prefixes=None):
+        self.prefixes = prefixes or {}
+        self.terms = []
+        self.iris = []  # IRIs resolved at generation time, None when prefix is unknown
+        self.indices = {}
+
+    def add(self, node):
+        index = self.indices.get(node.value, None)
+        if index is None:
+            index = len(self.terms)
+            self.indices[node.value] = index
+            self.terms.append(node.value)
+            self.iris.append(self.resolve(node.value))
+        node.vocabulary = self
+        node.vocabulary_index = index
+        return index
+
+    def resolve(self, value):
+        unquoted_value = arvidapp.unquote_string_literal(value)
+        prefix, sep, local_part = unquoted_value.partition(':')
+        if not sep or prefix not in self.prefixes:
+            return None
+        return arvidapp.quote_string_literal(self.prefixes[prefix] + local_part)
+
+    @property
+    def name(self):
+        # Name depends only on the content, so tables from different generated files never clash
+        content = '\n'.join('%s %s' % (term, iri or '') for term, iri in zip(self.terms, self.iris))
+        digest = hashlib.sha1(content.encode('utf-8')).hexdigest()
+        return 'Vocabulary_%s' % (digest[:16],)
+
+    def __len__(self):
+        return len(self.terms)
+
+    def __repr__(self):
+        return 'Vocabulary(%r)' % (self.terms,)
+
+
 class TemplateProcessor(object):
-    def __init__(self, template_group):
+    def __init__(self, template_group, prefixes=None):
         self.template_group = template_group
+        self.prefixes = prefixes or {}
 
     def propagate_annotation(self, cls, annotation_name, annotation_value):
         cls_annotation_value = cls.annotations.get(annotation_name, None)
@@ -694,8 +795,9 @@ class TemplateProcessor(object):
                     cls.uid_method = uid_method
                     cls.path_type = PathType.ABSOLUTE_PATH
 
-            cls.path, cls.unquoted_path, cls.pp_path = process_path_annotation(paths,
-                                                                               [('$this', '_this'), ('$ctx', 'ctx')])
+            cls_path_subst_list = [('$this', '_this'), ('$ctx', 'ctx')]
+            cls.path, cls.unquoted_path, cls.pp_path = process_path_annotation(paths, cls_path_subst_list)
+            cls.pp_path_segments = path_segments(cls.unquoted_path, cls_path_subst_list)
 
         # Process uid-method
         for cls in environment.annotated_classes:
@@ -714,7 +816,7 @@ class TemplateProcessor(object):
             def create_blank(elem, id_gen):
                 blank_data = cls.blanks.get(elem, None)
                 if blank_data is None:
-                    blank_data = BlankData(elem, "_b%d" % (cls.blank_id,))
+                    blank_data = BlankData(elem, "_b%d" % (cls.blank_id,), cls.blank_id)
                     cls.blanks[elem] = blank_data
                     cls.blank_id += 1
                 return Blank(blank_data, id=next(id_gen))
@@ -768,24 +870,187 @@ class TemplateProcessor(object):
                 cls.has_element_refs |= len(mtc.member_element_triples) > 0
                 cls.mtcs.append(mtc)
 
+        # Collect prefixed names
+        environment.vocabulary = Vocabulary(self.prefixes)
+        for cls in environment.annotated_classes:
+            for mtc in cls.mtcs:
+                for triple in mtc.triples:
+                    for node in triple:
+                        if node.is_prefixed_name():
+                            environment.vocabulary.add(node)
+
+
+def parse_prefix_option(option):
+    """Parses NAME=IRI prefix definition, returns tuple (name, iri)"""
+    name, sep, iri = option.partition('=')
+    if not sep or not iri:
+        raise ValueError('Invalid prefix definition %r, expected NAME=IRI' % (option,))
+    return name, iri
 
-def generate_from_template(environment, template_name, template_dir):
-    loader = jinja2.FileSystemLoader(template_dir)
-    tmpl_env = jinja2.Environment(loader=loader,
-                                  keep_trailing_newline=True,  # newline-terminate generated files
-                                  lstrip_blocks=True,  # so can indent control flow tags
-                                  trim_blocks=True)  # so don't need {%- -%} everywhere
 
-    tmpl_env.tests['emptystring'] = is_emptystring
-    tmpl = tmpl_env.get_template(template_name)
+# Jinja environments by template directory, they keep compiled templates and reload
+# them when the template files change
+_TEMPLATE_ENVIRONMENTS = {}
 
-    processor = TemplateProcessor(tmpl)
+
+def get_template_environment(template_dir):
+    tmpl_env = _TEMPLATE_ENVIRONMENTS.get(template_dir)
+    if tmpl_env is None:
+        loader = jinja2.FileSystemLoader(template_dir)
+        tmpl_env = jinja2.Environment(loader=loader,
+                                      keep_trailing_newline=True,  # newline-terminate generated files
+                                      lstrip_blocks=True,  # so can indent control flow tags
+                                      trim_blocks=True)  # so don't need {%- -%} everywhere
+
+        tmpl_env.tests['emptystring'] = is_emptystring
+        _TEMPLATE_ENVIRONMENTS[template_dir] = tmpl_env
+    return tmpl_env
+
+
+# Templates that support out-of-line definitions
+SPLIT_TEMPLATES = ('sord.cpp', 'sord_table.cpp', 'redland.cpp')
+
+
+def generate_from_template(environment, template_name, template_dir, prefixes=None, delta=False,
+                           declarations_header=None):
+    """Returns generated code. With declarations_header returns a tuple of a header with
+    declarations and a source file with out-of-line definitions that includes the header
+    as declarations_header."""
+    tmpl = get_template_environment(template_dir).get_template(template_name)
+
+    processor = TemplateProcessor(tmpl, prefixes)
 
     processor.process_environment(environment)
+    # Templates emit toRDFDelta functions when set
+    environment.delta = delta
 
     main_template = tmpl.module.main
 
-    rendered = main_template(env=environment,
+    def render(split):
+        # None: inline definitions, 'declarations' or 'definitions': one of the split files
+        environment.split = split
+        environment.declarations_header = declarations_header
+        return main_template(env=environment,
                              include_files=environment.processed_files, include_file=environment.include_file)
 
-    return rendered
+    if declarations_header is None:
+        return render(None)
+    return render('declarations'), render('definitions')
+
+
+# Increment when the format of manifests changes
+MANIFEST_VERSION = 1
+
+
+def _digest(value):
+    return hashlib.sha256(json.dumps(value, sort_keys=True, default=str).encode('utf-8')).hexdigest()
+
+
+def _file_digest(path):
+    with open(path, 'rb') as f:
+        return hashlib.sha256(f.read()).hexdigest()
+
+
+def _annotations_description(annotatable):
+    return sorted((key, list(values)) for key, values in annotatable.annotations.items())
+
+
+def _type_description(type):
+    return [type.spelling, type.get_canonical().spelling]
+
+
+def _member_description(member):
+    access = getattr(member.access, 'name', str(member.access))
+    if isinstance(member, arvidapp.Field):
+        return ['field', member.name, access, _type_description(member.cursor.type),
+                _annotations_description(member)]
+    cursor = member.cursor
+    return ['function', member.name, access, _type_description(cursor.type),
+            [_type_description(arg.type) for arg in cursor.get_arguments()],
+            cursor.is_const_method(), _annotations_description(member)]
+
+
+def class_description(cls):
+    """Everything of cls that is used by templates, comments and unrelated declarations
+    in the header do not change it"""
+    return {
+        'name': cls.full_specialized_name,
+        'template': cls.is_template(),
+        'template_params': [p.name for p in cls.template_params],
+        'bases': list(cls.bases),
+        'annotated_bases': sorted(c.full_name for c in cls.annotated_base_classes),
+        'annotated_sub_classes': sorted(c.full_name for c in cls.annotated_sub_classes),
+        'annotations': _annotations_description(cls),
+        'members': [_member_description(m) for m in cls.members],
+    }
+
+
+def _template_files(template_dir, template_name):
+    """Returns paths of template_name and of all templates it imports or includes"""
+    tmpl_env = get_template_environment(template_dir)
+    names = [template_name]
+    for name in names:
+        source = tmpl_env.loader.get_source(tmpl_env, name)[0]
+        for referenced in jinja2.meta.find_referenced_templates(tmpl_env.parse(source)):
+            if referenced and referenced not in names:
+                names.append(referenced)
+    return [os.path.join(template_dir, name) for name in names]
+
+
+def fingerprint(environment, template_name, template_dir, prefixes=None, delta=False, declarations_header=None):
+    """Returns manifest of the inputs of the code generated for environment: template and
+    generator version, options, global annotations and a digest per annotated class.
+    Equal manifests produce equal code."""
+    generator_files = _template_files(template_dir, template_name) + [__file__, arvidapp.__file__]
+    classes = []
+    for cls in environment.annotated_classes:
+        location = cls.cursor.location
+        classes.append(OrderedDict([('name', cls.full_name),
+                                    ('file', location.file.name if location.file else None),
+                                    ('sha256', _digest(class_description(cls)))]))
+
+    manifest = OrderedDict()
+    manifest['version'] = MANIFEST_VERSION
+    manifest['template'] = OrderedDict([('name', template_name),
+                                        ('sha256', _digest([_file_digest(os.path.splitext(f)[0] + '.py')
+                                                            if f.endswith('.pyc') else _file_digest(f)
+                                                            for f in generator_files]))])
+    manifest['options'] = OrderedDict([('prefixes', sorted((prefixes or {}).items())), ('delta', bool(delta))])
+    if declarations_header is not None:
+        manifest['options']['declarations_header'] = declarations_header
+    manifest['globals'] = _digest([environment.includes, environment.prolog, environment.epilog])
+    manifest['classes'] = classes
+    manifest['sha256'] = _digest([manifest['template'], manifest['options'], manifest['globals'], classes])
+    return manifest
+
+
+def manifest_file_name(output_file_name):
+    return output_file_name + '.manifest.json'
+
+
+def read_manifest(output_file_name):
+    """Returns manifest written with output_file_name or None"""
+    try:
+        with io.open(manifest_file_name(output_file_name), 'r', encoding='utf-8') as f:
+            return json.load(f)
+    except (IOError, OSError, ValueError):
+        return None
+
+
+def write_if_changed(file_name, text):
+    """Writes text to file_name unless the file already contains it, so the modification
+    time of unchanged outputs is kept. Returns True when the file was written."""
+    try:
+        with io.open(file_name, 'r', encoding='utf-8', newline='') as f:
+            if f.read() == text:
+                return False
+    except (IOError, OSError, UnicodeDecodeError):
+        pass
+    with io.open(file_name, 'w', encoding='utf-8', newline='') as f:
+        f.write(text)
+    return True
+
+
+def write_manifest(output_file_name, manifest):
+    return write_if_changed(manifest_file_name(output_file_name),
+                            u'%s\n' % json.dumps(manifest, indent=2, separators=(',', ': ')))
@@ -23,24 +23,32 @@ import os.path
 import time
 import traceback
 import argparse
+import multiprocessing
+import shutil
+import tempfile
 
 import arvidapp
+import arvidapp.compdb
 import arvidapp.generator
 import clang.cindex
 
 args = None
 source_files = []
 invocation_dir = None
+config_filename = None
+template_dir = None
+prefixes = {}
+log = None
 
 
 def debug(msg):
     global args
     if args.verbose:
-        sys.stderr.write(msg + "\n")
+        write_log(msg + "\n")
 
 
 def warn(msg):
-    sys.stderr.write("%s: Warning: %s\n" % (os.path.basename(sys.argv[0]), msg))
+    write_log("%s: Warning: %s\n" % (os.path.basename(sys.argv[0]), msg))
 
 
 def error(msg):
@@ -48,6 +56,18 @@ def error(msg):
     sys.exit(1)
 
 
+def write_log(msg):
+    # Messages of translation units are collected and printed in order of the units
+    if log is not None:
+        log.append(msg)
+    else:
+        sys.stderr.write(msg)
+
+
+class UnitError(Exception):
+    pass
+
+
 def should_process_file(filename, source_files):
     global args
 
@@ -61,10 +81,220 @@ def should_process_file(filename, source_files):
              os.path.realpath(filename.name) in source_files))
 
 
+class Unit(object):
+    """Translation unit, files of processed classes are in unit_files and, when set,
+    must be owned by this unit"""
+
+    def __init__(self, index, directory, compiler_command_line, unit_files, output, definitions=None):
+        self.index = index
+        self.directory = directory
+        self.compiler_command_line = compiler_command_line
+        self.unit_files = unit_files
+        self.output = output
+        # Source file of out-of-line definitions, output only has declarations when set
+        self.definitions = definitions
+        self.owners = None
+
+    def is_owned(self, filename):
+        return self.owners is None or self.owners.get(os.path.realpath(filename.name), self.index) == self.index
+
+
+def init_worker(options, directory, config, templates, prefix_map):
+    global args
+    global invocation_dir
+    global config_filename
+    global template_dir
+    global prefixes
+    args = options
+    invocation_dir = directory
+    config_filename = config
+    template_dir = templates
+    prefixes = prefix_map
+
+
+def parse_unit(unit):
+    cwd = os.getcwd()
+    try:
+        if unit.directory:
+            os.chdir(unit.directory)
+        start = time.time()
+        trans_unit = arvidapp.build_translation_unit(config_filename, unit.compiler_command_line,
+                                                     ast_cache_dir=args.ast_cache)
+        debug("  clang parse took %.2fs" % (time.time() - start))
+    except Exception as e:
+        debug(traceback.format_exc())
+        raise UnitError("Clang failed to parse '%s': %s" % (" ".join(unit.compiler_command_line), e))
+    finally:
+        os.chdir(cwd)
+
+    errors = [diag_error for diag_error in trans_unit.diagnostics
+              if diag_error.severity in (clang.cindex.Diagnostic.Error, clang.cindex.Diagnostic.Fatal)]
+
+    if errors:
+        for diag_error in errors:
+            write_log('%s:%i:%i: error: %s\n' %
+                      (diag_error.location.file, diag_error.location.line, diag_error.location.column,
+                       diag_error.spelling))
+        raise UnitError("File '%s' failed clang's parsing and type-checking" % trans_unit.spelling)
+    return trans_unit
+
+
+def run_unit(f, unit):
+    """Calls f(unit) and returns (result, log messages, error message)"""
+    global log
+    log = []
+    try:
+        return f(unit), log, None
+    except UnitError as e:
+        return None, log, str(e)
+    finally:
+        log = None
+
+
+def included_files(unit):
+    trans_unit = parse_unit(unit)
+    files = [trans_unit.spelling]
+    files.extend(str(i.include.name) for i in trans_unit.get_includes())
+    return [os.path.realpath(f) for f in files]
+
+
+def generate_unit(unit):
+    trans_unit = parse_unit(unit)
+
+    environment = arvidapp.Environment.from_cursor(
+        trans_unit.cursor,
+        cursor_filter=lambda c: should_process_file(c.location.file, unit.unit_files) and
+                                unit.is_owned(c.location.file))
+
+    template_name = args.template + '.cpp'
+    declarations_header = None
+    if unit.definitions:
+        declarations_header = os.path.relpath(unit.output, os.path.dirname(unit.definitions) or '.')
+        declarations_header = declarations_header.replace(os.sep, '/')
+    manifest = None
+    if args.manifest and unit.output != "-":
+        manifest = arvidapp.generator.fingerprint(environment, template_name, template_dir,
+                                                  prefixes=prefixes, delta=args.delta,
+                                                  declarations_header=declarations_header)
+        previous = arvidapp.generator.read_manifest(unit.output)
+        if previous and previous.get('sha256') == manifest['sha256'] and os.path.exists(unit.output) and \
+                (not unit.definitions or os.path.exists(unit.definitions)):
+            debug("  '%s' is up to date" % unit.output)
+            return None, manifest
+
+    rendered = arvidapp.generator.generate_from_template(environment, template_name, template_dir,
+                                                         prefixes=prefixes, delta=args.delta,
+                                                         declarations_header=declarations_header)
+
+    if args.dump:
+        write_log(environment.dump() + '\n')
+    return rendered, manifest
+
+
+def run_units(f, units, jobs):
+    """Runs f on all units, results are returned in order of units"""
+    tasks = [(f, unit) for unit in units]
+    if jobs <= 1 or len(units) <= 1:
+        results = [run_unit(*task) for task in tasks]
+    else:
+        pool = multiprocessing.Pool(min(jobs, len(units)), initializer=init_worker,
+                                    initargs=(args, invocation_dir, config_filename, template_dir, prefixes))
+        try:
+            results = pool.map(run_unit_task, tasks, chunksize=1)
+        finally:
+            pool.close()
+            pool.join()
+
+    failed = False
+    for unit, (result, messages, message) in zip(units, results):
+        for msg in messages:
+            sys.stderr.write(msg)
+        if message:
+            sys.stderr.write("%s: Error: %s\n" % (os.path.basename(sys.argv[0]), message))
+            failed = True
+    if failed:
+        sys.exit(1)
+    return [result for result, messages, message in results]
+
+
+def run_unit_task(task):
+    return run_unit(*task)
+
+
+def output_name(pattern, source_file):
+    stem = os.path.splitext(os.path.basename(source_file))[0]
+    return pattern.format(stem=stem, name=os.path.basename(source_file), dir=os.path.dirname(source_file))
+
+
+def build_units():
+    if not args.compile_commands:
+        return [Unit(0, None, args.args, [os.path.realpath(x) for x in args.args], args.output, args.definitions)]
+
+    try:
+        database = arvidapp.compdb.CompilationDatabase.from_file(args.compile_commands)
+    except (IOError, OSError, ValueError, KeyError) as e:
+        error("Could not read compilation database '%s': %s" % (args.compile_commands, e))
+
+    if len(args.args) > 1 and '{' not in args.output:
+        error("Output must contain {stem}, {name} or {dir} when generating code for several source files")
+
+    units = []
+    outputs = set()
+    for source_file in args.args:
+        command = database.get_command(source_file)
+        if command is None:
+            error("No compile command for '%s' in '%s'" % (source_file, args.compile_commands))
+        try:
+            output = output_name(args.output, source_file)
+            definitions = output_name(args.definitions, source_file) if args.definitions else None
+        except (KeyError, IndexError, ValueError) as e:
+            error("Invalid output file name '%s': %s" % (args.output, e))
+        if output in outputs:
+            error("Source files '%s' and '%s' are generated to the same output file '%s'" %
+                  (units[[u.output for u in units].index(output)].unit_files[0], source_file, output))
+        outputs.add(output)
+        directory, compiler_command_line = command
+        units.append(Unit(len(units), directory, compiler_command_line, [os.path.realpath(source_file)], output,
+                          definitions))
+    return units
+
+
+def assign_owners(units):
+    """Every processed file is generated only in one unit: the unit of the source file
+    itself, otherwise the first unit in command line order that includes the file"""
+    owners = {}
+    for unit in units:
+        owners[unit.unit_files[0]] = unit.index
+    if args.all_headers or args.non_system_headers:
+        for unit, files in zip(units, run_units(included_files, units, args.jobs)):
+            for f in files:
+                owners.setdefault(f, unit.index)
+    for unit in units:
+        unit.owners = owners
+
+
+def write_output(output, rendered, manifest, definitions=None):
+    if output == "-":
+        sys.stdout.write(rendered)
+        sys.stdout.flush()
+        return
+    if rendered is not None and definitions:
+        rendered, rendered_definitions = rendered
+        if not arvidapp.generator.write_if_changed(definitions, rendered_definitions):
+            debug("  '%s' is unchanged" % definitions)
+    if rendered is not None and not arvidapp.generator.write_if_changed(output, rendered):
+        debug("  '%s' is unchanged" % output)
+    if manifest is not None:
+        arvidapp.generator.write_manifest(output, manifest)
+
+
 def main():
     global args
     global source_files
     global invocation_dir
+    global config_filename
+    global template_dir
+    global prefixes
 
     parser = argparse.ArgumentParser(
         description="Generate code from AST of C++ source code.",
@@ -72,12 +302,21 @@ def main():
               "\n%(prog)s [options] --compile-commands=<compile_commands.json>"
               " <source-file> ...")
     parser.add_argument("-t", "--template", metavar="TEMPLATE",
-                        help='select generation template (default: sord)',
+                        help='select generation template (default: sord)'
+                             ' (sord, sord_table, redland, serd or binary;'
+                             ' sord_table generates one descriptor table per'
+                             ' class for the sord traits, serd writes statements'
+                             ' directly to a SerdWriter and reads from serd'
+                             ' events without a model, binary writes and reads'
+                             ' the compact encoding of BinaryRDFTraits.hpp)',
                         default='sord')
     parser.add_argument("-f", "-o", "--output", metavar="FILE",
                         help='write dump to %(metavar)s;'
                              ' "-" writes dump to stdout'
-                             ' (default: stdout)')
+                             ' (default: stdout); with several source files'
+                             ' {stem}, {name} and {dir} are replaced by base'
+                             ' name without extension, base name and directory'
+                             ' of each source file')
     parser.add_argument("-v", "--verbose", action="store_true",
                         help="enable debugging output")
     parser.add_argument("--version", action="version",
@@ -89,63 +328,89 @@ def main():
                         help="write dump for all non-system header files encountered")
     parser.add_argument("--dump", action="store_true",
                         help="dump parsed database")
+    parser.add_argument("-p", "--prefix", metavar="NAME=IRI", action="append", default=[],
+                        help="resolve prefixed names with prefix NAME at generation time;"
+                             " unresolved prefixes are expanded at runtime")
+    parser.add_argument("--delta", action="store_true",
+                        help="also generate toRDFDelta functions that emit only statements"
+                             " changed since the previous update (sord and redland templates)")
+    parser.add_argument("--definitions", metavar="FILE",
+                        help="write out-of-line definitions to %(metavar)s and only declarations to the"
+                             " output, %(metavar)s includes the output and is compiled once (sord,"
+                             " sord_table and redland templates); {stem}, {name} and {dir} are"
+                             " replaced like in the output")
+    parser.add_argument("--ast-cache", metavar="DIR",
+                        help="reuse parsed translation units saved in DIR while the command line"
+                             " and all included files are unchanged (default: ast-cache option of"
+                             " arvidapp.cfg)")
+    parser.add_argument("--manifest", action="store_true",
+                        help="record template, options and annotated classes of each output FILE in"
+                             " FILE.manifest.json and skip generation while they are unchanged")
+    parser.add_argument("--compile-commands", metavar="FILE",
+                        help="parse source files with their commands from compilation database %(metavar)s,"
+                             " headers use the command of the nearest source file")
+    parser.add_argument("-j", "--jobs", metavar="N", type=int, default=1,
+                        help="parse and generate up to %(metavar)s translation units in parallel,"
+                             " 0 uses all processors (default: 1)")
     parser.add_argument("args", nargs="+", help=argparse.SUPPRESS)
 
     args = parser.parse_args(sys.argv[1:])
     if not args.output:
         args.output = "-"
-    args.source_files = args.args
-    source_files = [os.path.realpath(x) for x in args.source_files]
-    args.compiler_command_line = args.args
+    if args.jobs <= 0:
+        args.jobs = multiprocessing.cpu_count()
+
+    # main() is also called repeatedly by workers of the web service
+    prefixes = {}
+    for prefix_option in args.prefix:
+        try:
+            name, iri = arvidapp.generator.parse_prefix_option(prefix_option)
+        except ValueError as e:
+            error(str(e))
+        prefixes[name] = iri
 
     invocation_dir = os.getcwd()
 
     tool_dir = os.path.dirname(os.path.realpath(__file__))
 
     config_filename = os.path.join(tool_dir, 'arvidapp.cfg')
-
-    try:
-        start = time.time()
-        trans_unit = arvidapp.build_translation_unit(config_filename, args.compiler_command_line)
-        debug("  clang parse took %.2fs" % (time.time() - start))
-    except Exception as e:
-        debug(traceback.format_exc())
-        error("Clang failed to parse '%s': %s" % (" ".join(args.compiler_command_line), e))
-
-    errors = [diag_error for diag_error in trans_unit.diagnostics
-              if diag_error.severity in (clang.cindex.Diagnostic.Error, clang.cindex.Diagnostic.Fatal)]
-
-    if errors:
-        for diag_error in errors:
-            sys.stderr.write('%s:%i:%i: error: %s' %
-                             (diag_error.location.file, diag_error.location.line, diag_error.location.column, diag_error.spelling))
-            sys.stderr.write('\n')
-        error("File '%s' failed clang's parsing and type-checking" % trans_unit.spelling)
-
-    environment = arvidapp.Environment.from_cursor(
-        trans_unit.cursor,
-        cursor_filter=lambda c: should_process_file(c.location.file, source_files))
-
-    template_name = args.template + '.cpp'
     template_dir = os.path.join(tool_dir, 'templates')
 
-    rendered = arvidapp.generator.generate_from_template(environment, template_name, template_dir)
-
-    if args.dump:
-        sys.stderr.write(environment.dump() + '\n')
-
-    if args.output == "-":
-        out = sys.stdout
-    else:
-        out = open(args.output, "wb")
-
-    out.write(rendered)
-    out.flush()
-
-    if out is not sys.stdout:
-        out.close()
-    else:
-        out.flush()
+    if args.delta and args.template not in ('sord', 'redland'):
+        warn("--delta is not supported by the %s template" % args.template)
+
+    if args.definitions:
+        if args.template + '.cpp' not in arvidapp.generator.SPLIT_TEMPLATES:
+            error("--definitions is not supported by the %s template" % args.template)
+        if args.output == "-":
+            error("--definitions requires an output file")
+        if len(args.args) > 1 and args.compile_commands and '{' not in args.definitions:
+            error("Definitions must contain {stem}, {name} or {dir} when generating code for several"
+                  " source files")
+
+    # Units are parsed in their own directories, the cache must not depend on them
+    if args.ast_cache is None:
+        args.ast_cache = arvidapp.read_config(config_filename).get('Main', 'ast-cache')
+    if args.ast_cache:
+        args.ast_cache = os.path.abspath(os.path.expanduser(args.ast_cache))
+
+    units = build_units()
+    source_files = [f for unit in units for f in unit.unit_files]
+    temporary_cache = None
+    try:
+        if len(units) > 1:
+            # assign_owners parses all units before generate_unit, without an AST cache
+            # generate_unit loads them from a cache of this run instead of parsing again
+            if not args.ast_cache and (args.all_headers or args.non_system_headers):
+                temporary_cache = tempfile.mkdtemp(prefix='arvidapp-ast-')
+                args.ast_cache = temporary_cache
+            assign_owners(units)
+
+        for unit, (rendered, manifest) in zip(units, run_units(generate_unit, units, args.jobs)):
+            write_output(unit.output, rendered, manifest, unit.definitions)
+    finally:
+        if temporary_cache:
+            shutil.rmtree(temporary_cache, ignore_errors=True)
 
     return 0
 
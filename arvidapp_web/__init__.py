@@ -44,10 +44,14 @@ import datetime
 import uuid
 import subprocess
 import json
+import multiprocessing
+import threading
 from flask import Flask, request, Response, abort, jsonify, render_template, flash, redirect, url_for, \
     send_from_directory, current_app
 from flask.json import JSONEncoder
 from .flask_reverse_proxy import ReverseProxied
+from .generator_pool import GeneratorPool, GeneratorError
+from .result_cache import ResultCache, tree_digest, generator_digest, result_key
 from werkzeug.utils import secure_filename
 import mimetypes
 import logging
@@ -164,7 +168,10 @@ ARVIDAPP_ANNOTATION_HEADER = 'arvida_pp_annotation.h'
 
 POPULATE_FILES = [
     # Dest Source
+    ('include/BinaryRDFTraits.hpp', '{ARVIDAPP_INCLUDE_DIR}/BinaryRDFTraits.hpp'),
+    ('include/RDFTraitsCommon.hpp', '{ARVIDAPP_INCLUDE_DIR}/RDFTraitsCommon.hpp'),
     ('include/RedlandRDFTraits.hpp', '{ARVIDAPP_INCLUDE_DIR}/RedlandRDFTraits.hpp'),
+    ('include/SerdRDFTraits.hpp', '{ARVIDAPP_INCLUDE_DIR}/SerdRDFTraits.hpp'),
     ('include/SordRDFTraits.hpp', '{ARVIDAPP_INCLUDE_DIR}/SordRDFTraits.hpp'),
     ('include/arvida_pp_annotation.h', '{ARVIDAPP_INCLUDE_DIR}/arvida_pp_annotation.h'),
     ('include/redland.hpp', '{ARVIDAPP_INCLUDE_DIR}/redland.hpp')
@@ -205,7 +212,7 @@ class Task(object):
 
     @property
     def template_backends(self):
-        return ['sord', 'redland']
+        return ['sord', 'sord_table', 'redland', 'serd', 'binary']
 
     def get_str_id(self):
         return str(self.guid)
@@ -321,19 +328,79 @@ class Task(object):
 
 
 class Controller(object):
-    def __init__(self, upload_folder, arvidapp_include_dir, arvidapp_generator_path):
+    def __init__(self, upload_folder, arvidapp_include_dir, arvidapp_generator_path,
+                 generator_workers=0, generator_timeout=None, result_cache_size=0, logger=None):
         if not os.path.exists(upload_folder):
             os.makedirs(upload_folder)
         self.tasks = {}
         self.upload_folder = upload_folder
         self.arvidapp_include_dir = arvidapp_include_dir
         self.arvidapp_generator_path = arvidapp_generator_path
+        self.generator_workers = generator_workers
+        self.generator_timeout = generator_timeout
+        self.logger = logger
+        self._generator_pool = None
+        self._generator_pool_lock = threading.Lock()
+        self.result_cache = ResultCache(result_cache_size) if result_cache_size > 0 else None
         for name in os.listdir(self.upload_folder):
             path = os.path.join(self.upload_folder, name)
             if os.path.isdir(path):
                 task = Task(self, path)
                 self.tasks[task.get_str_id()] = task
 
+    @property
+    def generator_pool(self):
+        # Created on first use, so processes that do not serve requests start no workers
+        with self._generator_pool_lock:
+            if self._generator_pool is None and self.generator_workers > 0:
+                try:
+                    self._generator_pool = GeneratorPool(self.arvidapp_generator_path, self.generator_workers,
+                                                         timeout=self.generator_timeout, logger=self.logger)
+                except GeneratorError:
+                    if self.logger:
+                        self.logger.exception('Could not start generator workers, running generator in subprocesses')
+                    self.generator_workers = 0
+            return self._generator_pool
+
+    def run_generator(self, args, cwd):
+        """Runs generator with command line arguments args in directory cwd,
+        returns triple (returncode, stdout, stderr)"""
+        pool = self.generator_pool
+        if pool is None:
+            return run_command([self.arvidapp_generator_path] + args, env=os.environ, cwd=cwd)
+        return pool.run(args, cwd)
+
+    def preprocess(self, task, args, output_file):
+        """Runs generator for task or takes the result from the result cache, returns triple
+        (returncode, stdout, stderr). The cache key covers all files of the task except the
+        output, the command line and the generator with its templates."""
+        if self.result_cache is None:
+            return self.run_generator(args, cwd=task.file_dir)
+
+        if output_file == '-':
+            output_file = ''
+        exclude = [output_file, output_file + '.manifest.json'] if output_file else []
+        key = result_key(tree_digest(task.file_dir, exclude=exclude),
+                         generator_digest(self.arvidapp_generator_path),
+                         json.dumps(args))
+        cached = self.result_cache.get(key)
+        if cached is not None:
+            if output_file:
+                task.save_data(cached[3], output_file)
+            return cached[:3]
+
+        result = self.run_generator(args, cwd=task.file_dir)
+        # Failed runs are not cached, they may depend on the state of the server
+        if result[0] == 0:
+            output = b''
+            if output_file:
+                if not os.path.exists(task.abspath(output_file)):
+                    return result
+                with open(task.abspath(output_file), 'rb') as f:
+                    output = f.read()
+            self.result_cache.put(key, tuple(result) + (output,))
+        return result
+
     def create_task(self):
         task = Task(self)
         self.tasks[task.get_str_id()] = task
@@ -409,7 +476,13 @@ CONFIG_KEYS = {
     'UPLOAD_FOLDER': 'Directory where uploaded files will be stored',
     'MAX_CONTENT_LENGTH': 'Maximum length of the file that can be uploaded',
     'ARVIDAPP_INCLUDE_DIR': 'Path to arvidapp include directory',
-    'ARVIDAPP_GENERATOR_PATH': 'Path to arvidapp_gen.py executable'
+    'ARVIDAPP_GENERATOR_PATH': 'Path to arvidapp_gen.py executable',
+    'ARVIDAPP_GENERATOR_WORKERS': 'Number of generator processes kept running, 0 runs generator in a new '
+                                  'subprocess per request (default: number of processors)',
+    'ARVIDAPP_GENERATOR_TIMEOUT': 'Maximal duration of one generation in seconds when generator processes are '
+                                  'used (default: 300)',
+    'ARVIDAPP_RESULT_CACHE_SIZE': 'Maximal size in bytes of cached generation results, 0 disables the cache '
+                                  '(default: 67108864)'
 }
 
 DEFAULT_LOG_FILE = 'arvidapp_web.log'
@@ -500,9 +573,18 @@ def create_app(config=None, init_logger=None):
 
     # REST API
 
+    generator_workers = int(app.config.get('ARVIDAPP_GENERATOR_WORKERS', multiprocessing.cpu_count()))
+    generator_timeout = float(app.config.get('ARVIDAPP_GENERATOR_TIMEOUT', 300)) or None
+    app.logger.info('ARVIDAPP_GENERATOR_WORKERS: %d' % generator_workers)
+    result_cache_size = int(app.config.get('ARVIDAPP_RESULT_CACHE_SIZE', 64 * 1024 * 1024))
+
     controller = Controller(upload_folder=app.config['UPLOAD_FOLDER'],
                             arvidapp_include_dir=arvidapp_include_dir,
-                            arvidapp_generator_path=arvidapp_generator_path)
+                            arvidapp_generator_path=arvidapp_generator_path,
+                            generator_workers=generator_workers,
+                            generator_timeout=generator_timeout,
+                            result_cache_size=result_cache_size,
+                            logger=app.logger)
 
     # @app.before_first_request
     # def init():
@@ -648,7 +730,7 @@ def create_app(config=None, init_logger=None):
         commandline = [controller.arvidapp_generator_path] + args
         task.commandline = ' '.join(commandline)
         try:
-            task.preprocess_result = run_command(commandline, env=os.environ, cwd=task.file_dir)
+            task.preprocess_result = controller.preprocess(task, args, output_file)
         except Exception as e:
             msg = 'Could not execute command line "%s" in directory "%s"' % (task.commandline, task.file_dir)
             app.logger.exception(msg)
@@ -656,6 +738,12 @@ def create_app(config=None, init_logger=None):
         task.update_files()
         return redirect(url_for('show_task', task_id=task.get_str_id()))
 
+    @app.route("/api/result_cache", methods=['GET'])
+    def result_cache_stats():
+        if controller.result_cache is None:
+            return jsonify(enabled=False)
+        return jsonify(enabled=True, **controller.result_cache.stats())
+
     @app.route("/", methods=['GET'])
     def index():
         return render_template("index.html")
@@ -0,0 +1,237 @@
+#  ARVIDAPP - ARVIDA C++ Preprocessor
+#
+#  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+"""
+    Pool of generator processes that run arvidapp_gen.py in-process, so libclang
+    and compiled templates stay loaded between generation requests.
+"""
+
+from __future__ import absolute_import
+from future import standard_library
+standard_library.install_aliases()
+from builtins import object
+import atexit
+import multiprocessing
+import os
+import queue
+import sys
+import threading
+import traceback
+
+# Seconds to wait until a new worker has loaded the generator
+STARTUP_TIMEOUT = 60
+
+
+class GeneratorError(Exception):
+    pass
+
+
+class GeneratorTimeoutError(GeneratorError):
+    pass
+
+
+class _Capture(object):
+    """Collects output written to sys.stdout or sys.stderr as UTF-8 bytes"""
+
+    def __init__(self):
+        self.chunks = []
+
+    def write(self, s):
+        self.chunks.append(s if isinstance(s, bytes) else s.encode('utf-8'))
+
+    def flush(self):
+        pass
+
+    def getvalue(self):
+        return b''.join(self.chunks)
+
+
+def load_generator(generator_path):
+    """Imports arvidapp_gen.py from generator_path, which may have no .py extension"""
+    sys.path.insert(0, os.path.dirname(generator_path))
+    try:
+        from importlib.machinery import SourceFileLoader
+    except ImportError:
+        import imp
+        module = imp.load_source('arvidapp_gen', generator_path)
+    else:
+        module = SourceFileLoader('arvidapp_gen', generator_path).load_module()
+    # Child processes started by -j import the generator by name
+    sys.modules['arvidapp_gen'] = module
+    return module
+
+
+def run_job(module, generator_path, args, cwd):
+    """Runs main() of the generator like a subprocess, returns (returncode, stdout, stderr)"""
+    import arvidapp
+
+    saved = sys.argv, sys.stdout, sys.stderr, os.getcwd()
+    out, err = _Capture(), _Capture()
+    sys.argv = [generator_path] + list(args)
+    sys.stdout, sys.stderr = out, err
+    try:
+        os.chdir(cwd)
+        status = module.main()
+    except SystemExit as e:
+        if e.code is None or isinstance(e.code, int):
+            status = e.code or 0
+        else:
+            err.write('%s\n' % (e.code,))
+            status = 1
+    except Exception:
+        err.write(traceback.format_exc())
+        status = 1
+    finally:
+        sys.argv, sys.stdout, sys.stderr = saved[:3]
+        os.chdir(saved[3])
+        # Cached cursors keep translation units of the job alive
+        arvidapp.clear_cache()
+    return status or 0, out.getvalue(), err.getvalue()
+
+
+def worker_main(conn, generator_path):
+    try:
+        module = load_generator(generator_path)
+    except Exception:
+        conn.send(('error', traceback.format_exc()))
+        return
+    conn.send(('ready', None))
+    while True:
+        try:
+            job = conn.recv()
+        except EOFError:
+            return
+        if job is None:
+            return
+        conn.send(('result', run_job(module, generator_path, *job)))
+
+
+def _context():
+    # Forking a threaded web server is not safe, use fresh interpreters when possible
+    get_context = getattr(multiprocessing, 'get_context', None)
+    return get_context('spawn') if get_context else multiprocessing
+
+
+class _Worker(object):
+    def __init__(self, generator_path):
+        context = _context()
+        self.conn, child_conn = context.Pipe()
+        self.process = context.Process(target=worker_main, args=(child_conn, generator_path))
+        # Not a daemon, generation with -j starts child processes
+        self.process.start()
+        child_conn.close()
+        if not self.conn.poll(STARTUP_TIMEOUT):
+            self.kill()
+            raise GeneratorError('Generator worker did not start within %s seconds' % STARTUP_TIMEOUT)
+        try:
+            kind, value = self.conn.recv()
+        except EOFError:
+            kind, value = 'error', 'Generator worker exited'
+        if kind != 'ready':
+            self.kill()
+            raise GeneratorError('Could not load generator %s: %s' % (generator_path, value))
+
+    def run(self, args, cwd, timeout):
+        self.conn.send((args, cwd))
+        if not self.conn.poll(timeout):
+            raise GeneratorTimeoutError('Generation did not finish within %s seconds' % timeout)
+        try:
+            kind, value = self.conn.recv()
+        except EOFError:
+            raise GeneratorError('Generator worker exited with code %s' % self.process.exitcode)
+        return value
+
+    def stop(self):
+        try:
+            self.conn.send(None)
+        except (IOError, OSError):
+            pass
+        self.process.join(1)
+        if self.process.is_alive():
+            self.kill()
+
+    def kill(self):
+        self.process.terminate()
+        self.process.join()
+        self.conn.close()
+
+
+class GeneratorPool(object):
+    """Long-lived processes that run the generator at generator_path.
+
+    Jobs wait in a queue until one of the processes is idle. A process that exceeds
+    the timeout of a job or dies is replaced by a new one.
+    """
+
+    def __init__(self, generator_path, processes, timeout=None, logger=None):
+        self.generator_path = generator_path
+        self.timeout = timeout
+        self.logger = logger
+        self._idle = queue.Queue()
+        self._lock = threading.Lock()
+        self._workers = []
+        self._closed = False
+        for _ in range(processes):
+            self._add_worker(_Worker(generator_path))
+        atexit.register(self.close)
+
+    def _add_worker(self, worker):
+        with self._lock:
+            self._workers.append(worker)
+        self._idle.put(worker)
+
+    def _replace_worker(self, worker):
+        worker.kill()
+        with self._lock:
+            self._workers.remove(worker)
+        if self._closed:
+            return
+        try:
+            self._add_worker(_Worker(self.generator_path))
+        except GeneratorError:
+            if self.logger:
+                self.logger.exception('Could not restart generator worker')
+
+    def run(self, args, cwd):
+        """Runs generator with command line arguments args in directory cwd,
+        returns triple (returncode, stdout, stderr)"""
+        if self._closed:
+            raise GeneratorError('Generator pool is closed')
+        while True:
+            try:
+                worker = self._idle.get(timeout=1)
+                break
+            except queue.Empty:
+                with self._lock:
+                    if not self._workers:
+                        raise GeneratorError('No generator workers are running')
+        try:
+            result = worker.run(args, cwd, self.timeout)
+        except GeneratorError:
+            self._replace_worker(worker)
+            raise
+        self._idle.put(worker)
+        return result
+
+    def close(self):
+        if self._closed:
+            return
+        self._closed = True
+        with self._lock:
+            workers = list(self._workers)
+        for worker in workers:
+            worker.stop()
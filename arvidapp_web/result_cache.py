@@ -0,0 +1,120 @@
+#  ARVIDAPP - ARVIDA C++ Preprocessor
+#
+#  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+"""
+    Results of generation tasks by content of the uploaded files, template and
+    generator version.
+"""
+
+from __future__ import absolute_import
+from builtins import object
+from collections import OrderedDict
+import hashlib
+import os
+import threading
+
+
+def tree_digest(root, exclude=(), exclude_pattern=()):
+    """Returns sha256 of relative paths and contents of all files below root, paths
+    relative to root in exclude and names ending with exclude_pattern are skipped"""
+    exclude = set(os.path.normpath(p) for p in exclude)
+    exclude_pattern = tuple(exclude_pattern)
+    h = hashlib.sha256()
+    for dirpath, dirnames, filenames in os.walk(root):
+        dirnames[:] = sorted(d for d in dirnames if not d.endswith(exclude_pattern))
+        for name in sorted(filenames):
+            path = os.path.join(dirpath, name)
+            relpath = os.path.relpath(path, root)
+            if relpath in exclude or name.endswith(exclude_pattern):
+                continue
+            h.update(relpath.replace(os.sep, '/').encode('utf-8') + b'\0')
+            with open(path, 'rb') as f:
+                for chunk in iter(lambda: f.read(1 << 16), b''):
+                    h.update(chunk)
+            h.update(b'\0')
+    return h.hexdigest()
+
+
+def generator_digest(generator_path):
+    """Returns sha256 of the generator script, its Python package and templates"""
+    generator_dir = os.path.dirname(generator_path)
+    h = hashlib.sha256()
+    with open(generator_path, 'rb') as f:
+        h.update(f.read())
+    for name in ('arvidapp', 'templates'):
+        path = os.path.join(generator_dir, name)
+        if os.path.isdir(path):
+            h.update(tree_digest(path, exclude_pattern=('.pyc', '__pycache__')).encode('utf-8'))
+    return h.hexdigest()
+
+
+def result_key(*parts):
+    h = hashlib.sha256()
+    for part in parts:
+        h.update(part.encode('utf-8') + b'\0')
+    return h.hexdigest()
+
+
+class ResultCache(object):
+    """Least recently used results up to max_size bytes of output.
+
+    A result is a tuple (returncode, stdout, stderr, output) of bytes values
+    except returncode."""
+
+    def __init__(self, max_size):
+        self.max_size = max_size
+        self.size = 0
+        self.hits = 0
+        self.misses = 0
+        self.evictions = 0
+        self._entries = OrderedDict()
+        self._lock = threading.Lock()
+
+    @staticmethod
+    def _result_size(result):
+        return sum(len(value) for value in result[1:])
+
+    def get(self, key):
+        with self._lock:
+            result = self._entries.pop(key, None)
+            if result is None:
+                self.misses += 1
+                return None
+            self._entries[key] = result
+            self.hits += 1
+            return result
+
+    def put(self, key, result):
+        size = self._result_size(result)
+        if size > self.max_size:
+            return False
+        with self._lock:
+            previous = self._entries.pop(key, None)
+            if previous is not None:
+                self.size -= self._result_size(previous)
+            while self._entries and self.size + size > self.max_size:
+                _, evicted = self._entries.popitem(last=False)
+                self.size -= self._result_size(evicted)
+                self.evictions += 1
+            self._entries[key] = result
+            self.size += size
+        return True
+
+    def stats(self):
+        with self._lock:
+            return {'hits': self.hits, 'misses': self.misses, 'evictions': self.evictions,
+                    'entries': len(self._entries), 'size': self.size, 'max_size': self.max_size}
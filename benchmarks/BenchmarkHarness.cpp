@@ -0,0 +1,168 @@
+/*  ARVIDAPP - ARVIDA C++ Preprocessor
+ *
+ *  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "BenchmarkHarness.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sys/resource.h>
+
+namespace
+{
+
+std::atomic<size_t> allocations(0);
+
+} // namespace
+
+#if defined(__GLIBC__)
+
+// Interpose the malloc family, libsord and librdf allocate with malloc.
+// operator new of libstdc++ calls malloc and is counted as well.
+
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+} // extern "C"
+
+#else
+
+void *operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+#endif
+
+namespace Arvida
+{
+namespace Benchmark
+{
+
+size_t allocationCount()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+long peakResidentKiB()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+#if defined(__APPLE__)
+    // ru_maxrss is in bytes on macOS
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+bool Options::parse(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        if (std::strncmp(arg, "--min-time=", 11) == 0)
+            min_time = std::atof(arg + 11);
+        else if (std::strncmp(arg, "--sizes=", 8) == 0)
+        {
+            sizes.clear();
+            for (const char *p = arg + 8; *p; )
+            {
+                char *end;
+                const unsigned long size = std::strtoul(p, &end, 10);
+                if (end == p)
+                    return false;
+                sizes.push_back(size);
+                p = *end == ',' ? end + 1 : end;
+            }
+        }
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--min-time=SECONDS] [--sizes=N,N,...]\n", argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+Report::Report(const char *backend, const char *header)
+    : backend_(backend)
+    , header_(header)
+{
+    std::printf("backend\theader\toperation\tshape\tdepth\tobjects\titerations"
+                "\tns_per_object\tobjects_per_s\ttriples_per_s\tallocs_per_object\tpeak_rss_kib\n");
+}
+
+void Report::add(const Measurement &m)
+{
+    const double objects = static_cast<double>(m.objects) * m.iterations;
+    const double triples = static_cast<double>(m.triples) * m.iterations;
+    std::printf("%s\t%s\t%s\t%s\t%lu\t%lu\t%lu\t%.1f\t%.0f\t%.0f\t%.2f\t%ld\n",
+                backend_.c_str(), header_.c_str(), m.operation.c_str(), m.shape.c_str(),
+                static_cast<unsigned long>(m.depth), static_cast<unsigned long>(m.objects),
+                static_cast<unsigned long>(m.iterations),
+                objects > 0 ? m.seconds * 1e9 / objects : 0.0,
+                m.seconds > 0 ? objects / m.seconds : 0.0,
+                m.seconds > 0 ? triples / m.seconds : 0.0,
+                m.objects ? static_cast<double>(m.allocations) / m.objects : 0.0,
+                peakResidentKiB());
+    std::fflush(stdout);
+}
+
+} // namespace Benchmark
+} // namespace Arvida
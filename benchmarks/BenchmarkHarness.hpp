@@ -0,0 +1,153 @@
+/*  ARVIDAPP - ARVIDA C++ Preprocessor
+ *
+ *  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef ARVIDA_BENCHMARK_HARNESS_HPP_INCLUDED
+#define ARVIDA_BENCHMARK_HARNESS_HPP_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Arvida
+{
+namespace Benchmark
+{
+
+/**
+ * Number of heap allocations of the process. With glibc malloc, calloc and realloc
+ * are counted, which includes allocations of the RDF libraries, otherwise only
+ * operator new is counted.
+ */
+size_t allocationCount();
+
+// Peak resident set size of the process in KiB
+long peakResidentKiB();
+
+struct Options
+{
+    // Minimal measured time of one benchmark in seconds
+    double min_time;
+    // Numbers of objects serialized into one model
+    std::vector<size_t> sizes;
+
+    Options() : min_time(0.2), sizes({1, 10, 100, 1000, 10000}) { }
+
+    // Parses --min-time=SECONDS and --sizes=N,N,...; returns false on unknown arguments
+    bool parse(int argc, char **argv);
+};
+
+struct Measurement
+{
+    std::string operation;
+    std::string shape;
+    // Nesting depth of the serialized objects
+    size_t depth;
+    size_t objects;
+    size_t iterations;
+    double seconds;
+    size_t triples;
+    size_t allocations;
+
+    Measurement() : depth(0), objects(0), iterations(0), seconds(0), triples(0), allocations(0) { }
+};
+
+/**
+ * Prints measurements as tab separated table, one line per measurement, so results
+ * of different builds can be compared with diff or a spreadsheet.
+ */
+class Report
+{
+public:
+    Report(const char *backend, const char *header);
+
+    void add(const Measurement &measurement);
+
+private:
+    std::string backend_;
+    std::string header_;
+};
+
+/**
+ * Time of the parts of an iteration between start() and stop(), setup of the
+ * iteration is excluded. Optionally counts allocations in the same parts.
+ */
+class Stopwatch
+{
+public:
+    explicit Stopwatch(bool count_allocations = false)
+        : elapsed_(0), count_allocations_(count_allocations), allocations_(0), first_allocation_(0) { }
+
+    void start()
+    {
+        if (count_allocations_)
+            first_allocation_ = allocationCount();
+        start_ = std::chrono::steady_clock::now();
+    }
+
+    void stop()
+    {
+        elapsed_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+        if (count_allocations_)
+            allocations_ += allocationCount() - first_allocation_;
+    }
+
+    double seconds() const { return elapsed_; }
+
+    size_t allocations() const { return allocations_; }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+    double elapsed_;
+    bool count_allocations_;
+    size_t allocations_;
+    size_t first_allocation_;
+};
+
+/**
+ * Runs iteration(stopwatch) until min_time seconds were measured. iteration
+ * returns the number of triples it wrote or read. Allocations are counted in the
+ * first iteration, which is also the warm up.
+ */
+template <class F>
+Measurement measure(const Options &options, const std::string &operation, const std::string &shape,
+                    size_t depth, size_t objects, F iteration)
+{
+    Measurement result;
+    result.operation = operation;
+    result.shape = shape;
+    result.depth = depth;
+    result.objects = objects;
+
+    Stopwatch warmup(true);
+    result.triples = iteration(warmup);
+    result.allocations = warmup.allocations();
+
+    Stopwatch stopwatch;
+    do
+    {
+        iteration(stopwatch);
+        ++result.iterations;
+    } while (stopwatch.seconds() < options.min_time);
+    result.seconds = stopwatch.seconds();
+    return result;
+}
+
+} // namespace Benchmark
+} // namespace Arvida
+
+#endif
@@ -0,0 +1,61 @@
+/*  ARVIDAPP - ARVIDA C++ Preprocessor
+ *
+ *  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef ARVIDA_BENCHMARK_TEST_POSE_2_IMPL_HPP_INCLUDED
+#define ARVIDA_BENCHMARK_TEST_POSE_2_IMPL_HPP_INCLUDED
+
+// Definitions of the members declared in examples/TestPose2.h. Rotation and
+// Translation have no storage, their setters write to benchmarkSink so they are
+// not optimized away.
+
+#include "TestPose2.h"
+#include <cstddef>
+
+volatile double benchmarkSink;
+
+double Rotation::getX() const { return 0.0; }
+double Rotation::getY() const { return 0.0; }
+double Rotation::getZ() const { return 0.7071067811865476; }
+double Rotation::getW() const { return 0.7071067811865476; }
+void Rotation::setX(double x) { benchmarkSink = x; }
+void Rotation::setY(double y) { benchmarkSink = y; }
+void Rotation::setZ(double z) { benchmarkSink = z; }
+void Rotation::setW(double w) { benchmarkSink = w; }
+
+double Translation::getX() const { return 0.25; }
+double Translation::getY() const { return -1.5; }
+double Translation::getZ() const { return 1e-3; }
+void Translation::setX(double x) { benchmarkSink = x; }
+void Translation::setY(double y) { benchmarkSink = y; }
+void Translation::setZ(double z) { benchmarkSink = z; }
+
+const Translation & Pose::getTranslation() const { return _translation; }
+void Pose::setTranslation(const Translation &translation) { _translation = translation; }
+const Rotation & Pose::getRotation() const { return _rotation; }
+void Pose::setRotation(const Rotation &rotation) { _rotation = rotation; }
+
+inline Rotation makeBenchmarkRotation(size_t i)
+{
+    return Rotation();
+}
+
+inline Pose makeBenchmarkPose(size_t i)
+{
+    return Pose();
+}
+
+#endif
@@ -0,0 +1,47 @@
+/*  ARVIDAPP - ARVIDA C++ Preprocessor
+ *
+ *  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef ARVIDA_BENCHMARK_TEST_POSE_3_IMPL_HPP_INCLUDED
+#define ARVIDA_BENCHMARK_TEST_POSE_3_IMPL_HPP_INCLUDED
+
+// Definitions of the members declared in examples/TestPose3.h.
+
+#include "TestPose3.h"
+#include <cstddef>
+
+void Pose::Rotation::getX(float &value) const { value = 0.0f; }
+void Pose::Rotation::getY(float &value) const { value = 0.0f; }
+void Pose::Rotation::getZ(float &value) const { value = 0.70710677f; }
+void Pose::Rotation::getW(float &value) const { value = 0.70710677f; }
+
+void Pose::Position::getX(float &value) const { value = static_cast<float>(translation[0]); }
+void Pose::Position::getY(float &value) const { value = static_cast<float>(translation[1]); }
+void Pose::Position::getZ(float &value) const { value = static_cast<float>(translation[2]); }
+
+typedef Pose::Rotation Rotation;
+
+inline Rotation makeBenchmarkRotation(size_t i)
+{
+    return Rotation();
+}
+
+inline Pose makeBenchmarkPose(size_t i)
+{
+    return Pose();
+}
+
+#endif
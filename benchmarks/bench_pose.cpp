@@ -0,0 +1,237 @@
+/*  ARVIDAPP - ARVIDA C++ Preprocessor
+ *
+ *  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Benchmark of code generated for one of the example headers. The build defines
+// ARVIDA_BENCH_HEADER, ARVIDA_BENCH_IMPL and ARVIDA_BENCH_GENERATED as the example
+// header, the definitions of its members and the generated code, and
+// ARVIDA_BENCH_SORD or ARVIDA_BENCH_REDLAND to select the backend. ARVIDA_BENCH_TEMPLATE
+// names the template in the report.
+
+#include ARVIDA_BENCH_HEADER
+#include ARVIDA_BENCH_IMPL
+#include ARVIDA_BENCH_GENERATED
+#include "BenchmarkHarness.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+using Arvida::Benchmark::Measurement;
+using Arvida::Benchmark::Options;
+using Arvida::Benchmark::Stopwatch;
+
+namespace
+{
+
+const char BASE_URI[] = "http://example.com/benchmark";
+
+#if defined(ARVIDA_BENCH_SORD)
+
+// The Sord traits write and read std::vector at a node as core:Container, the
+// Redland traits only serialize containers as members
+#define ARVIDA_BENCH_CONTAINERS
+
+class Backend
+{
+public:
+    static const char * name() { return "sord"; }
+
+    Backend() : state_(world_) { reset(); }
+
+    void reset()
+    {
+        model_.reset();
+        model_.reset(new Sord::Model(world_, BASE_URI));
+    }
+
+    size_t triples() const { return model_->num_quads(); }
+
+    Arvida::RDF::Node uriNode(const std::string &uri) { return Sord::URI(world_, uri); }
+
+    template <class F>
+    void withContext(const std::string &path, F f)
+    {
+        Arvida::RDF::Context ctx(*model_, path, 0, 0, &state_);
+        f(ctx);
+    }
+
+private:
+    Sord::World world_;
+    std::unique_ptr<Sord::Model> model_;
+    Arvida::RDF::ContextState state_;
+};
+
+#elif defined(ARVIDA_BENCH_REDLAND)
+
+class Backend
+{
+public:
+    static const char * name() { return "redland"; }
+
+    Backend() : state_(world_, namespaces_) { reset(); }
+
+    void reset()
+    {
+        model_.reset();
+        storage_.reset();
+        storage_.reset(new Redland::Storage(world_, "memory", 0, 0));
+        model_.reset(new Redland::Model(world_, *storage_, 0));
+    }
+
+    size_t triples() const { return static_cast<size_t>(librdf_model_size(model_->c_obj())); }
+
+    Arvida::RDF::Node uriNode(const std::string &uri) { return Redland::Node::make_uri_node(world_, uri); }
+
+    template <class F>
+    void withContext(const std::string &path, F f)
+    {
+        Arvida::RDF::Context ctx(world_, namespaces_, *model_, path, 0, 0, &state_);
+        f(ctx);
+    }
+
+private:
+    Redland::World world_;
+    Redland::Namespaces namespaces_;
+    std::unique_ptr<Redland::Storage> storage_;
+    std::unique_ptr<Redland::Model> model_;
+    Arvida::RDF::ContextState state_;
+};
+
+#else
+#error "Define ARVIDA_BENCH_SORD or ARVIDA_BENCH_REDLAND"
+#endif
+
+std::string objectUri(size_t index)
+{
+    return std::string(BASE_URI) + "/" + std::to_string(index);
+}
+
+/**
+ * Serializes count objects with subjects objectUri(i) into an empty model, and
+ * reads them back from the model.
+ */
+template <class T, class Make>
+void benchmarkObjects(Arvida::Benchmark::Report &report, const Options &options, Backend &backend,
+                      const char *shape, size_t depth, size_t count, Make make)
+{
+    std::vector<T> objects;
+    std::vector<Arvida::RDF::Node> nodes;
+    objects.reserve(count);
+    nodes.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        objects.push_back(make(i));
+        nodes.push_back(backend.uriNode(objectUri(i)));
+    }
+
+    report.add(Arvida::Benchmark::measure(options, "toRDF", shape, depth, count, [&](Stopwatch &stopwatch) {
+        backend.reset();
+        stopwatch.start();
+        backend.withContext(BASE_URI, [&](const Arvida::RDF::Context &ctx) {
+            for (size_t i = 0; i < count; ++i)
+                Arvida::RDF::toRDF(ctx, nodes[i], objects[i]);
+        });
+        stopwatch.stop();
+        return backend.triples();
+    }));
+
+    backend.reset();
+    backend.withContext(BASE_URI, [&](const Arvida::RDF::Context &ctx) {
+        for (size_t i = 0; i < count; ++i)
+            Arvida::RDF::toRDF(ctx, nodes[i], objects[i]);
+    });
+    std::vector<T> values(count);
+    report.add(Arvida::Benchmark::measure(options, "fromRDF", shape, depth, count, [&](Stopwatch &stopwatch) {
+        size_t read = 0;
+        stopwatch.start();
+        backend.withContext(BASE_URI, [&](const Arvida::RDF::Context &ctx) {
+            for (size_t i = 0; i < count; ++i)
+                read += Arvida::RDF::fromRDF(ctx, nodes[i], values[i]);
+        });
+        stopwatch.stop();
+        return read == count ? backend.triples() : 0;
+    }));
+}
+
+#ifdef ARVIDA_BENCH_CONTAINERS
+
+/**
+ * Serializes count objects as one container, which adds a level of nesting, and
+ * reads the container back from the model.
+ */
+template <class T, class Make>
+void benchmarkContainer(Arvida::Benchmark::Report &report, const Options &options, Backend &backend,
+                        const char *shape, size_t depth, size_t count, Make make)
+{
+    std::vector<T> objects;
+    objects.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        objects.push_back(make(i));
+    Arvida::RDF::Node node = backend.uriNode(BASE_URI);
+
+    report.add(Arvida::Benchmark::measure(options, "toRDF", shape, depth, count, [&](Stopwatch &stopwatch) {
+        backend.reset();
+        stopwatch.start();
+        backend.withContext(BASE_URI, [&](const Arvida::RDF::Context &ctx) {
+            Arvida::RDF::toRDF(ctx, node, objects);
+        });
+        stopwatch.stop();
+        return backend.triples();
+    }));
+
+    backend.reset();
+    backend.withContext(BASE_URI, [&](const Arvida::RDF::Context &ctx) {
+        Arvida::RDF::toRDF(ctx, node, objects);
+    });
+    std::vector<T> values;
+    report.add(Arvida::Benchmark::measure(options, "fromRDF", shape, depth, count, [&](Stopwatch &stopwatch) {
+        bool read = false;
+        stopwatch.start();
+        backend.withContext(BASE_URI, [&](const Arvida::RDF::Context &ctx) {
+            read = Arvida::RDF::fromRDF(ctx, node, values);
+        });
+        stopwatch.stop();
+        return read && values.size() == count ? backend.triples() : 0;
+    }));
+}
+
+#endif
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!options.parse(argc, argv))
+        return 1;
+
+    Backend backend;
+#ifdef ARVIDA_BENCH_TEMPLATE
+    Arvida::Benchmark::Report report(ARVIDA_BENCH_TEMPLATE, ARVIDA_BENCH_HEADER);
+#else
+    Arvida::Benchmark::Report report(Backend::name(), ARVIDA_BENCH_HEADER);
+#endif
+    for (auto it = options.sizes.begin(); it != options.sizes.end(); ++it)
+    {
+        benchmarkObjects<Rotation>(report, options, backend, "Rotation", 1, *it, makeBenchmarkRotation);
+        benchmarkObjects<Pose>(report, options, backend, "Pose", 2, *it, makeBenchmarkPose);
+#ifdef ARVIDA_BENCH_CONTAINERS
+        benchmarkContainer<Pose>(report, options, backend, "vector<Pose>", 3, *it, makeBenchmarkPose);
+#endif
+    }
+    return 0;
+}
@@ -100,7 +100,7 @@ Pose
 public:
     RdfPath("/transl")
     RdfStmt($this, "spatial:translation", $that)
-    const Translation & getTranslation() ;
+    const Translation & getTranslation() const;
 
     RdfPath("/transl")
     RdfStmt($this, "spatial:translation", $that)
@@ -108,7 +108,7 @@ public:
 
     RdfPath("/rot")
     RdfStmt($this, "spatial:rotation", $that)
-    const Rotation & getRotation();
+    const Rotation & getRotation() const;
 
     RdfPath("/rot")
     RdfStmt($this, "spatial:rotation", $that)
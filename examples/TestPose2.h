@@ -49,10 +49,10 @@ class Pose
 {
 public:
 
-    const Translation & getTranslation() ;
+    const Translation & getTranslation() const;
     void setTranslation(const Translation &translation);
 
-    const Rotation & getRotation();
+    const Rotation & getRotation() const;
     void setRotation(const Rotation &rotation);
 
 private:
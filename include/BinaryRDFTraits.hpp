@@ -0,0 +1,1552 @@
+/*  ARVIDAPP - ARVIDA C++ Preprocessor
+ *
+ *  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef BINARY_RDF_TRAITS_HPP_INCLUDED
+#define BINARY_RDF_TRAITS_HPP_INCLUDED
+
+#include "RDFTraitsCommon.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <boost/any.hpp>
+
+/*
+ * Compact binary encoding of RDF triples, used between ARVIDAPP generated code.
+ *
+ * A document starts with the bytes "ARB" and the format version 1, followed by
+ * records. Each record starts with its tag byte. Lengths, term ids and integers
+ * are unsigned LEB128 varints, signed integers are zigzag encoded. Doubles and
+ * floats are raw IEEE 754 values in little endian byte order.
+ *
+ * Term records define the term with the next id, starting at 0:
+ *   TERM_URI      length, bytes
+ *   TERM_BLANK    no payload
+ *   TERM_LITERAL  datatype term id + 1 (0 = no datatype), length, bytes
+ *
+ * Statement records refer to terms by id, literal values are written inline:
+ *   TRIPLE        subject id, predicate id, object id
+ *   TRIPLE_DOUBLE subject id, predicate id, 8 bytes
+ *   TRIPLE_FLOAT  subject id, predicate id, 4 bytes
+ *   TRIPLE_SIGNED subject id, predicate id, XsdVocabulary index byte, zigzag varint
+ *   TRIPLE_UNSIGNED subject id, predicate id, XsdVocabulary index byte, varint
+ *   TRIPLE_STRING subject id, predicate id, length, bytes of an xsd:string
+ */
+
+namespace Arvida {
+namespace RDF {
+
+class Graph;
+
+enum BinaryTag
+{
+    TERM_URI = 0x01,
+    TERM_BLANK = 0x02,
+    TERM_LITERAL = 0x03,
+    TRIPLE = 0x10,
+    TRIPLE_DOUBLE = 0x11,
+    TRIPLE_FLOAT = 0x12,
+    TRIPLE_SIGNED = 0x13,
+    TRIPLE_UNSIGNED = 0x14,
+    TRIPLE_STRING = 0x15
+};
+
+static const char BINARY_MAGIC[4] = { 'A', 'R', 'B', 1 };
+
+/**
+ * Generation of an Encoder document or a decoded Graph. Nodes cache their term id
+ * together with the generation, generations are never reused.
+ */
+inline size_t nextTermTableGeneration()
+{
+    static std::atomic<size_t> counter(1);
+    return counter++;
+}
+
+/**
+ * RDF term. Numeric literals keep their binary value instead of a lexical form,
+ * nodes of a decoded Graph refer to their term in the graph.
+ */
+class Node
+{
+public:
+
+    enum Type { NOTHING, URI, BLANK, LITERAL };
+
+    // Storage of literal values
+    enum ValueType { LEXICAL, DOUBLE, FLOAT, SIGNED, UNSIGNED };
+
+    Node()
+        : type_(NOTHING), value_type_(LEXICAL), xsd_index_(XsdVocabulary::size)
+        , graph_(0), index_(0), graph_generation_(0), cache_generation_(0), cache_id_(0)
+    {
+        number_.u = 0;
+    }
+
+    static Node make_uri_node(const std::string &uri) { return Node(URI, uri); }
+
+    static Node make_blank_node(const std::string &label) { return Node(BLANK, label); }
+
+    static Node make_typed_literal_node(const std::string &value, const std::string &datatype)
+    {
+        Node node(LITERAL, value);
+        node.datatype_ = datatype;
+        return node;
+    }
+
+    static Node make_string_node(const std::string &value)
+    {
+        Node node(LITERAL, value);
+        node.xsd_index_ = XsdVocabulary::STRING;
+        return node;
+    }
+
+    static Node make_numeric_node(double value) { Node node(DOUBLE, NumericLiteral<double>::xsd_index); node.number_.d = value; return node; }
+
+    static Node make_numeric_node(float value) { Node node(FLOAT, NumericLiteral<float>::xsd_index); node.number_.f = value; return node; }
+
+    template <class T>
+    static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, Node>::type
+    make_numeric_node(T value)
+    {
+        Node node(SIGNED, NumericLiteral<T>::xsd_index);
+        node.number_.i = value;
+        return node;
+    }
+
+    template <class T>
+    static typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, Node>::type
+    make_numeric_node(T value)
+    {
+        Node node(UNSIGNED, NumericLiteral<T>::xsd_index);
+        node.number_.u = value;
+        return node;
+    }
+
+    Type type() const { return type_; }
+
+    ValueType value_type() const { return value_type_; }
+
+    bool is_valid() const { return type_ != NOTHING; }
+
+    bool is_blank() const { return type_ == BLANK; }
+
+    bool is_uri() const { return type_ == URI; }
+
+    bool is_literal() const { return type_ == LITERAL; }
+
+    // URI, blank node label or lexical form of a LEXICAL literal
+    const std::string & value() const { return value_; }
+
+    const char * to_c_string() const { return value_.c_str(); }
+
+    // XsdVocabulary index of numeric and string literals, XsdVocabulary::size otherwise
+    size_t xsd_index() const { return xsd_index_; }
+
+    std::string datatype() const
+    {
+        if (xsd_index_ < XsdVocabulary::size)
+            return XsdVocabulary::iri(xsd_index_);
+        return datatype_;
+    }
+
+    size_t lexical_form(char *buffer) const
+    {
+        switch (value_type_)
+        {
+            case DOUBLE: return formatNumericLiteral(buffer, number_.d);
+            case FLOAT: return formatNumericLiteral(buffer, number_.f);
+            case SIGNED: return formatNumericLiteral(buffer, number_.i);
+            case UNSIGNED: return formatNumericLiteral(buffer, number_.u);
+            default: break;
+        }
+        buffer[0] = '\0';
+        return 0;
+    }
+
+    std::string lexical_form() const
+    {
+        if (value_type_ == LEXICAL)
+            return value_;
+        char buffer[NUMERIC_LITERAL_BUFFER_SIZE];
+        const size_t length = lexical_form(buffer);
+        return std::string(buffer, length);
+    }
+
+    double double_value() const { return number_.d; }
+    float float_value() const { return number_.f; }
+    long long signed_value() const { return number_.i; }
+    unsigned long long unsigned_value() const { return number_.u; }
+
+    /**
+     * Stores the binary value when it is exactly representable as T, other values
+     * are read from their lexical form.
+     */
+    bool get_value(double &value) const
+    {
+        if (value_type_ == DOUBLE)
+            value = number_.d;
+        else if (value_type_ == FLOAT)
+            value = number_.f;
+        else
+            return false;
+        return true;
+    }
+
+    bool get_value(float &value) const
+    {
+        if (value_type_ != FLOAT)
+            return false;
+        value = number_.f;
+        return true;
+    }
+
+    template <class T>
+    typename std::enable_if<std::is_integral<T>::value, bool>::type
+    get_value(T &value) const
+    {
+        if (value_type_ == SIGNED)
+        {
+            if (number_.i < 0 ? !std::is_signed<T>::value || number_.i < static_cast<long long>(std::numeric_limits<T>::min())
+                              : static_cast<unsigned long long>(number_.i) > static_cast<unsigned long long>(std::numeric_limits<T>::max()))
+                return false;
+            value = static_cast<T>(number_.i);
+            return true;
+        }
+        if (value_type_ == UNSIGNED)
+        {
+            if (number_.u > static_cast<unsigned long long>(std::numeric_limits<T>::max()))
+                return false;
+            value = static_cast<T>(number_.u);
+            return true;
+        }
+        return false;
+    }
+
+    // Graph that decoded the node, it may have decoded another document since
+    const Graph * graph() const { return graph_; }
+
+    // Index in graph()->terms() of the document the node was decoded from
+    uint32_t index() const { return index_; }
+
+    bool operator==(const Node &other) const
+    {
+        if (type_ != other.type_)
+            return false;
+        if (type_ != LITERAL && graph_ && graph_ == other.graph_ && graph_generation_ == other.graph_generation_)
+            return index_ == other.index_;
+        if (type_ != LITERAL)
+            return value_ == other.value_;
+        if (value_type_ != other.value_type_ || xsd_index_ != other.xsd_index_)
+            return false;
+        switch (value_type_)
+        {
+            case DOUBLE: return number_.d == other.number_.d;
+            case FLOAT: return number_.f == other.number_.f;
+            case SIGNED: return number_.i == other.number_.i;
+            case UNSIGNED: return number_.u == other.number_.u;
+            default: return value_ == other.value_ && datatype_ == other.datatype_;
+        }
+    }
+
+    bool operator!=(const Node &other) const { return !(*this == other); }
+
+private:
+    friend class Encoder;
+    friend class Graph;
+
+    Node(Type type, const std::string &value)
+        : type_(type), value_type_(LEXICAL), xsd_index_(XsdVocabulary::size), value_(value)
+        , graph_(0), index_(0), graph_generation_(0), cache_generation_(0), cache_id_(0)
+    {
+        number_.u = 0;
+    }
+
+    Node(ValueType value_type, size_t xsd_index)
+        : type_(LITERAL), value_type_(value_type), xsd_index_(xsd_index)
+        , graph_(0), index_(0), graph_generation_(0), cache_generation_(0), cache_id_(0)
+    {
+        number_.u = 0;
+    }
+
+    Type type_;
+    ValueType value_type_;
+    size_t xsd_index_;
+    std::string value_;
+    std::string datatype_;
+    union
+    {
+        double d;
+        float f;
+        long long i;
+        unsigned long long u;
+    } number_;
+
+    const Graph *graph_;
+    uint32_t index_;
+    // Generation of graph_ that decoded the node, index_ is not valid in later ones
+    size_t graph_generation_;
+
+    // Term id in the Encoder document or Graph of generation cache_generation_
+    mutable size_t cache_generation_;
+    mutable uint32_t cache_id_;
+};
+
+typedef Node * NodePtr;
+typedef Node & NodeRef;
+typedef std::unordered_map<std::string, boost::any> Cache;
+
+struct NodeHash
+{
+    size_t operator()(const Node &node) const
+    {
+        return std::hash<std::string>()(node.value()) ^ static_cast<size_t>(node.type());
+    }
+};
+
+/**
+ * Typed cache of values per node, e.g. objects created by create_element hooks.
+ * Unlike Cache lookups do not hash strings or use boost::any_cast.
+ */
+typedef TypedCache<Node, NodeHash, std::equal_to<Node> > NodeCache;
+
+// Encoding
+
+inline void appendVarint(std::string &buffer, unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<char>(value));
+}
+
+inline void appendFixed(std::string &buffer, uint64_t bits, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        buffer.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+}
+
+/**
+ * Writes statements into a binary document, terms are written once per document
+ * and referenced by id.
+ */
+class Encoder
+{
+public:
+
+    Encoder() { begin(); }
+
+    /**
+     * Starts a new document, previously written data and the term table are discarded.
+     */
+    void begin()
+    {
+        buffer_.assign(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+        uris_.clear();
+        blanks_.clear();
+        literals_.clear();
+        next_id_ = 0;
+        generation_ = nextTermTableGeneration();
+    }
+
+    const std::string & buffer() const { return buffer_; }
+
+    const char * data() const { return buffer_.data(); }
+
+    size_t size() const { return buffer_.size(); }
+
+    bool add_statement(const Node &subject, const Node &predicate, const Node &object)
+    {
+        if (!subject.is_valid() || !predicate.is_valid() || !object.is_valid())
+            return false;
+        const uint32_t s = term(subject);
+        const uint32_t p = term(predicate);
+
+        if (object.is_literal() && (object.value_type() != Node::LEXICAL || object.xsd_index() == XsdVocabulary::STRING))
+        {
+            switch (object.value_type())
+            {
+                case Node::DOUBLE:
+                {
+                    uint64_t bits;
+                    const double value = object.double_value();
+                    std::memcpy(&bits, &value, sizeof(bits));
+                    beginStatement(TRIPLE_DOUBLE, s, p);
+                    appendFixed(buffer_, bits, 8);
+                    break;
+                }
+                case Node::FLOAT:
+                {
+                    uint32_t bits;
+                    const float value = object.float_value();
+                    std::memcpy(&bits, &value, sizeof(bits));
+                    beginStatement(TRIPLE_FLOAT, s, p);
+                    appendFixed(buffer_, bits, 4);
+                    break;
+                }
+                case Node::SIGNED:
+                {
+                    const long long value = object.signed_value();
+                    beginStatement(TRIPLE_SIGNED, s, p);
+                    buffer_.push_back(static_cast<char>(object.xsd_index()));
+                    appendVarint(buffer_, (static_cast<unsigned long long>(value) << 1) ^ static_cast<unsigned long long>(value >> 63));
+                    break;
+                }
+                case Node::UNSIGNED:
+                    beginStatement(TRIPLE_UNSIGNED, s, p);
+                    buffer_.push_back(static_cast<char>(object.xsd_index()));
+                    appendVarint(buffer_, object.unsigned_value());
+                    break;
+                case Node::LEXICAL:
+                    beginStatement(TRIPLE_STRING, s, p);
+                    appendVarint(buffer_, object.value().size());
+                    buffer_.append(object.value());
+                    break;
+            }
+            return true;
+        }
+
+        const uint32_t o = term(object);
+        beginStatement(TRIPLE, s, p);
+        appendVarint(buffer_, o);
+        return true;
+    }
+
+private:
+
+    void beginStatement(BinaryTag tag, uint32_t subject, uint32_t predicate)
+    {
+        buffer_.push_back(static_cast<char>(tag));
+        appendVarint(buffer_, subject);
+        appendVarint(buffer_, predicate);
+    }
+
+    uint32_t term(const Node &node)
+    {
+        if (node.cache_generation_ == generation_)
+            return node.cache_id_;
+
+        uint32_t id;
+        if (node.is_uri())
+            id = define(uris_, node.value(), node);
+        else if (node.is_blank())
+            id = define(blanks_, node.value(), node);
+        else
+        {
+            const std::string datatype = node.datatype();
+            const std::string lexical = node.lexical_form();
+            std::string key(datatype);
+            key.push_back('\0');
+            key.append(lexical);
+            auto it = literals_.find(key);
+            if (it != literals_.end())
+                id = it->second;
+            else
+            {
+                // The datatype term is defined before the literal
+                const uint32_t datatypeId = datatype.empty() ? 0 : term(Node::make_uri_node(datatype)) + 1;
+                id = next_id_++;
+                literals_.insert(std::make_pair(std::move(key), id));
+                buffer_.push_back(static_cast<char>(TERM_LITERAL));
+                appendVarint(buffer_, datatypeId);
+                appendVarint(buffer_, lexical.size());
+                buffer_.append(lexical);
+            }
+        }
+        node.cache_generation_ = generation_;
+        node.cache_id_ = id;
+        return id;
+    }
+
+    uint32_t define(std::unordered_map<std::string, uint32_t> &terms, const std::string &value, const Node &node)
+    {
+        auto it = terms.find(value);
+        if (it != terms.end())
+            return it->second;
+        const uint32_t id = next_id_++;
+        terms.insert(std::make_pair(value, id));
+        if (node.is_uri())
+        {
+            buffer_.push_back(static_cast<char>(TERM_URI));
+            appendVarint(buffer_, value.size());
+            buffer_.append(value);
+        }
+        else
+            buffer_.push_back(static_cast<char>(TERM_BLANK));
+        return id;
+    }
+
+    std::string buffer_;
+    std::unordered_map<std::string, uint32_t> uris_;
+    std::unordered_map<std::string, uint32_t> blanks_;
+    std::unordered_map<std::string, uint32_t> literals_;
+    uint32_t next_id_;
+    size_t generation_;
+};
+
+// Decoding
+
+/**
+ * Triples of a decoded binary document. Term ids of the document are mapped to
+ * indices of terms(), inline literals get their own terms. Statements are indexed
+ * by subject.
+ */
+class Graph
+{
+public:
+
+    struct Statement
+    {
+        uint32_t subject;
+        uint32_t predicate;
+        uint32_t object;
+    };
+
+    static const uint32_t NO_TERM = 0xffffffffU;
+
+    Graph() : generation_(nextTermTableGeneration()) { }
+
+    Graph(const Graph &) = delete;
+    Graph & operator=(const Graph &) = delete;
+
+    const std::vector<Node> & terms() const { return terms_; }
+
+    const std::vector<Statement> & statements() const { return statements_; }
+
+    /**
+     * Replaces content of the graph with the document, returns false when the
+     * document is malformed.
+     */
+    bool decode(const std::string &document)
+    {
+        return decode(document.data(), document.size());
+    }
+
+    bool decode(const char *data, size_t size)
+    {
+        clear();
+        const unsigned char *pos = reinterpret_cast<const unsigned char *>(data);
+        const unsigned char *end = pos + size;
+        if (size < sizeof(BINARY_MAGIC) || std::memcmp(pos, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0)
+            return false;
+        pos += sizeof(BINARY_MAGIC);
+
+        std::vector<uint32_t> ids;
+        while (pos != end)
+        {
+            const unsigned char tag = *pos++;
+            switch (tag)
+            {
+                case TERM_URI:
+                case TERM_LITERAL:
+                {
+                    unsigned long long datatype = 0, length = 0;
+                    if (tag == TERM_LITERAL && (!readVarint(pos, end, datatype) || datatype > ids.size()))
+                        return fail();
+                    if (!readVarint(pos, end, length) || length > static_cast<size_t>(end - pos))
+                        return fail();
+                    Node node(tag == TERM_URI ? Node::URI : Node::LITERAL,
+                              std::string(reinterpret_cast<const char *>(pos), length));
+                    pos += length;
+                    if (datatype)
+                        node.datatype_ = terms_[ids[datatype - 1]].value_;
+                    ids.push_back(addTerm(std::move(node)));
+                    break;
+                }
+                case TERM_BLANK:
+                {
+                    char label[32];
+                    const int length = std::snprintf(label, sizeof(label), "b%lu", static_cast<unsigned long>(ids.size()));
+                    ids.push_back(addTerm(Node(Node::BLANK, std::string(label, length))));
+                    break;
+                }
+                case TRIPLE:
+                case TRIPLE_DOUBLE:
+                case TRIPLE_FLOAT:
+                case TRIPLE_SIGNED:
+                case TRIPLE_UNSIGNED:
+                case TRIPLE_STRING:
+                {
+                    Statement statement;
+                    if (!readTermId(pos, end, ids, statement.subject) || !readTermId(pos, end, ids, statement.predicate))
+                        return fail();
+                    if (tag == TRIPLE)
+                    {
+                        if (!readTermId(pos, end, ids, statement.object))
+                            return fail();
+                    }
+                    else
+                    {
+                        Node object;
+                        if (!readLiteral(tag, pos, end, object))
+                            return fail();
+                        statement.object = addTerm(std::move(object));
+                    }
+                    statements_.push_back(statement);
+                    break;
+                }
+                default:
+                    return fail();
+            }
+        }
+        buildIndex();
+        return true;
+    }
+
+    void clear()
+    {
+        terms_.clear();
+        statements_.clear();
+        uris_.clear();
+        blanks_.clear();
+        order_.clear();
+        subject_begin_.clear();
+        generation_ = nextTermTableGeneration();
+    }
+
+    /**
+     * Index of the URI or blank node in terms(), NO_TERM when the graph does not
+     * contain it.
+     */
+    uint32_t find_term(const Node &node) const
+    {
+        if (node.graph_ == this && node.graph_generation_ == generation_)
+            return node.index_;
+        if (node.cache_generation_ == generation_)
+            return node.cache_id_;
+        uint32_t index = NO_TERM;
+        if (node.is_uri() || node.is_blank())
+        {
+            const std::unordered_map<std::string, uint32_t> &terms = node.is_uri() ? uris_ : blanks_;
+            auto it = terms.find(node.value());
+            if (it != terms.end())
+                index = it->second;
+        }
+        node.cache_generation_ = generation_;
+        node.cache_id_ = index;
+        return index;
+    }
+
+    // Positions in statements() of the statements with subject term index
+    const uint32_t * subject_begin(uint32_t subject) const { return order_.data() + subject_begin_[subject]; }
+    const uint32_t * subject_end(uint32_t subject) const { return order_.data() + subject_begin_[subject + 1]; }
+
+private:
+
+    bool fail()
+    {
+        clear();
+        return false;
+    }
+
+    uint32_t addTerm(Node &&node)
+    {
+        const uint32_t index = static_cast<uint32_t>(terms_.size());
+        node.graph_ = this;
+        node.index_ = index;
+        node.graph_generation_ = generation_;
+        if (node.is_uri())
+            uris_.insert(std::make_pair(node.value_, index));
+        else if (node.is_blank())
+            blanks_.insert(std::make_pair(node.value_, index));
+        terms_.push_back(std::move(node));
+        return index;
+    }
+
+    void buildIndex()
+    {
+        // Counting sort of statement positions by subject
+        subject_begin_.assign(terms_.size() + 1, 0);
+        for (const auto &it : statements_)
+            ++subject_begin_[it.subject + 1];
+        for (size_t i = 1; i < subject_begin_.size(); ++i)
+            subject_begin_[i] += subject_begin_[i - 1];
+        order_.resize(statements_.size());
+        std::vector<uint32_t> next(subject_begin_.begin(), subject_begin_.end() - 1);
+        for (size_t i = 0; i < statements_.size(); ++i)
+            order_[next[statements_[i].subject]++] = static_cast<uint32_t>(i);
+    }
+
+    static bool readVarint(const unsigned char *&pos, const unsigned char *end, unsigned long long &value)
+    {
+        value = 0;
+        for (unsigned shift = 0; pos != end && shift < 64; shift += 7)
+        {
+            const unsigned char byte = *pos++;
+            value |= static_cast<unsigned long long>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    static bool readFixed(const unsigned char *&pos, const unsigned char *end, size_t size, uint64_t &bits)
+    {
+        if (static_cast<size_t>(end - pos) < size)
+            return false;
+        bits = 0;
+        for (size_t i = 0; i < size; ++i)
+            bits |= static_cast<uint64_t>(pos[i]) << (8 * i);
+        pos += size;
+        return true;
+    }
+
+    static bool readTermId(const unsigned char *&pos, const unsigned char *end, const std::vector<uint32_t> &ids, uint32_t &index)
+    {
+        unsigned long long id;
+        if (!readVarint(pos, end, id) || id >= ids.size())
+            return false;
+        index = ids[id];
+        return true;
+    }
+
+    static bool readLiteral(unsigned char tag, const unsigned char *&pos, const unsigned char *end, Node &object)
+    {
+        uint64_t bits;
+        unsigned long long value;
+        switch (tag)
+        {
+            case TRIPLE_DOUBLE:
+            {
+                if (!readFixed(pos, end, 8, bits))
+                    return false;
+                double d;
+                std::memcpy(&d, &bits, sizeof(d));
+                object = Node::make_numeric_node(d);
+                return true;
+            }
+            case TRIPLE_FLOAT:
+            {
+                if (!readFixed(pos, end, 4, bits))
+                    return false;
+                const uint32_t bits32 = static_cast<uint32_t>(bits);
+                float f;
+                std::memcpy(&f, &bits32, sizeof(f));
+                object = Node::make_numeric_node(f);
+                return true;
+            }
+            case TRIPLE_SIGNED:
+            case TRIPLE_UNSIGNED:
+            {
+                if (pos == end)
+                    return false;
+                const size_t xsd_index = *pos++;
+                if (xsd_index >= XsdVocabulary::numeric_size || !readVarint(pos, end, value))
+                    return false;
+                if (tag == TRIPLE_SIGNED)
+                {
+                    object = Node(Node::SIGNED, xsd_index);
+                    object.number_.i = static_cast<long long>(value >> 1) ^ -static_cast<long long>(value & 1);
+                }
+                else
+                {
+                    object = Node(Node::UNSIGNED, xsd_index);
+                    object.number_.u = value;
+                }
+                return true;
+            }
+            case TRIPLE_STRING:
+                if (!readVarint(pos, end, value) || value > static_cast<size_t>(end - pos))
+                    return false;
+                object = Node::make_string_node(std::string(reinterpret_cast<const char *>(pos), value));
+                pos += value;
+                return true;
+        }
+        return false;
+    }
+
+    std::vector<Node> terms_;
+    std::vector<Statement> statements_;
+    std::unordered_map<std::string, uint32_t> uris_;
+    std::unordered_map<std::string, uint32_t> blanks_;
+    std::vector<uint32_t> order_;
+    std::vector<uint32_t> subject_begin_;
+    size_t generation_;
+};
+
+// Vocabulary
+
+/**
+ * Cache of vocabulary nodes. Prefixed names of a table without resolved IRI are
+ * expanded with the prefixes on the first access of the table, so all prefixes
+ * must be added before the first serialization. Names with unknown prefix are
+ * used as URIs unchanged.
+ */
+class Vocabulary
+{
+public:
+
+    void add_prefix(const std::string &prefix, const std::string &uri)
+    {
+        prefixes_[prefix] = uri;
+    }
+
+    std::string expand(const std::string &curie) const
+    {
+        const std::string::size_type i = curie.find(':');
+        if (i == std::string::npos)
+            return curie;
+        auto it = prefixes_.find(curie.substr(0, i));
+        if (it == prefixes_.end())
+            return curie;
+        return it->second + curie.substr(i + 1);
+    }
+
+    template <class Table>
+    const Node & get(size_t index)
+    {
+        const size_t id = vocabularyTableId<Table>();
+        if (id >= tables_.size())
+            tables_.resize(id + 1);
+        std::vector<Node> &nodes = tables_[id];
+        if (nodes.empty())
+        {
+            nodes.reserve(Table::size);
+            for (size_t i = 0; i < Table::size; ++i)
+            {
+                if (const char *iri = Table::iri(i))
+                    nodes.push_back(Node::make_uri_node(iri));
+                else
+                    nodes.push_back(Node::make_uri_node(expand(Table::term(i))));
+            }
+        }
+        return nodes[index];
+    }
+
+private:
+    std::map<std::string, std::string> prefixes_;
+    std::vector<std::vector<Node> > tables_;
+};
+
+struct CoreVocabulary
+{
+    enum Term { RDF_TYPE, CORE_CONTAINER, CORE_MEMBER };
+
+    static const size_t size = 3;
+
+    static const char * term(size_t index)
+    {
+        static const char * const terms[size] = { "rdf:type", "core:Container", "core:member" };
+        return terms[index];
+    }
+
+    static const char * iri(size_t)
+    {
+        return 0;
+    }
+};
+
+/**
+ * State shared by all contexts derived from one root context. Pass the same state
+ * to all root contexts to reuse vocabulary nodes and keep blank node labels unique.
+ * Each root context resets the per-serialization members.
+ */
+struct ContextState
+{
+    Vocabulary vocabulary;
+    unsigned long blank_id;
+    // URIs of nodes serialized by the current root context
+    std::unordered_set<std::string> written;
+    // Nodes of shared objects serialized by the current root context
+    std::unordered_map<const void *, Node> shared;
+    // Paths of derived contexts
+    PathBuffers paths;
+    // Not reset by begin(), values stay cached while the state is shared
+    NodeCache node_cache;
+    // Counters of generated code and traits, used with ARVIDA_RDF_INSTRUMENTATION
+    Instrumentation *instrumentation;
+
+    ContextState() : blank_id(0), instrumentation(0) { }
+
+    void begin()
+    {
+        written.clear();
+        shared.clear();
+    }
+};
+
+/**
+ * Context writes to encoder when created from an Encoder and reads from graph when
+ * created from a Graph.
+ */
+struct Context
+{
+    Encoder *encoder;
+    const Graph *graph;
+    const std::string &base_path;
+    const std::string &path;
+    Cache *cache;
+    const void *user_data;
+    ContextState *state;
+    // Nesting depth of derived contexts, selects buffer in ContextState::paths
+    size_t depth;
+
+    Context(Encoder &encoder, const std::string &base_path, const std::string &path, Cache *cache = 0, const void *user_data = 0, ContextState *state = 0) : encoder(&encoder), graph(0), base_path(base_path), path(path), cache(cache), user_data(user_data), state(state), depth(0) { initState(); }
+    Context(Encoder &encoder, const std::string &path, Cache *cache = 0, const void *user_data = 0, ContextState *state = 0) : encoder(&encoder), graph(0), base_path(path), path(path), cache(cache), user_data(user_data), state(state), depth(0) { initState(); }
+    Context(const Graph &graph, const std::string &base_path, const std::string &path, Cache *cache = 0, const void *user_data = 0, ContextState *state = 0) : encoder(0), graph(&graph), base_path(base_path), path(path), cache(cache), user_data(user_data), state(state), depth(0) { initState(); }
+    Context(const Graph &graph, const std::string &path, Cache *cache = 0, const void *user_data = 0, ContextState *state = 0) : encoder(0), graph(&graph), base_path(path), path(path), cache(cache), user_data(user_data), state(state), depth(0) { initState(); }
+    Context(const Context &ctx) : encoder(ctx.encoder), graph(ctx.graph), base_path(ctx.base_path), path(ctx.path), cache(ctx.cache), user_data(ctx.user_data), state(ctx.state), depth(ctx.depth), ownState_(ctx.ownState_) { }
+    Context(const Context &ctx, const std::string &path) : encoder(ctx.encoder), graph(ctx.graph), base_path(ctx.base_path), path(path), cache(ctx.cache), user_data(ctx.user_data), state(ctx.state), depth(ctx.depth + 1) { }
+
+private:
+    void initState()
+    {
+        if (!state)
+        {
+            ownState_.reset(new ContextState());
+            state = ownState_.get();
+        }
+        state->begin();
+    }
+
+    // Shared with copies of a root context, which may outlive the original
+    std::shared_ptr<ContextState> ownState_;
+};
+
+template <class Table>
+inline const Node & vocabularyNode(const Context &ctx, size_t index)
+{
+    return ctx.state->vocabulary.get<Table>(index);
+}
+
+inline NodeCache & nodeCache(const Context &ctx)
+{
+    return ctx.state->node_cache;
+}
+
+inline Node blankNode(const Context &ctx)
+{
+    char buf[32];
+    const int len = std::snprintf(buf, sizeof(buf), "b%lu", ++ctx.state->blank_id);
+    return Node::make_blank_node(std::string(buf, len));
+}
+
+struct Triple
+{
+    Node subject;
+    Node predicate;
+    Node object;
+
+    Triple() : subject(), predicate(), object() { }
+
+    Triple(const Node &subject, const Node &predicate, const Node &object)
+        : subject(subject)
+        , predicate(predicate)
+        , object(object)
+    { }
+
+    bool is_valid() const
+    {
+        return subject.is_valid() && predicate.is_valid() && object.is_valid();
+    }
+};
+
+/**
+ * Lazy range over the statements of the graph of ctx matching a pattern. Node() in
+ * the pattern matches any node, statements are looked up in the subject index when
+ * the subject is given.
+ */
+class TripleRange
+{
+public:
+
+    class iterator
+    {
+    public:
+        iterator() : range_(0) { }
+
+        const Node & get_subject() const { return range_->graph_.terms()[statement().subject]; }
+        const Node & get_predicate() const { return range_->graph_.terms()[statement().predicate]; }
+        const Node & get_object() const { return range_->graph_.terms()[statement().object]; }
+
+        const iterator & operator*() const { return *this; }
+        const iterator * operator->() const { return this; }
+
+        iterator & operator++()
+        {
+            if (!range_->next(pos_))
+                range_ = 0;
+            return *this;
+        }
+
+        bool operator==(const iterator &other) const { return range_ == other.range_ && (!range_ || pos_ == other.pos_); }
+        bool operator!=(const iterator &other) const { return !(*this == other); }
+
+    private:
+        friend class TripleRange;
+
+        iterator(const TripleRange *range, const uint32_t *pos) : range_(range), pos_(pos) { }
+
+        const Graph::Statement & statement() const { return range_->graph_.statements()[*pos_]; }
+
+        const TripleRange *range_;
+        const uint32_t *pos_;
+    };
+
+    TripleRange(const Context &ctx, const Node &subject, const Node &predicate, const Node &object)
+        : graph_(*ctx.graph)
+        , subject_(pattern(subject))
+        , predicate_(pattern(predicate))
+        , object_(pattern(object))
+        , begin_(0)
+        , end_(0)
+    {
+        if (subject_ == MISSING || predicate_ == MISSING || object_ == MISSING)
+            return;
+        if (subject_ != ANY)
+        {
+            begin_ = graph_.subject_begin(subject_);
+            end_ = graph_.subject_end(subject_);
+        }
+        else
+        {
+            all_.reset(new std::vector<uint32_t>(graph_.statements().size()));
+            for (size_t i = 0; i < all_->size(); ++i)
+                (*all_)[i] = static_cast<uint32_t>(i);
+            begin_ = all_->data();
+            end_ = begin_ + all_->size();
+        }
+        skip(begin_);
+    }
+
+    TripleRange(const TripleRange &) = delete;
+    TripleRange & operator=(const TripleRange &) = delete;
+
+    bool empty() const { return begin_ == end_; }
+
+    iterator begin() const { return empty() ? iterator() : iterator(this, begin_); }
+    iterator end() const { return iterator(); }
+
+private:
+    static const uint32_t ANY = Graph::NO_TERM;
+    static const uint32_t MISSING = Graph::NO_TERM - 1;
+
+    uint32_t pattern(const Node &node) const
+    {
+        if (!node.is_valid())
+            return ANY;
+        const uint32_t index = graph_.find_term(node);
+        return index == Graph::NO_TERM ? MISSING : index;
+    }
+
+    bool matches(const Graph::Statement &statement) const
+    {
+        return (subject_ == ANY || statement.subject == subject_) &&
+            (predicate_ == ANY || statement.predicate == predicate_) &&
+            (object_ == ANY || statement.object == object_);
+    }
+
+    void skip(const uint32_t *&pos) const
+    {
+        while (pos != end_ && !matches(graph_.statements()[*pos]))
+            ++pos;
+    }
+
+    bool next(const uint32_t *&pos) const
+    {
+        ++pos;
+        skip(pos);
+        return pos != end_;
+    }
+
+    const Graph &graph_;
+    uint32_t subject_;
+    uint32_t predicate_;
+    uint32_t object_;
+    std::unique_ptr<std::vector<uint32_t> > all_;
+    const uint32_t *begin_;
+    const uint32_t *end_;
+};
+
+inline Triple find_triple(const Context &ctx, const Node &subject, const Node &predicate, const Node &object)
+{
+    TripleRange range(ctx, subject, predicate, object);
+    if (range.empty())
+        return Triple();
+    TripleRange::iterator it = range.begin();
+    return Triple(it->get_subject(), it->get_predicate(), it->get_object());
+}
+
+inline void addStatement(const Context &ctx, const Node &subject, const Node &predicate, const Node &object)
+{
+    ARVIDA_RDF_COUNT(ctx, statements, 1);
+    ctx.encoder->add_statement(subject, predicate, object);
+}
+
+/**
+ * Returns true when node was not written before by the current root context and
+ * marks it as written. Blank nodes are unique and never written twice.
+ */
+inline bool markNodeWritten(const Context &ctx, const Node &node)
+{
+    ARVIDA_RDF_COUNT(ctx, lookups, 1);
+    if (node.is_blank())
+        return true;
+    return ctx.state->written.insert(node.value()).second;
+}
+
+template <class T>
+inline bool isValidValue(const T &value)
+{
+    return true;
+}
+
+template < class T >
+inline bool isValidValue(const std::shared_ptr<T> &value)
+{
+    return value.operator bool();
+}
+
+// PathType
+
+enum PathType
+{
+    NO_PATH, RELATIVE_PATH, RELATIVE_TO_BASE_PATH, ABSOLUTE_PATH
+};
+
+// uidOf
+
+template<class T>
+inline std::string uidOf(const Context &ctx, const T &value)
+{
+    return value.getUid();
+}
+
+// pathOf_impl, pathTypeOf_impl
+
+template<class T>
+inline std::string pathOf_impl(const Context &ctx, const T &value)
+{
+    return uidOf(ctx, value);
+}
+
+template<class T>
+inline PathType pathTypeOf_impl(const Context &ctx, const T &value)
+{
+    return RELATIVE_TO_BASE_PATH;
+}
+
+// pathOf
+
+template<class T>
+inline std::string pathOf(const Context &ctx, const T &value)
+{
+    return pathOf_impl(ctx, value);
+}
+
+template<class T>
+inline std::string pathOf(const Context &ctx, const std::shared_ptr<T> &value)
+{
+    if (value)
+        return pathOf(ctx, *value);
+    else
+        return "";
+}
+
+template<class T>
+inline PathType pathTypeOf(const Context &ctx, const T &value)
+{
+    return pathTypeOf_impl(ctx, value);
+}
+
+template<class T>
+inline PathType pathTypeOf(const Context &ctx, const std::shared_ptr<T> &value)
+{
+    if (value)
+        return pathTypeOf(ctx, *value);
+    else
+        return NO_PATH;
+}
+
+// appendPathOf
+
+/**
+ * Appends path of value to path. Generated code specializes it for annotated
+ * classes to build the path without temporary strings.
+ */
+template<class T>
+inline void appendPathOf(const Context &ctx, std::string &path, const T &value)
+{
+    appendPath(path, pathOf(ctx, value));
+}
+
+template<class T>
+inline void appendPathOf(const Context &ctx, std::string &path, const std::shared_ptr<T> &value)
+{
+    if (value)
+        appendPathOf(ctx, path, *value);
+}
+
+template<>
+inline std::string pathOf(const Context &ctx, const double &value)
+{
+    return "";
+}
+
+template<>
+inline PathType pathTypeOf(const Context &ctx, const double &value)
+{
+    return NO_PATH;
+}
+
+template<>
+inline std::string pathOf(const Context &ctx, const float &value)
+{
+    return "";
+}
+
+template<>
+inline PathType pathTypeOf(const Context &ctx, const float &value)
+{
+    return NO_PATH;
+}
+
+#define ARVIDA_BINARY_INTEGER_PATH(T)                                           \
+template<>                                                                      \
+inline std::string pathOf(const Context &ctx, const T &value)                   \
+{                                                                               \
+    return "";                                                                  \
+}                                                                               \
+                                                                                \
+template<>                                                                      \
+inline PathType pathTypeOf(const Context &ctx, const T &value)                  \
+{                                                                               \
+    return NO_PATH;                                                             \
+}
+
+ARVIDA_RDF_INTEGER_TYPES(ARVIDA_BINARY_INTEGER_PATH)
+
+#undef ARVIDA_BINARY_INTEGER_PATH
+
+template<>
+inline std::string pathOf(const Context &ctx, const std::string &value)
+{
+    return "";
+}
+
+template<>
+inline PathType pathTypeOf(const Context &ctx, const std::string &value)
+{
+    return NO_PATH;
+}
+
+template<class T>
+inline std::string pathOf(const Context &ctx, const std::vector<T> &value)
+{
+    return "";
+}
+
+template<class T>
+inline PathType pathTypeOf(const Context &ctx, const std::vector<T> &value)
+{
+    return RELATIVE_PATH;
+}
+
+
+// createRDFNode
+
+template<class T, class M>
+inline const std::string & memberNodePath(const Context &ctx, const T &value, PathType thatPathType, PathType memberPathType, const M &memberPath)
+{
+    ARVIDA_RDF_COUNT(ctx, paths, 1);
+    std::string &thatPath = ctx.state->paths.at(ctx.depth + 1);
+    if (thatPathType == ABSOLUTE_PATH)
+        thatPath.clear();
+    else if (thatPathType == RELATIVE_TO_BASE_PATH)
+        thatPath = ctx.base_path;
+    else {
+        switch (memberPathType)
+        {
+            case NO_PATH:
+                thatPath = ctx.path;
+                break;
+            case RELATIVE_PATH:
+                thatPath = ctx.path;
+                appendPath(thatPath, memberPath);
+                break;
+            case RELATIVE_TO_BASE_PATH:
+                thatPath = ctx.base_path;
+                appendPath(thatPath, memberPath);
+                break;
+            case ABSOLUTE_PATH:
+                thatPath.clear();
+                appendPath(thatPath, memberPath);
+                break;
+        }
+        if (thatPathType != RELATIVE_PATH)
+            return thatPath;
+    }
+    appendPathOf(ctx, thatPath, value);
+    return thatPath;
+}
+
+template<class T, class M>
+Node createRDFNode(const Context &ctx, const T &value, PathType memberPathType, const M &memberPath)
+{
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
+    const PathType thatPathType = pathTypeOf(ctx, value);
+    if (thatPathType == NO_PATH)
+        return blankNode(ctx);
+    return Node::make_uri_node(memberNodePath(ctx, value, thatPathType, memberPathType, memberPath));
+}
+
+template<class T, class M>
+Node createRDFNodeAndSerialize(const Context &ctx, const T &value, PathType memberPathType, const M &memberPath)
+{
+    const void *identity = sharedIdentity(value);
+    if (identity)
+    {
+        auto it = ctx.state->shared.find(identity);
+        if (it != ctx.state->shared.end())
+        {
+            ARVIDA_RDF_COUNT(ctx, cache_hits, 1);
+            return it->second;
+        }
+    }
+
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
+    const PathType thatPathType = pathTypeOf(ctx, value);
+    if (thatPathType == NO_PATH)
+    {
+        Node thatNode(blankNode(ctx));
+        if (identity)
+            ctx.state->shared.insert(std::make_pair(identity, thatNode));
+        toRDF(ctx, thatNode, value);
+        return thatNode;
+    }
+    else
+    {
+        const std::string &thatPath = memberNodePath(ctx, value, thatPathType, memberPathType, memberPath);
+        ARVIDA_RDF_COUNT(ctx, bytes, thatPath.size());
+        Arvida::RDF::Context thatCtx(ctx, thatPath);
+        Node thatNode(Node::make_uri_node(thatPath));
+        if (identity)
+            ctx.state->shared.insert(std::make_pair(identity, thatNode));
+        if (markNodeWritten(ctx, thatNode))
+            toRDF(thatCtx, thatNode, value);
+        else
+            ARVIDA_RDF_COUNT(ctx, cache_hits, 1);
+        return thatNode;
+    }
+}
+
+// toRDF
+
+template < class T >
+Node toRDF(const Context &ctx, const T &value)
+{
+    Node valueNode = blankNode(ctx);
+    return toRDF(ctx, valueNode, value);
+}
+
+template < class T >
+inline NodeRef toRDF(const Context &ctx, NodeRef thisNode, const T &value)
+{
+    return value.toRDF(ctx, thisNode);
+}
+
+template < class T >
+inline NodeRef toRDF(const Context &ctx, NodeRef thisNode, const std::shared_ptr<T> &value)
+{
+    if (value)
+        return toRDF(ctx, thisNode, *value);
+    else
+    {
+        if (!thisNode.is_blank())
+            thisNode = blankNode(ctx);
+        return thisNode;
+    }
+}
+
+template < class T >
+inline NodeRef toRDF(const Context &ctx, NodeRef thisNode, const std::vector<T> &value)
+{
+    addStatement(ctx, thisNode,
+                 vocabularyNode<CoreVocabulary>(ctx, CoreVocabulary::RDF_TYPE),
+                 vocabularyNode<CoreVocabulary>(ctx, CoreVocabulary::CORE_CONTAINER));
+
+    const Node &memberNode = vocabularyNode<CoreVocabulary>(ctx, CoreVocabulary::CORE_MEMBER);
+    for (auto it = std::begin(value); it != std::end(value); ++it)
+    {
+        const auto & _that = *it;
+        addStatement(ctx, thisNode, memberNode, Arvida::RDF::toRDF(ctx, _that));
+    }
+    return thisNode;
+}
+
+template<class T>
+inline NodeRef numericToRDF(const Context &ctx, NodeRef _this, T value)
+{
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
+    ARVIDA_RDF_COUNT(ctx, bytes, sizeof(T));
+    _this = Node::make_numeric_node(value);
+    return _this;
+}
+
+template<>
+inline NodeRef toRDF(const Context &ctx, NodeRef _this, const double &value)
+{
+    return numericToRDF(ctx, _this, value);
+}
+
+template<>
+inline NodeRef toRDF(const Context &ctx, NodeRef _this, const float &value)
+{
+    return numericToRDF(ctx, _this, value);
+}
+
+template<>
+inline NodeRef toRDF(const Context &ctx, NodeRef _this, const std::string &value)
+{
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
+    ARVIDA_RDF_COUNT(ctx, bytes, value.size());
+    _this = Node::make_string_node(value);
+    return _this;
+}
+
+// fromRDF
+
+template < class T >
+bool fromRDF(const Context &ctx, const NodeRef thisNode, T &value)
+{
+    return value.fromRDF(ctx, thisNode);
+}
+
+template < class T >
+bool fromRDF(const Context &ctx, const NodeRef thisNode, std::shared_ptr<T> &value)
+{
+    return value ? fromRDF(ctx, thisNode, *value) : false;
+}
+
+/**
+ * Reads a container written by toRDF, elements are read in the order of the
+ * core:member statements of the model.
+ */
+template < class T >
+bool fromRDF(const Context &ctx, const NodeRef thisNode, std::vector<T> &value)
+{
+    TripleRange members(ctx, thisNode, vocabularyNode<CoreVocabulary>(ctx, CoreVocabulary::CORE_MEMBER), Node());
+    value.clear();
+    for (auto it = std::begin(members); it != std::end(members); ++it)
+    {
+        Node elementNode = it->get_object();
+        T element;
+        if (!Arvida::RDF::fromRDF(ctx, elementNode, element))
+            return false;
+        value.push_back(std::move(element));
+    }
+    return true;
+}
+
+/**
+ * Binary values are used directly when T represents them exactly, other numeric
+ * literals are parsed from their lexical form with range checks.
+ */
+template <class T>
+inline bool numericFromRDF(const Context &ctx, const Node &node, T &value)
+{
+    if (!node.is_literal())
+        return false;
+    if (node.get_value(value))
+        return true;
+    if (node.xsd_index() >= XsdVocabulary::numeric_size &&
+        (node.xsd_index() < XsdVocabulary::size || !isNumericDatatype(node.datatype().c_str())))
+        return false;
+    const std::string lexical = node.lexical_form();
+    ARVIDA_RDF_COUNT(ctx, literal_parses, 1);
+    return parseNumericLiteral(lexical.data(), lexical.data() + lexical.size(), value);
+}
+
+template <>
+inline bool fromRDF(const Context &ctx, const NodeRef _this0, double &value)
+{
+    return numericFromRDF(ctx, _this0, value);
+}
+
+template <>
+inline bool fromRDF(const Context &ctx, const NodeRef _this0, float &value)
+{
+    return numericFromRDF(ctx, _this0, value);
+}
+
+#define ARVIDA_BINARY_INTEGER_LITERAL(T)                                        \
+template<>                                                                      \
+inline NodeRef toRDF(const Context &ctx, NodeRef _this, const T &value)         \
+{                                                                               \
+    return numericToRDF(ctx, _this, value);                                     \
+}                                                                               \
+                                                                                \
+template <>                                                                     \
+inline bool fromRDF(const Context &ctx, const NodeRef _this0, T &value)         \
+{                                                                               \
+    return numericFromRDF(ctx, _this0, value);                                  \
+}
+
+ARVIDA_RDF_INTEGER_TYPES(ARVIDA_BINARY_INTEGER_LITERAL)
+
+#undef ARVIDA_BINARY_INTEGER_LITERAL
+
+template <>
+inline bool fromRDF(const Context &ctx, const NodeRef _this0, std::string &value)
+{
+    if (!_this0.is_literal())
+        return false;
+    value = _this0.lexical_form();
+    return true;
+}
+
+/**
+ * Serializes all elements of an array, std::array or std::vector of numbers as one
+ * literal with a PackedVocabulary datatype, like the packed literals of the other traits.
+ */
+template <class C>
+inline Node packedToRDF(const Context &ctx, const C &values)
+{
+    std::string literal;
+    const size_t index = encodePackedLiteral(values, literal);
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
+    ARVIDA_RDF_COUNT(ctx, bytes, literal.size());
+    return Node::make_typed_literal_node(literal, PackedVocabulary::iri(index));
+}
+
+/**
+ * Reads packed literal node written by packedToRDF, fails when the datatype does not
+ * match the element type or the number of elements of a fixed size array differs.
+ */
+template <class C>
+inline bool packedFromRDF(const Context &ctx, const Node &node, C &values)
+{
+    if (!node.is_literal() || node.datatype() != PackedVocabulary::iri(PackedContainer<C>::packed_index))
+        return false;
+    const std::string &literal = node.value();
+    ARVIDA_RDF_COUNT(ctx, literal_parses, 1);
+    return decodePackedLiteral(literal.data(), literal.data() + literal.size(), values);
+}
+
+} // namespace RDF
+} // namespace Arvida
+
+#endif
@@ -0,0 +1,1822 @@
+/*  ARVIDAPP - ARVIDA C++ Preprocessor
+ *
+ *  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef RDF_TRAITS_COMMON_HPP_INCLUDED
+#define RDF_TRAITS_COMMON_HPP_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <clocale>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+// std::string_view members are supported when the generated code is compiled as C++17
+#if __cplusplus >= 201703L
+#include <string_view>
+#define ARVIDA_RDF_HAS_STRING_VIEW 1
+#endif
+
+#ifndef ARVIDA_PACKED_NS
+#define ARVIDA_PACKED_NS "http://www.arvida.de/rdf/packed#"
+#endif
+
+#ifndef ARVIDA_XSD_NS
+#define ARVIDA_XSD_NS "http://www.w3.org/2001/XMLSchema#"
+#endif
+
+namespace Arvida {
+namespace RDF {
+
+// Vocabulary
+
+/**
+ * A vocabulary table is a class with a static size member, a static term(index)
+ * function returning prefixed names and a static iri(index) function returning
+ * IRIs resolved at generation time or 0. Generated code declares one table
+ * containing all prefixed names used by the annotated classes.
+ */
+inline size_t nextVocabularyTableId()
+{
+    static std::atomic<size_t> counter(0);
+    return counter++;
+}
+
+template <class Table>
+inline size_t vocabularyTableId()
+{
+    static const size_t id = nextVocabularyTableId();
+    return id;
+}
+
+// TypedCache
+
+inline size_t nextCacheSlotId()
+{
+    static std::atomic<size_t> counter(0);
+    return counter++;
+}
+
+template <class T>
+inline size_t cacheSlotId()
+{
+    static const size_t id = nextCacheSlotId();
+    return id;
+}
+
+/**
+ * Open addressing hash map storing keys and values in one flat array.
+ * Key and T must be default constructible and movable. Pointers to values are
+ * valid until the next insertion.
+ */
+template <class Key, class T, class Hash, class Equal>
+class FlatHashMap
+{
+public:
+
+    FlatHashMap() : size_(0), shift_(0) { }
+
+    size_t size() const { return size_; }
+
+    T * find(const Key &key)
+    {
+        if (size_ == 0)
+            return 0;
+        for (size_t i = bucket(key); ; i = (i + 1) & (entries_.size() - 1))
+        {
+            Entry &entry = entries_[i];
+            if (!entry.used)
+                return 0;
+            if (equal_(entry.key, key))
+                return &entry.value;
+        }
+    }
+
+    /**
+     * Returns value of key and true when it was inserted with default value.
+     */
+    std::pair<T *, bool> emplace(const Key &key)
+    {
+        if ((size_ + 1) * 4 > entries_.size() * 3)
+            rehash(entries_.empty() ? 16 : entries_.size() * 2);
+        for (size_t i = bucket(key); ; i = (i + 1) & (entries_.size() - 1))
+        {
+            Entry &entry = entries_[i];
+            if (!entry.used)
+            {
+                entry.key = key;
+                entry.used = true;
+                ++size_;
+                return std::make_pair(&entry.value, true);
+            }
+            if (equal_(entry.key, key))
+                return std::make_pair(&entry.value, false);
+        }
+    }
+
+    /**
+     * Removes all values, capacity is kept.
+     */
+    void clear()
+    {
+        for (size_t i = 0; i < entries_.size(); ++i)
+        {
+            if (entries_[i].used)
+                entries_[i] = Entry();
+        }
+        size_ = 0;
+    }
+
+private:
+
+    struct Entry
+    {
+        Key key;
+        T value;
+        bool used;
+
+        Entry() : key(), value(), used(false) { }
+    };
+
+    size_t bucket(const Key &key) const
+    {
+        // Fibonacci hashing spreads pointer hashes with zero low bits
+        const unsigned long long h = static_cast<unsigned long long>(hash_(key)) * 11400714819323198485ULL;
+        return static_cast<size_t>(h >> shift_);
+    }
+
+    void rehash(size_t capacity)
+    {
+        std::vector<Entry> entries(capacity);
+        entries.swap(entries_);
+        shift_ = 64;
+        for (size_t c = capacity; c > 1; c >>= 1)
+            --shift_;
+        size_ = 0;
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            if (entries[i].used)
+            {
+                std::pair<T *, bool> inserted = emplace(entries[i].key);
+                *inserted.first = std::move(entries[i].value);
+            }
+        }
+    }
+
+    std::vector<Entry> entries_;
+    size_t size_;
+    unsigned shift_;
+    Hash hash_;
+    Equal equal_;
+};
+
+/**
+ * Cache of values keyed by C++ type and node. Each type has its own slot found by
+ * index, values of a slot are stored in a FlatHashMap, no RTTI is involved.
+ * Reader hooks like create_element use it to intern objects per node.
+ */
+template <class Key, class Hash, class Equal>
+class TypedCache
+{
+public:
+
+    template <class T>
+    T * find(const Key &key)
+    {
+        Slot<T> *slot = getSlot<T>(false);
+        return slot ? slot->values.find(key) : 0;
+    }
+
+    /**
+     * Returns cached value of key, inserts default constructed value when there is none.
+     */
+    template <class T>
+    T & get(const Key &key)
+    {
+        return *getSlot<T>(true)->values.emplace(key).first;
+    }
+
+    template <class T>
+    std::pair<T *, bool> emplace(const Key &key)
+    {
+        return getSlot<T>(true)->values.emplace(key);
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < slots_.size(); ++i)
+        {
+            if (slots_[i])
+                slots_[i]->clear();
+        }
+    }
+
+private:
+
+    struct SlotBase
+    {
+        virtual ~SlotBase() { }
+        virtual void clear() = 0;
+    };
+
+    template <class T>
+    struct Slot : public SlotBase
+    {
+        FlatHashMap<Key, T, Hash, Equal> values;
+
+        virtual void clear() { values.clear(); }
+    };
+
+    template <class T>
+    Slot<T> * getSlot(bool create)
+    {
+        const size_t id = cacheSlotId<T>();
+        if (id >= slots_.size())
+        {
+            if (!create)
+                return 0;
+            slots_.resize(id + 1);
+        }
+        if (!slots_[id])
+        {
+            if (!create)
+                return 0;
+            slots_[id].reset(new Slot<T>());
+        }
+        return static_cast<Slot<T> *>(slots_[id].get());
+    }
+
+    std::vector<std::unique_ptr<SlotBase> > slots_;
+};
+
+// sharedIdentity
+
+/**
+ * Returns address of the object owned by shared_ptr value, 0 for other values.
+ * Objects shared by several members are serialized once per root context.
+ */
+template <class T>
+inline const void * sharedIdentity(const T &value)
+{
+    return 0;
+}
+
+template <class T>
+inline const void * sharedIdentity(const std::shared_ptr<T> &value)
+{
+    return value.get();
+}
+
+// Paths
+
+/**
+ * Appends segment to path joining them with a single '/'.
+ * Same as path = joinPath(path, segment) but reuses storage of path.
+ */
+inline void appendPath(std::string &path, const char *segment, size_t length)
+{
+    if (length == 0)
+        return;
+    if (path.empty())
+    {
+        path.append(segment, length);
+        return;
+    }
+
+    const bool p1b = path.back() == '/';
+    const bool p2f = segment[0] == '/';
+
+    if (p1b && p2f)
+        path.append(segment + 1, length - 1);
+    else
+    {
+        if (!p1b && !p2f)
+            path.push_back('/');
+        path.append(segment, length);
+    }
+}
+
+inline void appendPath(std::string &path, const char *segment)
+{
+    appendPath(path, segment, std::strlen(segment));
+}
+
+inline void appendPath(std::string &path, const std::string &segment)
+{
+    appendPath(path, segment.data(), segment.size());
+}
+
+inline std::string joinPath(const std::string &path1, const std::string &path2)
+{
+    std::string path(path1);
+    appendPath(path, path2);
+    return path;
+}
+
+/**
+ * Paths of nested contexts, one string per nesting depth. The strings keep their
+ * capacity between serializations, so building a path does not allocate once
+ * the same depth was reached before.
+ */
+class PathBuffers
+{
+public:
+
+    std::string & at(size_t depth)
+    {
+        while (buffers_.size() <= depth)
+            buffers_.emplace_back();
+        return buffers_[depth];
+    }
+
+private:
+    // deque keeps references to strings valid while growing
+    std::deque<std::string> buffers_;
+};
+
+/**
+ * Memory for single elements of node based containers. Freed blocks are kept in
+ * free lists by size and reused, chunks are only released by the destructor, so a
+ * container that is cleared and filled again with as many elements does not
+ * allocate. Not thread safe.
+ */
+class NodePool
+{
+public:
+
+    NodePool() : chunk_pos_(0), chunk_end_(0)
+    {
+        std::fill(free_, free_ + num_classes, static_cast<FreeBlock *>(0));
+    }
+
+    NodePool(const NodePool &) = delete;
+    NodePool & operator=(const NodePool &) = delete;
+
+    ~NodePool()
+    {
+        for (auto &chunk : chunks_)
+            ::operator delete(chunk);
+    }
+
+    void * allocate(size_t size)
+    {
+        const size_t size_class = sizeClass(size);
+        if (size_class >= num_classes)
+            return ::operator new(size);
+        if (FreeBlock *block = free_[size_class])
+        {
+            free_[size_class] = block->next;
+            return block;
+        }
+        const size_t block_size = (size_class + 1) * granularity;
+        if (static_cast<size_t>(chunk_end_ - chunk_pos_) < block_size)
+        {
+            chunks_.push_back(::operator new(chunk_size));
+            chunk_pos_ = static_cast<char *>(chunks_.back());
+            chunk_end_ = chunk_pos_ + chunk_size;
+        }
+        void *result = chunk_pos_;
+        chunk_pos_ += block_size;
+        return result;
+    }
+
+    void deallocate(void *p, size_t size)
+    {
+        const size_t size_class = sizeClass(size);
+        if (size_class >= num_classes)
+        {
+            ::operator delete(p);
+            return;
+        }
+        FreeBlock *block = static_cast<FreeBlock *>(p);
+        block->next = free_[size_class];
+        free_[size_class] = block;
+    }
+
+    // Number of bytes of allocated chunks
+    size_t capacity() const { return chunks_.size() * chunk_size; }
+
+private:
+
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    static size_t sizeClass(size_t size)
+    {
+        return size ? (size - 1) / granularity : 0;
+    }
+
+    static const size_t granularity = alignof(std::max_align_t);
+    // Blocks up to num_classes * granularity bytes are pooled
+    static const size_t num_classes = 16;
+    static const size_t chunk_size = 16384;
+
+    FreeBlock *free_[num_classes];
+    std::vector<void *> chunks_;
+    char *chunk_pos_;
+    char *chunk_end_;
+};
+
+/**
+ * Allocator of single elements from a NodePool, arrays (e.g. hash table buckets)
+ * are allocated from the heap.
+ */
+template <class T>
+class PoolAllocator
+{
+public:
+    typedef T value_type;
+
+    explicit PoolAllocator(NodePool &pool) : pool_(&pool) { }
+
+    template <class U>
+    PoolAllocator(const PoolAllocator<U> &other) : pool_(other.pool()) { }
+
+    T * allocate(size_t n)
+    {
+        if (n == 1)
+            return static_cast<T *>(pool_->allocate(sizeof(T)));
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n)
+    {
+        if (n == 1)
+            pool_->deallocate(p, sizeof(T));
+        else
+            ::operator delete(p);
+    }
+
+    NodePool * pool() const { return pool_; }
+
+private:
+    NodePool *pool_;
+};
+
+template <class T, class U>
+inline bool operator==(const PoolAllocator<T> &a, const PoolAllocator<U> &b)
+{
+    return a.pool() == b.pool();
+}
+
+template <class T, class U>
+inline bool operator!=(const PoolAllocator<T> &a, const PoolAllocator<U> &b)
+{
+    return a.pool() != b.pool();
+}
+
+/**
+ * Blank nodes numbered from zero per root context. Nodes are created once with label
+ * prefix + number and kept for following root contexts, so repeated serializations
+ * produce the same labels without formatting and interning them again. Numbering is
+ * only safe for models without blank nodes of previous serializations, otherwise
+ * deterministic() is false and the traits create unique blank nodes of the world.
+ */
+template <class NodeT>
+class BlankNodePool
+{
+public:
+
+    explicit BlankNodePool(const std::string &prefix = "n") : prefix_(prefix), next_(0), deterministic_(true) { }
+
+    void begin(bool deterministic)
+    {
+        next_ = 0;
+        deterministic_ = deterministic;
+    }
+
+    bool deterministic() const { return deterministic_; }
+
+    // Returns the next node, create(label) creates a node that is not in the pool yet
+    template <class Create>
+    const NodeT & next(Create create)
+    {
+        if (next_ == nodes_.size())
+            nodes_.push_back(create(prefix_ + std::to_string(next_)));
+        return nodes_[next_++];
+    }
+
+    // Number of nodes returned since begin()
+    size_t count() const { return next_; }
+
+    // Releases the nodes of the pool
+    void clear()
+    {
+        nodes_.clear();
+        next_ = 0;
+    }
+
+private:
+    std::string prefix_;
+    std::vector<NodeT> nodes_;
+    size_t next_;
+    bool deterministic_;
+};
+
+// Numeric literals
+
+/**
+ * Vocabulary table of XSD datatypes. Backends intern its nodes once per World, so
+ * literal datatypes can be compared by node instead of by IRI string. Numeric
+ * datatypes come first, most common ones at the beginning.
+ */
+struct XsdVocabulary
+{
+    enum
+    {
+        DOUBLE, FLOAT, DECIMAL, INTEGER,
+        LONG, INT, SHORT, BYTE,
+        NON_NEGATIVE_INTEGER, POSITIVE_INTEGER, NON_POSITIVE_INTEGER, NEGATIVE_INTEGER,
+        UNSIGNED_LONG, UNSIGNED_INT, UNSIGNED_SHORT, UNSIGNED_BYTE,
+        STRING
+    };
+
+    // Number of numeric datatypes
+    static const size_t numeric_size = STRING;
+    static const size_t size = STRING + 1;
+
+    static const char * term(size_t index)
+    {
+        static const char * const terms[size] = {
+            "xsd:double", "xsd:float", "xsd:decimal", "xsd:integer",
+            "xsd:long", "xsd:int", "xsd:short", "xsd:byte",
+            "xsd:nonNegativeInteger", "xsd:positiveInteger", "xsd:nonPositiveInteger", "xsd:negativeInteger",
+            "xsd:unsignedLong", "xsd:unsignedInt", "xsd:unsignedShort", "xsd:unsignedByte",
+            "xsd:string"
+        };
+        return terms[index];
+    }
+
+    static const char * iri(size_t index)
+    {
+        static const char * const iris[size] = {
+            ARVIDA_XSD_NS "double", ARVIDA_XSD_NS "float", ARVIDA_XSD_NS "decimal", ARVIDA_XSD_NS "integer",
+            ARVIDA_XSD_NS "long", ARVIDA_XSD_NS "int", ARVIDA_XSD_NS "short", ARVIDA_XSD_NS "byte",
+            ARVIDA_XSD_NS "nonNegativeInteger", ARVIDA_XSD_NS "positiveInteger",
+            ARVIDA_XSD_NS "nonPositiveInteger", ARVIDA_XSD_NS "negativeInteger",
+            ARVIDA_XSD_NS "unsignedLong", ARVIDA_XSD_NS "unsignedInt",
+            ARVIDA_XSD_NS "unsignedShort", ARVIDA_XSD_NS "unsignedByte",
+            ARVIDA_XSD_NS "string"
+        };
+        return iris[index];
+    }
+};
+
+/**
+ * NumericLiteral<T>::datatype() returns the XSD datatype used for serializing values of type T,
+ * NumericLiteral<T>::xsd_index its index in XsdVocabulary.
+ */
+template <class T>
+struct NumericLiteral;
+
+#define ARVIDA_RDF_NUMERIC_LITERAL(T, XSD_INDEX)                                \
+    template <>                                                                 \
+    struct NumericLiteral<T>                                                    \
+    {                                                                           \
+        static const size_t xsd_index = XsdVocabulary::XSD_INDEX;               \
+        static const char * datatype() { return XsdVocabulary::iri(xsd_index); } \
+    };
+
+ARVIDA_RDF_NUMERIC_LITERAL(double, DOUBLE)
+ARVIDA_RDF_NUMERIC_LITERAL(float, FLOAT)
+ARVIDA_RDF_NUMERIC_LITERAL(signed char, BYTE)
+ARVIDA_RDF_NUMERIC_LITERAL(short, SHORT)
+ARVIDA_RDF_NUMERIC_LITERAL(int, INT)
+ARVIDA_RDF_NUMERIC_LITERAL(long, LONG)
+ARVIDA_RDF_NUMERIC_LITERAL(long long, LONG)
+ARVIDA_RDF_NUMERIC_LITERAL(unsigned char, UNSIGNED_BYTE)
+ARVIDA_RDF_NUMERIC_LITERAL(unsigned short, UNSIGNED_SHORT)
+ARVIDA_RDF_NUMERIC_LITERAL(unsigned int, UNSIGNED_INT)
+ARVIDA_RDF_NUMERIC_LITERAL(unsigned long, UNSIGNED_LONG)
+ARVIDA_RDF_NUMERIC_LITERAL(unsigned long long, UNSIGNED_LONG)
+
+#undef ARVIDA_RDF_NUMERIC_LITERAL
+
+/**
+ * Applies macro M to all integer types with a NumericLiteral specialization.
+ * Backends use it to define toRDF and fromRDF specializations.
+ */
+#define ARVIDA_RDF_INTEGER_TYPES(M)                                             \
+    M(signed char) M(short) M(int) M(long) M(long long)                         \
+    M(unsigned char) M(unsigned short) M(unsigned int) M(unsigned long) M(unsigned long long)
+
+/**
+ * Returns true when iri is an XSD datatype with a numeric value space. Backends with
+ * interned datatype nodes compare them with XsdVocabulary nodes instead.
+ */
+inline bool isNumericDatatype(const char *iri, size_t length)
+{
+    const size_t nsLength = sizeof(ARVIDA_XSD_NS) - 1;
+    if (!iri || length <= nsLength || std::memcmp(iri, ARVIDA_XSD_NS, nsLength) != 0)
+        return false;
+    for (size_t i = 0; i < XsdVocabulary::numeric_size; ++i)
+    {
+        const char *type = XsdVocabulary::iri(i);
+        if (std::strlen(type) == length && std::memcmp(type + nsLength, iri + nsLength, length - nsLength) == 0)
+            return true;
+    }
+    return false;
+}
+
+inline bool isNumericDatatype(const char *iri)
+{
+    return iri && isNumericDatatype(iri, std::strlen(iri));
+}
+
+/**
+ * Size of a buffer that can hold the lexical form of any numeric value.
+ */
+const size_t NUMERIC_LITERAL_BUFFER_SIZE = 32;
+
+/**
+ * Formats floating point value with the smallest precision in [minPrecision, maxPrecision]
+ * that parses back to the same value. Returns length of the NUL-terminated lexical form.
+ */
+template <class T>
+inline size_t formatFloatingPointLiteral(char *buffer, T value, int minPrecision, int maxPrecision)
+{
+    if (value != value)
+    {
+        std::memcpy(buffer, "NaN", 4);
+        return 3;
+    }
+    if (value > std::numeric_limits<T>::max())
+    {
+        std::memcpy(buffer, "INF", 4);
+        return 3;
+    }
+    if (value < -std::numeric_limits<T>::max())
+    {
+        std::memcpy(buffer, "-INF", 5);
+        return 4;
+    }
+
+    int length = 0;
+    for (int precision = minPrecision; precision <= maxPrecision; ++precision)
+    {
+        length = std::snprintf(buffer, NUMERIC_LITERAL_BUFFER_SIZE, "%.*g", precision, static_cast<double>(value));
+        if (precision == maxPrecision)
+            break;
+        char *end;
+        const T parsed = static_cast<T>(std::is_same<T, float>::value ? std::strtof(buffer, &end) : std::strtod(buffer, &end));
+        if (parsed == value)
+            break;
+    }
+
+    // snprintf uses the decimal point of the current C locale
+    const char point = *std::localeconv()->decimal_point;
+    if (point != '.')
+    {
+        char *p = static_cast<char *>(std::memchr(buffer, point, length));
+        if (p)
+            *p = '.';
+    }
+    return static_cast<size_t>(length);
+}
+
+/**
+ * Writes shortest lexical form of value that parses back to the same value into buffer
+ * of NUMERIC_LITERAL_BUFFER_SIZE characters. Returns length of the NUL-terminated string.
+ */
+inline size_t formatNumericLiteral(char *buffer, double value)
+{
+    return formatFloatingPointLiteral(buffer, value, std::numeric_limits<double>::digits10,
+                                      std::numeric_limits<double>::max_digits10);
+}
+
+inline size_t formatNumericLiteral(char *buffer, float value)
+{
+    return formatFloatingPointLiteral(buffer, value, std::numeric_limits<float>::digits10,
+                                      std::numeric_limits<float>::max_digits10);
+}
+
+template <class T>
+inline typename std::enable_if<std::is_integral<T>::value, size_t>::type
+formatNumericLiteral(char *buffer, T value)
+{
+    const int length = std::is_signed<T>::value ?
+        std::snprintf(buffer, NUMERIC_LITERAL_BUFFER_SIZE, "%lld", static_cast<long long>(value)) :
+        std::snprintf(buffer, NUMERIC_LITERAL_BUFFER_SIZE, "%llu", static_cast<unsigned long long>(value));
+    return static_cast<size_t>(length);
+}
+
+inline void trimNumericLiteral(const char *&first, const char *&last)
+{
+    while (first != last && (*first == ' ' || *first == '\t' || *first == '\n' || *first == '\r'))
+        ++first;
+    while (first != last && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\n' || last[-1] == '\r'))
+        --last;
+}
+
+/**
+ * Parses XSD lexical form in [first, last) into value. Like std::from_chars the whole
+ * range must be consumed, the result does not depend on the current C locale.
+ * Returns false on syntax errors and on values out of range of T.
+ */
+template <class T>
+inline typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+parseNumericLiteral(const char *first, const char *last, T &value)
+{
+    trimNumericLiteral(first, last);
+    const size_t length = static_cast<size_t>(last - first);
+    if (length == 0)
+        return false;
+
+    if ((length == 3 && std::memcmp(first, "INF", 3) == 0) || (length == 4 && std::memcmp(first, "+INF", 4) == 0))
+    {
+        value = std::numeric_limits<T>::infinity();
+        return true;
+    }
+    if (length == 4 && std::memcmp(first, "-INF", 4) == 0)
+    {
+        value = -std::numeric_limits<T>::infinity();
+        return true;
+    }
+    if (length == 3 && std::memcmp(first, "NaN", 3) == 0)
+    {
+        value = std::numeric_limits<T>::quiet_NaN();
+        return true;
+    }
+
+    // strtod would also accept hexadecimal and textual forms
+    for (const char *p = first; p != last; ++p)
+    {
+        if (!((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E' || *p == '+' || *p == '-'))
+            return false;
+    }
+
+    char buffer[64];
+    std::string longLiteral;
+    char *str = buffer;
+    if (length >= sizeof(buffer))
+    {
+        longLiteral.assign(first, length);
+        str = &longLiteral[0];
+    }
+    else
+    {
+        std::memcpy(buffer, first, length);
+        buffer[length] = '\0';
+    }
+
+    // strtod uses the decimal point of the current C locale
+    const char point = *std::localeconv()->decimal_point;
+    if (point != '.')
+    {
+        char *p = static_cast<char *>(std::memchr(str, '.', length));
+        if (p)
+            *p = point;
+    }
+
+    char *end;
+    errno = 0;
+    const T result = static_cast<T>(std::is_same<T, float>::value ? std::strtof(str, &end) : std::strtod(str, &end));
+    if (end != str + length)
+        return false;
+    // on overflow strto* return HUGE_VAL, on underflow the nearest representable value
+    if (errno == ERANGE && (result == std::numeric_limits<T>::infinity() || result == -std::numeric_limits<T>::infinity()))
+        return false;
+    value = result;
+    return true;
+}
+
+template <class T>
+inline typename std::enable_if<std::is_integral<T>::value, bool>::type
+parseNumericLiteral(const char *first, const char *last, T &value)
+{
+    trimNumericLiteral(first, last);
+    bool negative = false;
+    if (first != last && (*first == '+' || *first == '-'))
+    {
+        negative = *first == '-';
+        ++first;
+    }
+    if (first == last)
+        return false;
+
+    // magnitude of the minimum of a signed type is one more than its maximum
+    unsigned long long limit = static_cast<unsigned long long>(std::numeric_limits<T>::max());
+    if (negative)
+        limit = std::is_signed<T>::value ? limit + 1 : 0;
+    unsigned long long magnitude = 0;
+    for (; first != last; ++first)
+    {
+        if (*first < '0' || *first > '9')
+            return false;
+        const unsigned digit = static_cast<unsigned>(*first - '0');
+        if (magnitude > limit / 10 || (magnitude == limit / 10 && digit > limit % 10))
+            return false;
+        magnitude = magnitude * 10 + digit;
+    }
+
+    if (negative)
+        value = magnitude ? static_cast<T>(-static_cast<long long>(magnitude - 1) - 1) : T(0);
+    else
+        value = static_cast<T>(magnitude);
+    return true;
+}
+
+// Packed literals
+
+/**
+ * Vocabulary table of datatypes of packed literals. A packed literal holds all
+ * elements of an array or contiguous container as base64 encoded little-endian
+ * binary values, the datatype names the element type.
+ */
+struct PackedVocabulary
+{
+    enum
+    {
+        FLOAT64, FLOAT32,
+        INT8, INT16, INT32, INT64,
+        UINT8, UINT16, UINT32, UINT64
+    };
+
+    static const size_t size = UINT64 + 1;
+
+    static const char * term(size_t index)
+    {
+        static const char * const terms[size] = {
+            "packed:float64", "packed:float32",
+            "packed:int8", "packed:int16", "packed:int32", "packed:int64",
+            "packed:uint8", "packed:uint16", "packed:uint32", "packed:uint64"
+        };
+        return terms[index];
+    }
+
+    static const char * iri(size_t index)
+    {
+        static const char * const iris[size] = {
+            ARVIDA_PACKED_NS "float64", ARVIDA_PACKED_NS "float32",
+            ARVIDA_PACKED_NS "int8", ARVIDA_PACKED_NS "int16", ARVIDA_PACKED_NS "int32", ARVIDA_PACKED_NS "int64",
+            ARVIDA_PACKED_NS "uint8", ARVIDA_PACKED_NS "uint16", ARVIDA_PACKED_NS "uint32", ARVIDA_PACKED_NS "uint64"
+        };
+        return iris[index];
+    }
+};
+
+/**
+ * PackedElement<T>::packed_index is the index of the datatype of packed literals
+ * with elements of type T in PackedVocabulary.
+ */
+template <class T>
+struct PackedElement
+{
+    static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value,
+                  "Packed literals hold only numeric elements");
+    static_assert(std::is_integral<T>::value ? (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8)
+                                             : (sizeof(T) == 4 || sizeof(T) == 8),
+                  "Unsupported size of packed literal element");
+
+    static const size_t packed_index =
+        std::is_floating_point<T>::value
+            ? (sizeof(T) == 8 ? PackedVocabulary::FLOAT64 : PackedVocabulary::FLOAT32)
+            : (std::is_signed<T>::value ? PackedVocabulary::INT8 : PackedVocabulary::UINT8) +
+              (sizeof(T) == 1 ? 0 : sizeof(T) == 2 ? 1 : sizeof(T) == 4 ? 2 : 3);
+};
+
+inline bool isLittleEndian()
+{
+    const unsigned short one = 1;
+    unsigned char first;
+    std::memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+inline void reverseElementBytes(unsigned char *data, size_t count, size_t elementSize)
+{
+    for (size_t i = 0; i < count; ++i, data += elementSize)
+        std::reverse(data, data + elementSize);
+}
+
+/**
+ * Appends base64 encoding of size bytes at data to literal.
+ */
+inline void appendBase64(std::string &literal, const unsigned char *data, size_t size)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const size_t offset = literal.size();
+    literal.resize(offset + (size + 2) / 3 * 4);
+    char *out = &literal[offset];
+    size_t i = 0;
+    for (; i + 3 <= size; i += 3, out += 4)
+    {
+        const unsigned long bits = (unsigned long) data[i] << 16 | (unsigned long) data[i + 1] << 8 | data[i + 2];
+        out[0] = alphabet[bits >> 18];
+        out[1] = alphabet[(bits >> 12) & 63];
+        out[2] = alphabet[(bits >> 6) & 63];
+        out[3] = alphabet[bits & 63];
+    }
+    if (i < size)
+    {
+        const unsigned long bits = (unsigned long) data[i] << 16 | (i + 1 < size ? (unsigned long) data[i + 1] << 8 : 0);
+        out[0] = alphabet[bits >> 18];
+        out[1] = alphabet[(bits >> 12) & 63];
+        out[2] = i + 1 < size ? alphabet[(bits >> 6) & 63] : '=';
+        out[3] = '=';
+    }
+}
+
+/**
+ * Returns number of bytes encoded by base64 text [first, last), or size_t(-1)
+ * when the length of the text is invalid. Whitespace is not allowed.
+ */
+inline size_t base64DecodedSize(const char *first, const char *last)
+{
+    const size_t length = last - first;
+    if (length % 4 != 0)
+        return size_t(-1);
+    size_t padding = 0;
+    if (length && last[-1] == '=')
+        padding = last[-2] == '=' ? 2 : 1;
+    return length / 4 * 3 - padding;
+}
+
+/**
+ * Decodes base64 text [first, last) to base64DecodedSize(first, last) bytes at data,
+ * returns false on invalid characters.
+ */
+inline bool decodeBase64(const char *first, const char *last, unsigned char *data)
+{
+    struct Table
+    {
+        signed char values[256];
+
+        Table()
+        {
+            std::fill(values, values + 256, static_cast<signed char>(-1));
+            const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for (int i = 0; i < 64; ++i)
+                values[static_cast<unsigned char>(alphabet[i])] = static_cast<signed char>(i);
+        }
+    };
+    static const Table table;
+
+    for (; first != last; first += 4)
+    {
+        int digits[4];
+        size_t numDigits = 0;
+        for (; numDigits < 4 && first[numDigits] != '='; ++numDigits)
+        {
+            digits[numDigits] = table.values[static_cast<unsigned char>(first[numDigits])];
+            if (digits[numDigits] < 0)
+                return false;
+        }
+        // Padding is only allowed in the last group
+        if (numDigits < 2 || (numDigits < 4 && first + 4 != last))
+            return false;
+        for (size_t i = numDigits; i < 4; ++i)
+        {
+            if (first[i] != '=')
+                return false;
+            digits[i] = 0;
+        }
+        const unsigned long bits = (unsigned long) digits[0] << 18 | (unsigned long) digits[1] << 12 |
+                                   (unsigned long) digits[2] << 6 | (unsigned long) digits[3];
+        *data++ = static_cast<unsigned char>(bits >> 16);
+        if (numDigits > 2)
+            *data++ = static_cast<unsigned char>(bits >> 8);
+        if (numDigits > 3)
+            *data++ = static_cast<unsigned char>(bits);
+    }
+    return true;
+}
+
+/**
+ * Replaces literal by the packed encoding of count values, returns the index of its
+ * datatype in PackedVocabulary.
+ */
+template <class T>
+inline size_t encodePackedLiteral(const T *values, size_t count, std::string &literal)
+{
+    literal.clear();
+    const unsigned char *data = reinterpret_cast<const unsigned char *>(values);
+    if (isLittleEndian() || sizeof(T) == 1)
+    {
+        appendBase64(literal, data, count * sizeof(T));
+    }
+    else
+    {
+        std::vector<unsigned char> swapped(data, data + count * sizeof(T));
+        reverseElementBytes(swapped.data(), count, sizeof(T));
+        appendBase64(literal, swapped.data(), swapped.size());
+    }
+    return PackedElement<T>::packed_index;
+}
+
+template <class T>
+inline size_t encodePackedLiteral(const std::vector<T> &values, std::string &literal)
+{
+    return encodePackedLiteral(values.data(), values.size(), literal);
+}
+
+template <class T, size_t N>
+inline size_t encodePackedLiteral(const std::array<T, N> &values, std::string &literal)
+{
+    return encodePackedLiteral(values.data(), N, literal);
+}
+
+template <class T, size_t N>
+inline size_t encodePackedLiteral(const T (&values)[N], std::string &literal)
+{
+    return encodePackedLiteral(values, N, literal);
+}
+
+/**
+ * Decodes packed literal [first, last) with exactly count elements into values.
+ */
+template <class T>
+inline bool decodePackedLiteral(const char *first, const char *last, T *values, size_t count)
+{
+    if (base64DecodedSize(first, last) != count * sizeof(T))
+        return false;
+    unsigned char *data = reinterpret_cast<unsigned char *>(values);
+    if (!decodeBase64(first, last, data))
+        return false;
+    if (!isLittleEndian() && sizeof(T) > 1)
+        reverseElementBytes(data, count, sizeof(T));
+    return true;
+}
+
+template <class T>
+inline bool decodePackedLiteral(const char *first, const char *last, std::vector<T> &values)
+{
+    const size_t size = base64DecodedSize(first, last);
+    if (size == size_t(-1) || size % sizeof(T) != 0)
+        return false;
+    values.resize(size / sizeof(T));
+    return decodePackedLiteral(first, last, values.data(), values.size());
+}
+
+template <class T, size_t N>
+inline bool decodePackedLiteral(const char *first, const char *last, std::array<T, N> &values)
+{
+    return decodePackedLiteral(first, last, values.data(), N);
+}
+
+template <class T, size_t N>
+inline bool decodePackedLiteral(const char *first, const char *last, T (&values)[N])
+{
+    return decodePackedLiteral(first, last, values, N);
+}
+
+/**
+ * PackedContainer<C>::packed_index is the PackedVocabulary index of packed literals
+ * of container C.
+ */
+template <class C>
+struct PackedContainer;
+
+template <class T>
+struct PackedContainer<std::vector<T> > : PackedElement<T> { };
+
+template <class T, size_t N>
+struct PackedContainer<std::array<T, N> > : PackedElement<T> { };
+
+template <class T, size_t N>
+struct PackedContainer<T[N]> : PackedElement<T> { };
+
+// Delta serialization
+
+inline size_t nextDeltaClassId()
+{
+    static std::atomic<size_t> counter(0);
+    return counter++;
+}
+
+/**
+ * Identifier of class T in delta snapshots, keeps snapshots of base classes of
+ * one subject apart.
+ */
+template <class T>
+inline size_t deltaClassId()
+{
+    static const size_t id = nextDeltaClassId();
+    return id;
+}
+
+/**
+ * Returns true when value differs from snapshot and stores value in snapshot.
+ * Only arithmetic values and strings are compared, other values are always
+ * reported as changed and are compared by their statements.
+ */
+template <class T>
+inline typename std::enable_if<std::is_arithmetic<T>::value, bool>::type
+deltaValueChanged(std::string &snapshot, const T &value)
+{
+    const char *bytes = reinterpret_cast<const char *>(&value);
+    if (snapshot.size() == sizeof(T) && std::memcmp(snapshot.data(), bytes, sizeof(T)) == 0)
+        return false;
+    snapshot.assign(bytes, sizeof(T));
+    return true;
+}
+
+inline bool deltaValueChanged(std::string &snapshot, const std::string &value)
+{
+    if (snapshot == value)
+        return false;
+    snapshot = value;
+    return true;
+}
+
+#ifdef ARVIDA_RDF_HAS_STRING_VIEW
+inline bool deltaValueChanged(std::string &snapshot, const std::string_view &value)
+{
+    if (snapshot == value)
+        return false;
+    snapshot.assign(value.data(), value.size());
+    return true;
+}
+#endif
+
+template <class T>
+inline typename std::enable_if<!std::is_arithmetic<T>::value, bool>::type
+deltaValueChanged(std::string &snapshot, const T &value)
+{
+    return true;
+}
+
+/**
+ * True for literal values, which toRDFDelta serializes with toRDF. Other values need
+ * a toRDFDelta overload, e.g. generated with --delta, so that their statements are
+ * compared with the snapshot instead of being written to the model.
+ */
+template <class T>
+struct DeltaLiteral : std::integral_constant<bool, std::is_arithmetic<T>::value> { };
+
+template <>
+struct DeltaLiteral<std::string> : std::true_type { };
+
+#ifdef ARVIDA_RDF_HAS_STRING_VIEW
+template <>
+struct DeltaLiteral<std::string_view> : std::true_type { };
+#endif
+
+// Instrumentation
+
+/**
+ * Counters of one instrumentation scope, a generated class or member. Counts are
+ * exclusive, they belong to the innermost scope, times include nested scopes.
+ */
+struct InstrumentationCounters
+{
+    unsigned long long calls;
+    unsigned long long nanoseconds;
+    unsigned long long statements;
+    unsigned long long nodes;
+    unsigned long long paths;
+    unsigned long long lookups;
+    unsigned long long lookup_misses;
+    unsigned long long cache_hits;
+    unsigned long long literal_parses;
+    // Bytes of created URIs and literals
+    unsigned long long bytes;
+
+    InstrumentationCounters()
+        : calls(0), nanoseconds(0), statements(0), nodes(0), paths(0), lookups(0)
+        , lookup_misses(0), cache_hits(0), literal_parses(0), bytes(0)
+    { }
+
+    InstrumentationCounters & operator+=(const InstrumentationCounters &other)
+    {
+        calls += other.calls;
+        nanoseconds += other.nanoseconds;
+        statements += other.statements;
+        nodes += other.nodes;
+        paths += other.paths;
+        lookups += other.lookups;
+        lookup_misses += other.lookup_misses;
+        cache_hits += other.cache_hits;
+        literal_parses += other.literal_parses;
+        bytes += other.bytes;
+        return *this;
+    }
+};
+
+inline std::mutex & instrumentationScopeMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+inline std::deque<std::string> & instrumentationScopeNames()
+{
+    static std::deque<std::string> names(1, std::string());
+    return names;
+}
+
+/**
+ * Identifier of the scope name, generated code keeps it in a static variable.
+ * Identifier 0 is the scope outside of generated functions.
+ */
+inline size_t instrumentationScopeId(const char *name)
+{
+    std::lock_guard<std::mutex> lock(instrumentationScopeMutex());
+    std::deque<std::string> &names = instrumentationScopeNames();
+    for (size_t i = 0; i < names.size(); ++i)
+        if (names[i] == name)
+            return i;
+    names.push_back(name);
+    return names.size() - 1;
+}
+
+inline std::string instrumentationScopeName(size_t id)
+{
+    std::lock_guard<std::mutex> lock(instrumentationScopeMutex());
+    return instrumentationScopeNames()[id];
+}
+
+/**
+ * Counters per scope. Set ContextState::instrumentation to collect counters of all
+ * contexts sharing the state. Counting is compiled only with
+ * ARVIDA_RDF_INSTRUMENTATION defined, an Instrumentation is not thread-safe.
+ */
+class Instrumentation
+{
+public:
+    Instrumentation() : current_(0) { }
+
+    InstrumentationCounters & current() { return at(current_); }
+
+    InstrumentationCounters & at(size_t id)
+    {
+        if (id >= scopes_.size())
+            scopes_.resize(id + 1);
+        return scopes_[id];
+    }
+
+    // Makes id the current scope, returns the previous one
+    size_t enter(size_t id)
+    {
+        const size_t previous = current_;
+        current_ = id;
+        ++at(id).calls;
+        return previous;
+    }
+
+    void leave(size_t id, size_t previous, unsigned long long nanoseconds)
+    {
+        at(id).nanoseconds += nanoseconds;
+        current_ = previous;
+    }
+
+    void reset()
+    {
+        scopes_.clear();
+        current_ = 0;
+    }
+
+    InstrumentationCounters total() const
+    {
+        InstrumentationCounters result;
+        for (const auto &it : scopes_)
+        {
+            const unsigned long long nanoseconds = result.nanoseconds;
+            result += it;
+            // times of nested scopes are already included
+            result.nanoseconds = nanoseconds;
+        }
+        return result;
+    }
+
+    /**
+     * Export hook, calls f(name, counters) for all scopes with counts.
+     */
+    template <class F>
+    void visit(F f) const
+    {
+        for (size_t i = 0; i < scopes_.size(); ++i)
+        {
+            const InstrumentationCounters &counters = scopes_[i];
+            if (counters.calls || counters.statements || counters.nodes || counters.lookups)
+                f(instrumentationScopeName(i), counters);
+        }
+    }
+
+    // Writes the counters as tab separated table
+    void dump(std::FILE *out) const
+    {
+        std::fprintf(out, "scope\tcalls\tms\tstatements\tnodes\tpaths\tlookups\tlookup_misses"
+                          "\tcache_hits\tliteral_parses\tbytes\n");
+        visit([out](const std::string &name, const InstrumentationCounters &c)
+        {
+            std::fprintf(out, "%s\t%llu\t%.3f\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\n",
+                         name.empty() ? "-" : name.c_str(), c.calls, c.nanoseconds / 1e6, c.statements,
+                         c.nodes, c.paths, c.lookups, c.lookup_misses, c.cache_hits, c.literal_parses, c.bytes);
+        });
+    }
+
+private:
+    std::vector<InstrumentationCounters> scopes_;
+    size_t current_;
+};
+
+/**
+ * Makes a scope current while it exists and adds its lifetime to the scope time.
+ */
+class InstrumentationScope
+{
+public:
+    InstrumentationScope(Instrumentation *instrumentation, size_t id)
+        : instrumentation_(instrumentation), id_(id), previous_(0)
+    {
+        if (instrumentation_)
+        {
+            previous_ = instrumentation_->enter(id_);
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~InstrumentationScope()
+    {
+        if (instrumentation_)
+        {
+            const auto elapsed = std::chrono::steady_clock::now() - start_;
+            instrumentation_->leave(id_, previous_,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+    }
+
+    InstrumentationScope(const InstrumentationScope &) = delete;
+    InstrumentationScope & operator=(const InstrumentationScope &) = delete;
+
+private:
+    Instrumentation *instrumentation_;
+    size_t id_;
+    size_t previous_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#define ARVIDA_RDF_INSTRUMENTATION_CONCAT_(a, b) a##b
+#define ARVIDA_RDF_INSTRUMENTATION_CONCAT(a, b) ARVIDA_RDF_INSTRUMENTATION_CONCAT_(a, b)
+
+#ifdef ARVIDA_RDF_INSTRUMENTATION
+
+// Adds n to counter of the current scope of the instrumentation of ctx
+#define ARVIDA_RDF_COUNT(ctx, counter, n)                                       \
+    do {                                                                        \
+        if (Arvida::RDF::Instrumentation *_instrumentation = (ctx).state->instrumentation) \
+            _instrumentation->current().counter += (n);                         \
+    } while (0)
+
+// Makes name the current scope until the end of the enclosing block
+#define ARVIDA_RDF_SCOPE(ctx, name)                                             \
+    static const size_t ARVIDA_RDF_INSTRUMENTATION_CONCAT(_arvida_scope_id_, __LINE__) = \
+        Arvida::RDF::instrumentationScopeId(name);                              \
+    Arvida::RDF::InstrumentationScope ARVIDA_RDF_INSTRUMENTATION_CONCAT(_arvida_scope_, __LINE__)( \
+        (ctx).state->instrumentation, ARVIDA_RDF_INSTRUMENTATION_CONCAT(_arvida_scope_id_, __LINE__))
+
+#else
+
+#define ARVIDA_RDF_COUNT(ctx, counter, n) do { } while (0)
+#define ARVIDA_RDF_SCOPE(ctx, name) do { } while (0)
+
+#endif
+
+// Batches
+
+/**
+ * Number of workers used for a batch of count objects, num_workers == 0 selects
+ * one worker per hardware thread.
+ */
+inline size_t batchWorkerCount(size_t count, size_t num_workers)
+{
+    if (num_workers == 0)
+        num_workers = std::thread::hardware_concurrency();
+    if (num_workers == 0)
+        num_workers = 1;
+    return std::max<size_t>(1, std::min(count, num_workers));
+}
+
+/**
+ * Shards per worker of a batch. Finished shards are merged on the calling thread
+ * while the workers serialize the following shards.
+ */
+const size_t BATCH_SHARDS_PER_WORKER = 4;
+
+/**
+ * Number of shards of a batch of count objects serialized by num_workers workers.
+ */
+inline size_t batchShardCount(size_t count, size_t num_workers)
+{
+    return num_workers <= 1 ? 1 : std::min(count, num_workers * BATCH_SHARDS_PER_WORKER);
+}
+
+/**
+ * Calls shard(index, begin, end) for num_shards contiguous shards of [0, count) on
+ * num_workers threads, one of them is the calling thread. finished(index) is called
+ * on the calling thread for each shard in order of completion, while the other
+ * threads continue with the following shards; the calling thread serializes a shard
+ * only when no finished shard is waiting. finished is not called for shards that
+ * threw. The first exception thrown by a shard or by finished is rethrown after all
+ * threads are finished.
+ */
+template <class F, class G>
+void runShards(size_t count, size_t num_workers, size_t num_shards, F shard, G finished)
+{
+    std::vector<std::exception_ptr> errors(num_shards);
+    std::exception_ptr finish_error;
+    std::mutex mutex;
+    std::condition_variable ready_changed;
+    std::deque<size_t> ready;
+    // Number of shards taken by a thread, no more shards are taken after finish failed
+    size_t next = 0;
+    bool stopped = false;
+
+    auto run = [&](size_t index)
+    {
+        try
+        {
+            shard(index, count * index / num_shards, count * (index + 1) / num_shards);
+        }
+        catch (...)
+        {
+            errors[index] = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.push_back(index);
+        ready_changed.notify_one();
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_workers - 1);
+    for (size_t worker = 1; worker < num_workers; ++worker)
+    {
+        threads.emplace_back([&]()
+        {
+            for (;;)
+            {
+                size_t index;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (stopped || next == num_shards)
+                        return;
+                    index = next++;
+                }
+                run(index);
+            }
+        });
+    }
+
+    size_t done = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+        if (!ready.empty())
+        {
+            const size_t index = ready.front();
+            ready.pop_front();
+            ++done;
+            lock.unlock();
+            if (!errors[index] && !finish_error)
+            {
+                try
+                {
+                    finished(index);
+                }
+                catch (...)
+                {
+                    finish_error = std::current_exception();
+                }
+            }
+            lock.lock();
+            if (finish_error)
+                stopped = true;
+        }
+        else if (!stopped && next < num_shards)
+        {
+            // No finished shard is waiting, serialize the next one on this thread
+            const size_t index = next++;
+            lock.unlock();
+            run(index);
+            lock.lock();
+        }
+        else if (done < next)
+            ready_changed.wait(lock);
+        else
+            break;
+    }
+    lock.unlock();
+
+    for (auto &thread : threads)
+        thread.join();
+
+    if (finish_error)
+        std::rethrow_exception(finish_error);
+    for (auto &error : errors)
+        if (error)
+            std::rethrow_exception(error);
+}
+
+
+// Pipelines
+
+/**
+ * Receives the serialized bytes of one buffer on the thread of a Pipeline.
+ */
+typedef std::function<void (const std::string &data)> PipelineSink;
+
+#if defined(__unix__) || defined(__APPLE__)
+
+/**
+ * Returns a sink that writes all data to file descriptor fd, which is not closed.
+ * Throws std::system_error when the write fails.
+ */
+inline PipelineSink fileDescriptorSink(int fd)
+{
+    return [fd](const std::string &data)
+    {
+        const char *p = data.data();
+        size_t remaining = data.size();
+        while (remaining)
+        {
+            const ssize_t n = ::write(fd, p, remaining);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw std::system_error(errno, std::generic_category(), "write");
+            }
+            p += n;
+            remaining -= static_cast<size_t>(n);
+        }
+    };
+}
+
+#endif
+
+/**
+ * Serializes filled buffers on a background thread while the producer fills the
+ * next one.
+ *
+ * Buffer must provide void serialize(std::string &data), which is called on the
+ * pipeline thread, and void clear(), which prepares the buffer for the next use.
+ * Buffers are created on the constructing thread and must not share state that is
+ * not thread safe, e.g. RDF worlds. The producer takes
+ * a free buffer with acquire() or tryAcquire(), fills it and passes it to submit();
+ * buffers are serialized and passed to the sink in the order of submission. With
+ * num_buffers buffers at most num_buffers - 1 buffers wait while one is filled:
+ * acquire() blocks until a buffer is free and tryAcquire() returns null, so a
+ * producer that must not block can drop its update instead.
+ */
+template <class Buffer>
+class Pipeline
+{
+public:
+
+    // Called on the pipeline thread after a buffer was passed to the sink and returned
+    // to the free buffers, error is the exception thrown by serialize(), the sink or
+    // clear(), if any. A completion may call close() but not flush().
+    typedef std::function<void (std::exception_ptr error)> Completion;
+
+    // Creates num_buffers buffers (at least one) with Buffer(args...)
+    template <class... Args>
+    Pipeline(PipelineSink sink, size_t num_buffers, Args &&... args)
+        : sink_(std::move(sink)), busy_(false), closed_(false)
+    {
+        num_buffers = std::max<size_t>(num_buffers, 1);
+        buffers_.reserve(num_buffers);
+        for (size_t i = 0; i < num_buffers; ++i)
+        {
+            buffers_.emplace_back(new Buffer(args...));
+            free_.push_back(buffers_.back().get());
+        }
+        thread_ = std::thread(&Pipeline::run, this);
+        thread_id_ = thread_.get_id();
+    }
+
+    Pipeline(const Pipeline &) = delete;
+    Pipeline & operator=(const Pipeline &) = delete;
+
+    // Serializes all submitted buffers before returning
+    ~Pipeline()
+    {
+        close();
+    }
+
+    // Waits until a buffer is free
+    Buffer & acquire()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        freed_.wait(lock, [this] { return !free_.empty(); });
+        return takeFree();
+    }
+
+    // Returns null when all buffers are in use
+    Buffer * tryAcquire()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.empty())
+            return 0;
+        return &takeFree();
+    }
+
+    /**
+     * Queues buffer acquired from this pipeline for serialization. The future is
+     * ready when the data was passed to the sink and the buffer is free again, so
+     * tryAcquire() after get() does not fail for lack of buffers. It holds the exception of a failed
+     * serialization. After close() the buffer is released, the future holds a
+     * std::logic_error and completion is called on the calling thread.
+     */
+    std::future<void> submit(Buffer &buffer, Completion completion = Completion())
+    {
+        Job job;
+        job.buffer = &buffer;
+        job.completion = std::move(completion);
+        std::future<void> result = job.done.get_future();
+        bool queued = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!closed_)
+            {
+                queue_.push_back(std::move(job));
+                queued = true;
+            }
+        }
+        if (queued)
+        {
+            queued_.notify_one();
+            return result;
+        }
+
+        const std::exception_ptr error = std::make_exception_ptr(std::logic_error("Pipeline is closed"));
+        release(buffer);
+        job.done.set_exception(error);
+        if (job.completion)
+            job.completion(error);
+        return result;
+    }
+
+    // Returns a buffer acquired from this pipeline without serializing it
+    void release(Buffer &buffer)
+    {
+        buffer.clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_.push_back(&buffer);
+        }
+        freed_.notify_one();
+    }
+
+    // Waits until all submitted buffers are serialized
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this] { return queue_.empty() && !busy_; });
+    }
+
+    // Serializes all submitted buffers and stops the thread, buffers can not be
+    // submitted afterwards. Called from a completion it returns at once, the thread
+    // stops after the queued buffers and is joined by the next close() or the destructor.
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        queued_.notify_one();
+        if (std::this_thread::get_id() == thread_id_)
+            return;
+        std::lock_guard<std::mutex> lock(join_mutex_);
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+    // Number of buffers waiting for serialization, including the one being serialized
+    size_t pending() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return queue_.size() + (busy_ ? 1 : 0);
+    }
+
+    size_t numBuffers() const { return buffers_.size(); }
+
+private:
+
+    struct Job
+    {
+        Buffer *buffer;
+        Completion completion;
+        std::promise<void> done;
+    };
+
+    Buffer & takeFree()
+    {
+        Buffer *buffer = free_.back();
+        free_.pop_back();
+        return *buffer;
+    }
+
+    void run()
+    {
+        std::string data;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;)
+        {
+            queued_.wait(lock, [this] { return closed_ || !queue_.empty(); });
+            if (queue_.empty())
+                break;
+            Job job = std::move(queue_.front());
+            queue_.pop_front();
+            busy_ = true;
+            lock.unlock();
+
+            std::exception_ptr error;
+            try
+            {
+                data.clear();
+                job.buffer->serialize(data);
+                sink_(data);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+            try
+            {
+                job.buffer->clear();
+            }
+            catch (...)
+            {
+                if (!error)
+                    error = std::current_exception();
+            }
+
+            // The buffer is free before the producer learns that it was serialized
+            lock.lock();
+            free_.push_back(job.buffer);
+            freed_.notify_one();
+            lock.unlock();
+
+            if (error)
+                job.done.set_exception(error);
+            else
+                job.done.set_value();
+            if (job.completion)
+                job.completion(error);
+
+            lock.lock();
+            busy_ = false;
+            if (queue_.empty())
+                idle_.notify_all();
+        }
+    }
+
+    PipelineSink sink_;
+    std::vector<std::unique_ptr<Buffer> > buffers_;
+    std::vector<Buffer *> free_;
+    std::deque<Job> queue_;
+    mutable std::mutex mutex_;
+    std::condition_variable queued_;
+    std::condition_variable freed_;
+    std::condition_variable idle_;
+    bool busy_;
+    bool closed_;
+    std::thread thread_;
+    std::thread::id thread_id_;
+    // Serializes joining of thread_ by concurrent close() calls
+    std::mutex join_mutex_;
+};
+
+} // namespace RDF
+} // namespace Arvida
+
+#endif
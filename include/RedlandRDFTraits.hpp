@@ -19,11 +19,15 @@
 #define REDLAND_RDF_TRAITS_HPP_INCLUDED
 
 #include "redland.hpp"
+#include "RDFTraitsCommon.hpp"
 #include <memory>
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <boost/any.hpp>
+#include <cstring>
+#include <algorithm>
 
 namespace Arvida
 {
@@ -35,6 +39,184 @@ typedef Redland::Node * NodePtr;
 typedef Redland::Node & NodeRef;
 typedef std::unordered_map<std::string, boost::any> Cache;
 
+// Redland nodes are not interned, the hash is computed from URI, blank identifier or literal value
+struct NodeCacheHash
+{
+    size_t operator()(const Redland::Node &node) const
+    {
+        librdf_node *n = node.c_obj();
+        if (!n)
+            return 0;
+        size_t length = 0;
+        const unsigned char *str = 0;
+        if (librdf_node_is_resource(n))
+            str = librdf_uri_as_counted_string(librdf_node_get_uri(n), &length);
+        else if (librdf_node_is_blank(n))
+            str = librdf_node_get_counted_blank_identifier(n, &length);
+        else
+            str = librdf_node_get_literal_value_as_counted_string(n, &length);
+
+        // FNV-1a
+        size_t h = static_cast<size_t>(2166136261U);
+        for (size_t i = 0; i < length; ++i)
+            h = (h ^ str[i]) * static_cast<size_t>(16777619U);
+        return h;
+    }
+};
+
+struct NodeCacheEqual
+{
+    bool operator()(const Redland::Node &a, const Redland::Node &b) const
+    {
+        if (!a.c_obj() || !b.c_obj())
+            return a.c_obj() == b.c_obj();
+        return librdf_node_equals(a.c_obj(), b.c_obj()) != 0;
+    }
+};
+
+/**
+ * Typed cache of values per node, e.g. objects created by create_element hooks.
+ * Unlike Cache lookups do not hash strings or use boost::any_cast.
+ */
+typedef TypedCache<Redland::Node, NodeCacheHash, NodeCacheEqual> NodeCache;
+
+// Vocabulary
+
+/**
+ * Per-World cache of vocabulary nodes. Prefixed names of a table without resolved
+ * IRI are expanded with the runtime namespaces on the first access of the table,
+ * so all prefixes must be added before the first serialization.
+ */
+class Vocabulary
+{
+public:
+
+    Vocabulary(Redland::World &world, const Redland::Namespaces &namespaces)
+        : world_(world), namespaces_(namespaces)
+    {
+    }
+
+    template <class Table>
+    const Redland::Node & get(size_t index)
+    {
+        const size_t id = vocabularyTableId<Table>();
+        if (id >= tables_.size())
+            tables_.resize(id + 1);
+        std::vector<Redland::Node> &nodes = tables_[id];
+        if (nodes.empty())
+        {
+            nodes.reserve(Table::size);
+            for (size_t i = 0; i < Table::size; ++i)
+            {
+                if (const char *iri = Table::iri(i))
+                    nodes.push_back(Redland::Node::make_uri_node(world_, iri));
+                else
+                    nodes.push_back(Redland::Node::make_uri_node(world_, namespaces_.expand(Table::term(i))));
+            }
+        }
+        return nodes[index];
+    }
+
+private:
+    Redland::World &world_;
+    const Redland::Namespaces &namespaces_;
+    std::vector<std::vector<Redland::Node> > tables_;
+};
+
+/**
+ * Factory of typed literals of a ContextState. Datatype URIs of XsdVocabulary are
+ * taken from the vocabulary nodes once and are owned by them, so the factory lives
+ * next to the vocabulary; literals are created from counted strings.
+ */
+class LiteralFactory
+{
+public:
+
+    LiteralFactory(Redland::World &world, Vocabulary &vocabulary)
+        : world_(world), vocabulary_(vocabulary)
+    {
+        std::fill(datatypes_, datatypes_ + XsdVocabulary::size, static_cast<librdf_uri *>(0));
+    }
+
+    LiteralFactory(const LiteralFactory &other) = delete;
+    LiteralFactory & operator=(const LiteralFactory &other) = delete;
+
+    // URI of the XsdVocabulary datatype, owned by the vocabulary
+    librdf_uri * datatype(size_t xsd_index)
+    {
+        librdf_uri *&uri = datatypes_[xsd_index];
+        if (!uri)
+            uri = librdf_node_get_uri(vocabulary_.get<XsdVocabulary>(xsd_index).c_obj());
+        return uri;
+    }
+
+    Redland::Node typed(const char *value, size_t length, size_t xsd_index)
+    {
+        return Redland::Node::make_typed_literal_node(world_, value, length, datatype(xsd_index));
+    }
+
+    Redland::Node string(const std::string &value)
+    {
+        return typed(value.data(), value.size(), XsdVocabulary::STRING);
+    }
+
+private:
+    Redland::World &world_;
+    Vocabulary &vocabulary_;
+    librdf_uri *datatypes_[XsdVocabulary::size];
+};
+
+typedef std::unordered_set<std::string, std::hash<std::string>, std::equal_to<std::string>,
+                           PoolAllocator<std::string> > VisitedNodes;
+typedef std::unordered_map<const void *, Redland::Node, std::hash<const void *>, std::equal_to<const void *>,
+                           PoolAllocator<std::pair<const void * const, Redland::Node> > > SharedNodes;
+
+/**
+ * State shared by all contexts derived from one root context. Pass the same state
+ * to all root contexts of a World to reuse cached nodes between serializations.
+ * Each root context resets the per-serialization members.
+ */
+struct ContextState
+{
+    Vocabulary vocabulary;
+    LiteralFactory literals;
+
+    // Elements of visited and shared, the memory is reused by following serializations
+    NodePool pool;
+    // URIs and blank identifiers of nodes used in statements of the current root context
+    VisitedNodes visited;
+    // Nodes of shared objects serialized by the current root context
+    SharedNodes shared;
+    // Model was not empty when the root context was created, visited nodes are not complete
+    bool check_model;
+    // Paths of derived contexts
+    PathBuffers paths;
+    // Not reset by begin(), values stay cached while the state is shared
+    NodeCache node_cache;
+    // Counters of generated code and traits, used with ARVIDA_RDF_INSTRUMENTATION
+    Instrumentation *instrumentation;
+    // Reused for encoding packed literals
+    std::string literal_buffer;
+    // Blank nodes of root contexts that serialize into an empty model
+    BlankNodePool<Redland::Node> blanks;
+
+    ContextState(Redland::World &world, const Redland::Namespaces &namespaces)
+        : vocabulary(world, namespaces), literals(world, vocabulary),
+          visited(0, VisitedNodes::hasher(), VisitedNodes::key_equal(), VisitedNodes::allocator_type(pool)),
+          shared(0, SharedNodes::hasher(), SharedNodes::key_equal(), SharedNodes::allocator_type(pool)),
+          check_model(false), instrumentation(0)
+    {
+    }
+
+    void begin(Redland::Model &model)
+    {
+        visited.clear();
+        shared.clear();
+        check_model = librdf_model_size(model.c_obj()) != 0;
+        blanks.begin(!check_model);
+    }
+};
+
 struct Context
 {
     Redland::World &world;
@@ -44,31 +226,82 @@ struct Context
     const std::string &path;
     Cache *cache;
     const void *user_data;
+    ContextState *state;
+    // Nesting depth of derived contexts, selects buffer in ContextState::paths
+    size_t depth;
 
 
     Context(Redland::World &world, Redland::Namespaces &namespaces, Redland::Model &model, const std::string &base_path,
-            const std::string &path, Cache *cache = 0, const void *user_data = 0)
-        : world(world), namespaces(namespaces), model(model), base_path(base_path), path(path), cache(cache), user_data(user_data)
+            const std::string &path, Cache *cache = 0, const void *user_data = 0, ContextState *state = 0)
+        : world(world), namespaces(namespaces), model(model), base_path(base_path), path(path), cache(cache), user_data(user_data), state(state), depth(0)
     {
+        initState();
     }
 
     Context(Redland::World &world, Redland::Namespaces &namespaces, Redland::Model &model, const std::string &path,
-            Cache *cache = 0, const void *user_data = 0)
-        : world(world), namespaces(namespaces), model(model), base_path(path), path(path), cache(cache), user_data(user_data)
+            Cache *cache = 0, const void *user_data = 0, ContextState *state = 0)
+        : world(world), namespaces(namespaces), model(model), base_path(path), path(path), cache(cache), user_data(user_data), state(state), depth(0)
     {
+        initState();
     }
 
     Context(const Context &ctx)
-        : world(ctx.world), namespaces(ctx.namespaces), model(ctx.model), base_path(ctx.base_path), path(ctx.path), cache(ctx.cache), user_data(ctx.user_data)
+        : world(ctx.world), namespaces(ctx.namespaces), model(ctx.model), base_path(ctx.base_path), path(ctx.path), cache(ctx.cache), user_data(ctx.user_data), state(ctx.state), depth(ctx.depth), ownState_(ctx.ownState_)
     {
     }
 
     Context(const Context &ctx, const std::string &path)
-        : world(ctx.world), namespaces(ctx.namespaces), model(ctx.model), base_path(ctx.base_path), path(path), cache(ctx.cache), user_data(ctx.user_data)
+        : world(ctx.world), namespaces(ctx.namespaces), model(ctx.model), base_path(ctx.base_path), path(path), cache(ctx.cache), user_data(ctx.user_data), state(ctx.state), depth(ctx.depth + 1)
     {
     }
+
+private:
+    void initState()
+    {
+        if (!state)
+        {
+            ownState_.reset(new ContextState(world, namespaces));
+            state = ownState_.get();
+        }
+        state->begin(model);
+    }
+
+    // Shared with copies of a root context, which may outlive the original
+    std::shared_ptr<ContextState> ownState_;
 };
 
+template <class Table>
+inline const Redland::Node & vocabularyNode(const Context &ctx, size_t index)
+{
+    return ctx.state->vocabulary.get<Table>(index);
+}
+
+inline NodeCache & nodeCache(const Context &ctx)
+{
+    return ctx.state->node_cache;
+}
+
+/**
+ * Returns a new blank node. Blank nodes of a root context that started with an empty
+ * model are labeled n0, n1, ... in order of creation and are reused from
+ * ContextState::blanks, otherwise librdf generates a unique identifier.
+ */
+inline Redland::Node blankNode(const Context &ctx)
+{
+    BlankNodePool<Redland::Node> &blanks = ctx.state->blanks;
+    if (!blanks.deterministic())
+        return Redland::Node::make_blank_node(ctx.world);
+    return blanks.next([&ctx](const std::string &label)
+    {
+        return Redland::Node(ctx.world, label.c_str(), Redland::blank_node_t());
+    });
+}
+
+inline LiteralFactory & literals(const Context &ctx)
+{
+    return ctx.state->literals;
+}
+
 struct Triple
 {
     Redland::Node subject;
@@ -112,6 +345,94 @@ struct Triple
     }
 };
 
+/**
+ * Lazy range over the statements of model matching a pattern, nodes are only
+ * copied when they are accessed with get_subject/predicate/object.
+ * Redland::Node() in the pattern matches any node.
+ */
+class TripleRange
+{
+public:
+
+    class iterator
+    {
+    public:
+        iterator() : range_(0) { }
+
+        Redland::Node get_subject() const { return copy(librdf_statement_get_subject(statement())); }
+        Redland::Node get_predicate() const { return copy(librdf_statement_get_predicate(statement())); }
+        Redland::Node get_object() const { return copy(librdf_statement_get_object(statement())); }
+
+        const iterator & operator*() const { return *this; }
+        const iterator * operator->() const { return this; }
+
+        iterator & operator++()
+        {
+            if (librdf_stream_next(range_->stream_))
+                range_ = 0;
+            return *this;
+        }
+
+        bool operator==(const iterator &other) const { return range_ == other.range_; }
+        bool operator!=(const iterator &other) const { return range_ != other.range_; }
+
+    private:
+        friend class TripleRange;
+
+        explicit iterator(const TripleRange *range) : range_(range) { }
+
+        librdf_statement * statement() const
+        {
+            return librdf_stream_get_object(range_->stream_);
+        }
+
+        static Redland::Node copy(librdf_node *node)
+        {
+            return Redland::Node(node ? librdf_new_node_from_node(node) : NULL);
+        }
+
+        const TripleRange *range_;
+    };
+
+    TripleRange(Redland::World &world, Redland::Model &model,
+                const Redland::Node &subject, const Redland::Node &predicate, const Redland::Node &object)
+        : model_(model)
+        , pattern_(world, subject, predicate, object)
+        , stream_(librdf_model_find_statements(model.c_obj(), pattern_.c_obj()))
+    {
+    }
+
+    TripleRange(const TripleRange &) = delete;
+    TripleRange & operator=(const TripleRange &) = delete;
+
+    ~TripleRange()
+    {
+        if (stream_)
+            librdf_free_stream(stream_);
+    }
+
+    bool empty() const { return !stream_ || librdf_stream_end(stream_); }
+
+    // Single pass, begin() returns the current position
+    iterator begin() const { return empty() ? iterator() : iterator(this); }
+    iterator end() const { return iterator(); }
+
+private:
+    Redland::Model &model_;
+    Redland::Statement pattern_;
+    librdf_stream *stream_;
+};
+
+inline Triple find_triple(Redland::World &world, Redland::Model &model,
+                          const Redland::Node &subject, const Redland::Node &predicate, const Redland::Node &object)
+{
+    TripleRange range(world, model, subject, predicate, object);
+    if (range.empty())
+        return Triple();
+    TripleRange::iterator it = range.begin();
+    return Triple(it->get_subject(), it->get_predicate(), it->get_object());
+}
+
 inline bool isNodeExists(Redland::Model &model, const Redland::Node &node)
 {
     librdf_iterator *it = librdf_model_get_arcs_in(model.c_obj(), node.c_obj());
@@ -135,6 +456,48 @@ inline bool isNodeExists(Redland::Model &model, const Redland::Node &node)
     return false;
 }
 
+/**
+ * Returns key of the resource or blank node in ContextState::visited, empty string for literals.
+ */
+inline std::string visitedKey(const Redland::Node &node)
+{
+    size_t length = 0;
+    if (librdf_node_is_resource(node.c_obj()))
+    {
+        const unsigned char *uri = librdf_uri_as_counted_string(librdf_node_get_uri(node.c_obj()), &length);
+        return std::string(reinterpret_cast<const char *>(uri), length);
+    }
+    if (librdf_node_is_blank(node.c_obj()))
+    {
+        const unsigned char *id = librdf_node_get_counted_blank_identifier(node.c_obj(), &length);
+        return std::string("_:").append(reinterpret_cast<const char *>(id), length);
+    }
+    return std::string();
+}
+
+inline void addStatement(const Context &ctx, const Redland::Node &subject, const Redland::Node &predicate, const Redland::Node &object)
+{
+    ARVIDA_RDF_COUNT(ctx, statements, 1);
+    ctx.model.add_statement(ctx.world, subject, predicate, object);
+    ctx.state->visited.insert(visitedKey(subject));
+    ctx.state->visited.insert(visitedKey(predicate));
+    std::string objectKey = visitedKey(object);
+    if (!objectKey.empty())
+        ctx.state->visited.insert(std::move(objectKey));
+}
+
+/**
+ * Same as isNodeExists(ctx.model, node), the model is only queried when it was not
+ * empty before the root context was created.
+ */
+inline bool isNodeExists(const Context &ctx, const Redland::Node &node)
+{
+    ARVIDA_RDF_COUNT(ctx, lookups, 1);
+    if (ctx.state->visited.count(visitedKey(node)))
+        return true;
+    return ctx.state->check_model && isNodeExists(ctx.model, node);
+}
+
 template<class T>
 inline bool isValidValue(const T &value)
 {
@@ -208,6 +571,25 @@ inline PathType pathTypeOf(const Context &ctx, const std::shared_ptr<T> &value)
         return NO_PATH;
 }
 
+// appendPathOf
+
+/**
+ * Appends path of value to path. Generated code specializes it for annotated
+ * classes to build the path without temporary strings.
+ */
+template<class T>
+inline void appendPathOf(const Context &ctx, std::string &path, const T &value)
+{
+    appendPath(path, pathOf(ctx, value));
+}
+
+template<class T>
+inline void appendPathOf(const Context &ctx, std::string &path, const std::shared_ptr<T> &value)
+{
+    if (value)
+        appendPathOf(ctx, path, *value);
+}
+
 template<>
 inline std::string pathOf(const Context &ctx, const double &value)
 {
@@ -232,6 +614,23 @@ inline PathType pathTypeOf(const Context &ctx, const float &value)
     return NO_PATH; // FIXME: LITERAL_NODE ?
 }
 
+#define ARVIDA_REDLAND_INTEGER_PATH(T)                                          \
+template<>                                                                      \
+inline std::string pathOf(const Context &ctx, const T &value)                   \
+{                                                                               \
+    return "";                                                                  \
+}                                                                               \
+                                                                                \
+template<>                                                                      \
+inline PathType pathTypeOf(const Context &ctx, const T &value)                  \
+{                                                                               \
+    return NO_PATH;                                                             \
+}
+
+ARVIDA_RDF_INTEGER_TYPES(ARVIDA_REDLAND_INTEGER_PATH)
+
+#undef ARVIDA_REDLAND_INTEGER_PATH
+
 template<>
 inline std::string pathOf(const Context &ctx, const std::string &value)
 {
@@ -244,6 +643,20 @@ inline PathType pathTypeOf(const Context &ctx, const std::string &value)
     return NO_PATH; // FIXME: LITERAL_NODE ?
 }
 
+#ifdef ARVIDA_RDF_HAS_STRING_VIEW
+template<>
+inline std::string pathOf(const Context &ctx, const std::string_view &value)
+{
+    return "";
+}
+
+template<>
+inline PathType pathTypeOf(const Context &ctx, const std::string_view &value)
+{
+    return NO_PATH;
+}
+#endif
+
 template<class T>
 inline std::string pathOf(const Context &ctx, const std::vector<T> &value)
 {
@@ -256,109 +669,99 @@ inline PathType pathTypeOf(const Context &ctx, const std::vector<T> &value)
     return RELATIVE_PATH;
 }
 
-std::string joinPath(const std::string &path1, const std::string path2)
-{
-    if (path2.empty())
-        return path1;
-    if (path1.empty())
-        return path2;
 
-    const char p1b = path1.back();
-    const char p2f = path2.front();
+// createRDFNode
 
-    if (p1b == '/' && p2f == '/') {
-        return path1.substr(0, path1.size()-1) + path2;
-    } else if (p1b != '/' && p2f != '/') {
-        return path1 + '/' + path2;
-    } else {
-        return path1 + path2;
+template<class T, class M>
+inline const std::string & memberNodePath(const Context &ctx, const T &value, PathType thatPathType, PathType memberPathType, const M &memberPath)
+{
+    ARVIDA_RDF_COUNT(ctx, paths, 1);
+    std::string &thatPath = ctx.state->paths.at(ctx.depth + 1);
+    if (thatPathType == ABSOLUTE_PATH)
+        thatPath.clear();
+    else if (thatPathType == RELATIVE_TO_BASE_PATH)
+        thatPath = ctx.base_path;
+    else {
+        switch (memberPathType)
+        {
+            case NO_PATH:
+                thatPath = ctx.path;
+                break;
+            case RELATIVE_PATH:
+                thatPath = ctx.path;
+                appendPath(thatPath, memberPath);
+                break;
+            case RELATIVE_TO_BASE_PATH:
+                thatPath = ctx.base_path;
+                appendPath(thatPath, memberPath);
+                break;
+            case ABSOLUTE_PATH:
+                thatPath.clear();
+                appendPath(thatPath, memberPath);
+                break;
+        }
+        if (thatPathType != RELATIVE_PATH)
+            return thatPath;
     }
+    appendPathOf(ctx, thatPath, value);
+    return thatPath;
 }
 
-// createRDFNode
-
-template<class T>
-Node createRDFNode(const Context &ctx, const T &value, PathType memberPathType, const std::string &memberPath)
+template<class T, class M>
+Node createRDFNode(const Context &ctx, const T &value, PathType memberPathType, const M &memberPath)
 {
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
     const PathType thatPathType = pathTypeOf(ctx, value);
     if (thatPathType == NO_PATH)
     {
-        Redland::Node thatNode(Redland::Node::make_blank_node(ctx.world));
+        Redland::Node thatNode(blankNode(ctx));
         return thatNode;
     }
     else
     {
-        std::string thatPath;
-        if (thatPathType == ABSOLUTE_PATH)
-            thatPath = pathOf(ctx, value);
-        else if (thatPathType == RELATIVE_TO_BASE_PATH)
-            thatPath = joinPath(ctx.base_path, pathOf(ctx, value));
-        else {
-            switch (memberPathType)
-            {
-                case NO_PATH:
-                    thatPath = ctx.path;
-                    break;
-                case RELATIVE_PATH:
-                    thatPath = joinPath(ctx.path, memberPath);
-                    break;
-                case RELATIVE_TO_BASE_PATH:
-                    thatPath = joinPath(ctx.base_path, memberPath);
-                    break;
-                case ABSOLUTE_PATH:
-                    thatPath = memberPath;
-                    break;
-            }
-            if (thatPathType == RELATIVE_PATH)
-                thatPath = joinPath(thatPath, pathOf(ctx, value));
-        }
-        Arvida::RDF::Context thatCtx(ctx, thatPath);
+        const std::string &thatPath = memberNodePath(ctx, value, thatPathType, memberPathType, memberPath);
+        ARVIDA_RDF_COUNT(ctx, bytes, thatPath.size());
         Redland::Node thatNode(Redland::Node::make_uri_node(ctx.world, thatPath));
         return thatNode;
     }
 }
 
-template<class T>
-Node createRDFNodeAndSerialize(const Context &ctx, const T &value, PathType memberPathType, const std::string &memberPath)
+template<class T, class M>
+Node createRDFNodeAndSerialize(const Context &ctx, const T &value, PathType memberPathType, const M &memberPath)
 {
+    const void *identity = sharedIdentity(value);
+    if (identity)
+    {
+        auto it = ctx.state->shared.find(identity);
+        if (it != ctx.state->shared.end())
+        {
+            ARVIDA_RDF_COUNT(ctx, cache_hits, 1);
+            return it->second;
+        }
+    }
+
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
     const PathType thatPathType = pathTypeOf(ctx, value);
     if (thatPathType == NO_PATH)
     {
-        Redland::Node thatNode(Redland::Node::make_blank_node(ctx.world));
-        if (!isNodeExists(ctx.model, thatNode))
-            toRDF(ctx, thatNode, value);
+        Redland::Node thatNode(blankNode(ctx));
+        if (identity)
+            ctx.state->shared.insert(std::make_pair(identity, thatNode));
+        toRDF(ctx, thatNode, value);
         return thatNode;
     }
     else
     {
-        std::string thatPath;
-        if (thatPathType == ABSOLUTE_PATH)
-            thatPath = pathOf(ctx, value);
-        else if (thatPathType == RELATIVE_TO_BASE_PATH)
-            thatPath = joinPath(ctx.base_path, pathOf(ctx, value));
-        else {
-            switch (memberPathType)
-            {
-                case NO_PATH:
-                    thatPath = ctx.path;
-                    break;
-                case RELATIVE_PATH:
-                    thatPath = joinPath(ctx.path, memberPath);
-                    break;
-                case RELATIVE_TO_BASE_PATH:
-                    thatPath = joinPath(ctx.base_path, memberPath);
-                    break;
-                case ABSOLUTE_PATH:
-                    thatPath = memberPath;
-                    break;
-            }
-            if (thatPathType == RELATIVE_PATH)
-                thatPath = joinPath(thatPath, pathOf(ctx, value));
-        }
+        const std::string &thatPath = memberNodePath(ctx, value, thatPathType, memberPathType, memberPath);
+        ARVIDA_RDF_COUNT(ctx, bytes, thatPath.size());
         Arvida::RDF::Context thatCtx(ctx, thatPath);
         Redland::Node thatNode(Redland::Node::make_uri_node(ctx.world, thatPath));
-        if (!isNodeExists(ctx.model, thatNode))
+        if (identity)
+            ctx.state->shared.insert(std::make_pair(identity, thatNode));
+        if (!isNodeExists(ctx, thatNode))
             toRDF(thatCtx, thatNode, value);
+        else
+            ARVIDA_RDF_COUNT(ctx, cache_hits, 1);
         return thatNode;
     }
 }
@@ -368,7 +771,7 @@ Node createRDFNodeAndSerialize(const Context &ctx, const T &value, PathType memb
 template<class T>
 Node toRDF(const Context &ctx, const T &value)
 {
-    Redland::Node valueNode = Redland::Node::make_blank_node(ctx.world);
+    Redland::Node valueNode = blankNode(ctx);
     return toRDF(ctx, valueNode, value);
 }
 
@@ -386,36 +789,53 @@ inline NodeRef toRDF(const Context &ctx, NodeRef thisNode, const std::shared_ptr
     else
     {
         if (!thisNode.is_blank())
-            thisNode = Redland::Node::make_blank_node(ctx.world);
+            thisNode = blankNode(ctx);
         return thisNode;
     }
 }
 
-//#define XSD_NS
-//"12345^^<http://www.w3.org/2001/XMLSchema#int>"
+template<class T>
+inline NodeRef numericToRDF(const Context &ctx, NodeRef _this, T value)
+{
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
+    char buffer[NUMERIC_LITERAL_BUFFER_SIZE];
+    const size_t length = formatNumericLiteral(buffer, value);
+    ARVIDA_RDF_COUNT(ctx, bytes, length);
+    _this = literals(ctx).typed(buffer, length, NumericLiteral<T>::xsd_index);
+    return _this;
+}
+
 template<>
 inline NodeRef toRDF(const Context &ctx, NodeRef _this, const double &value)
 {
-    Redland::Uri xsd_double(ctx.world, "http://www.w3.org/2001/XMLSchema#double");
-    _this = Redland::Node::make_typed_literal_node(ctx.world, std::to_string(value), xsd_double);
-    return _this;
+    return numericToRDF(ctx, _this, value);
 }
 
 template<>
 inline NodeRef toRDF(const Context &ctx, NodeRef _this, const float &value)
 {
-    Redland::Uri xsd_double(ctx.world, "http://www.w3.org/2001/XMLSchema#float");
-    _this = Redland::Node::make_typed_literal_node(ctx.world, std::to_string(value), xsd_double);
-    return _this;
+    return numericToRDF(ctx, _this, value);
 }
 
 template<>
 inline NodeRef toRDF(const Context &ctx, NodeRef _this, const std::string &value)
 {
-    Redland::Uri xsd_string(ctx.world, "http://www.w3.org/2001/XMLSchema#string");
-    _this = Redland::Node::make_typed_literal_node(ctx.world, value, xsd_string);
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
+    ARVIDA_RDF_COUNT(ctx, bytes, value.size());
+    _this = literals(ctx).string(value);
+    return _this;
+}
+
+#ifdef ARVIDA_RDF_HAS_STRING_VIEW
+template<>
+inline NodeRef toRDF(const Context &ctx, NodeRef _this, const std::string_view &value)
+{
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
+    ARVIDA_RDF_COUNT(ctx, bytes, value.size());
+    _this = literals(ctx).typed(value.data(), value.size(), XsdVocabulary::STRING);
     return _this;
 }
+#endif
 
 
 template<class T>
@@ -430,48 +850,688 @@ bool fromRDF(const Context &ctx, const NodeRef thisNode, std::shared_ptr<T> &val
     return value ? fromRDF(ctx, thisNode, *value) : false;
 }
 
+/**
+ * Returns true when datatype is an XSD numeric datatype. Raptor interns URIs per
+ * World, so they are compared with the XsdVocabulary URIs by pointer first.
+ */
+inline bool isNumericDatatype(const Context &ctx, librdf_uri *datatype)
+{
+    for (size_t i = 0; i < XsdVocabulary::numeric_size; ++i)
+    {
+        if (literals(ctx).datatype(i) == datatype)
+            return true;
+    }
+
+    // URI interning can be disabled in raptor
+    size_t length;
+    const unsigned char *datatype_iri = librdf_uri_as_counted_string(datatype, &length);
+    return isNumericDatatype(reinterpret_cast<const char *>(datatype_iri), length);
+}
+
+template<class T>
+inline bool numericFromRDF(const Context &ctx, const NodeRef _this0, T &value)
+{
+    if (!_this0.is_valid() || !_this0.is_literal())
+        return false;
+
+    librdf_uri *datatype = librdf_node_get_literal_value_datatype_uri(_this0.c_obj());
+    if (!datatype || !isNumericDatatype(ctx, datatype))
+        return false;
+
+    size_t length;
+    const char *str = reinterpret_cast<const char *>(
+        librdf_node_get_literal_value_as_counted_string(_this0.c_obj(), &length));
+    ARVIDA_RDF_COUNT(ctx, literal_parses, 1);
+    return str && parseNumericLiteral(str, str + length, value);
+}
+
 template <>
 inline bool fromRDF(const Context &ctx, const NodeRef _this0, double &value)
+{
+    return numericFromRDF(ctx, _this0, value);
+}
+
+template <>
+inline bool fromRDF(const Context &ctx, const NodeRef _this0, float &value)
+{
+    return numericFromRDF(ctx, _this0, value);
+}
+
+#define ARVIDA_REDLAND_INTEGER_LITERAL(T)                                       \
+template<>                                                                      \
+inline NodeRef toRDF(const Context &ctx, NodeRef _this, const T &value)         \
+{                                                                               \
+    return numericToRDF(ctx, _this, value);                                     \
+}                                                                               \
+                                                                                \
+template <>                                                                     \
+inline bool fromRDF(const Context &ctx, const NodeRef _this0, T &value)         \
+{                                                                               \
+    return numericFromRDF(ctx, _this0, value);                                  \
+}
+
+ARVIDA_RDF_INTEGER_TYPES(ARVIDA_REDLAND_INTEGER_LITERAL)
+
+#undef ARVIDA_REDLAND_INTEGER_LITERAL
+
+template <>
+inline bool fromRDF(const Context &ctx, const NodeRef _this0, std::string &value)
 {
     if (_this0.is_literal())
     {
-        try {
-            value = std::stod(_this0.get_literal_value());
-        } catch (...)
-        {
-            return false;
-        }
+        size_t length;
+        const char *str = _this0.get_literal_value(length);
+        value.assign(str, length);
+        return true;
     }
     return false;
 }
 
+#ifdef ARVIDA_RDF_HAS_STRING_VIEW
+/**
+ * The view refers to the literal value of the node in the model, it is valid while
+ * the node is, setters taking std::string_view must copy it.
+ */
 template <>
-inline bool fromRDF(const Context &ctx, const NodeRef _this0, float &value)
+inline bool fromRDF(const Context &ctx, const NodeRef _this0, std::string_view &value)
 {
     if (_this0.is_literal())
     {
-        try {
-            value = std::stof(_this0.get_literal_value());
-        } catch (...)
+        size_t length;
+        const char *str = _this0.get_literal_value(length);
+        value = std::string_view(str, length);
+        return true;
+    }
+    return false;
+}
+#endif
+
+
+/**
+ * Serializes all elements of an array, std::array or std::vector of numbers as one
+ * literal with a PackedVocabulary datatype.
+ */
+template <class C>
+inline Redland::Node packedToRDF(const Context &ctx, const C &values)
+{
+    std::string &literal = ctx.state->literal_buffer;
+    const size_t index = encodePackedLiteral(values, literal);
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
+    ARVIDA_RDF_COUNT(ctx, bytes, literal.size());
+    librdf_uri *datatype = librdf_node_get_uri(vocabularyNode<PackedVocabulary>(ctx, index).c_obj());
+    return Redland::Node::make_typed_literal_node(ctx.world, literal.data(), literal.size(), datatype);
+}
+
+/**
+ * Reads packed literal node written by packedToRDF, fails when the datatype does not
+ * match the element type or the number of elements of a fixed size array differs.
+ */
+template <class C>
+inline bool packedFromRDF(const Context &ctx, const NodeRef _this0, C &values)
+{
+    if (!_this0.is_valid() || !_this0.is_literal())
+        return false;
+
+    librdf_uri *datatype = librdf_node_get_literal_value_datatype_uri(_this0.c_obj());
+    librdf_uri *expected = librdf_node_get_uri(
+        vocabularyNode<PackedVocabulary>(ctx, PackedContainer<C>::packed_index).c_obj());
+    if (!datatype || !librdf_uri_equals(datatype, expected))
+        return false;
+
+    size_t length;
+    const char *str = reinterpret_cast<const char *>(
+        librdf_node_get_literal_value_as_counted_string(_this0.c_obj(), &length));
+    ARVIDA_RDF_COUNT(ctx, literal_parses, 1);
+    return str && decodePackedLiteral(str, str + length, values);
+}
+
+// Delta serialization
+
+/**
+ * Returns a unique blank node of the World for nodes kept in a Delta. They are
+ * used by following updates, while labels of blankNode() restart with each root
+ * context of an empty model.
+ */
+inline Redland::Node deltaBlankNode(const Context &ctx)
+{
+    return Redland::Node::make_blank_node(ctx.world);
+}
+
+/**
+ * Statements last emitted by one member triple container for one subject.
+ */
+struct DeltaMember
+{
+    // Snapshot is valid, statements were emitted at least once
+    bool valid;
+    // Last scalar value, see deltaValueChanged
+    std::string value;
+    std::vector<Triple> triples;
+    // Statements of the current update
+    std::vector<Triple> next;
+    // Blank nodes of the member value (index 0) and of its elements (index 1 + i)
+    std::vector<Redland::Node> nodes;
+
+    DeltaMember() : valid(false) { }
+};
+
+struct DeltaSubject
+{
+    std::vector<Redland::Node> blanks;
+    std::vector<DeltaMember> members;
+};
+
+/**
+ * Snapshots of subjects serialized by toRDFDelta and statement sets of the current
+ * update. Blank nodes of a subject are created once, so unchanged members produce
+ * no statements. Call begin() before each update.
+ */
+class Delta
+{
+public:
+    std::vector<Triple> added;
+    std::vector<Triple> removed;
+
+    void begin()
+    {
+        added.clear();
+        removed.clear();
+    }
+
+    // Forgets all snapshots, the next update emits all statements again
+    void reset()
+    {
+        subjects_.clear();
+        begin();
+    }
+
+    template <class T>
+    DeltaSubject & subject(const Context &ctx, const Redland::Node &node, size_t numBlanks, size_t numMembers)
+    {
+        SubjectClasses &classes = subjects_[visitedKey(node)];
+        auto it = classes.find(deltaClassId<T>());
+        if (it == classes.end())
         {
-            return false;
+            it = classes.insert(std::make_pair(deltaClassId<T>(), DeltaSubject())).first;
+            it->second.blanks.reserve(numBlanks);
+            for (size_t i = 0; i < numBlanks; ++i)
+                it->second.blanks.push_back(deltaBlankNode(ctx));
+            it->second.members.resize(numMembers);
         }
+        return it->second;
     }
+
+    /**
+     * Moves the statements of node into removed and forgets its snapshot. Blank
+     * nodes of member values and elements belong to node and are removed with it,
+     * objects with a path may be referenced by other subjects and are kept.
+     */
+    void removeSubject(const Redland::Node &node)
+    {
+        auto it = subjects_.find(visitedKey(node));
+        if (it == subjects_.end())
+            return;
+        std::vector<Redland::Node> owned;
+        for (auto &cls : it->second)
+            for (auto &member : cls.second.members)
+            {
+                removed.insert(removed.end(), member.triples.begin(), member.triples.end());
+                for (const auto &slot : member.nodes)
+                    if (slot.is_valid() && slot.is_blank())
+                        owned.push_back(slot);
+            }
+        subjects_.erase(it);
+        for (const auto &slot : owned)
+            removeSubject(slot);
+    }
+
+private:
+    typedef std::unordered_map<size_t, DeltaSubject> SubjectClasses;
+
+    std::unordered_map<std::string, SubjectClasses> subjects_;
+};
+
+inline bool isSameNode(const Redland::Node &a, const Redland::Node &b)
+{
+    if (!a.c_obj() || !b.c_obj())
+        return a.c_obj() == b.c_obj();
+    return librdf_node_equals(a.c_obj(), b.c_obj()) != 0;
+}
+
+inline bool isSameTriple(const Triple &a, const Triple &b)
+{
+    return isSameNode(a.subject, b.subject) &&
+        isSameNode(a.predicate, b.predicate) &&
+        isSameNode(a.object, b.object);
+}
+
+inline bool containsTriple(const std::vector<Triple> &triples, const Triple &triple)
+{
+    for (const auto &it : triples)
+        if (isSameTriple(it, triple))
+            return true;
     return false;
 }
 
-template <>
-inline bool fromRDF(const Context &ctx, const NodeRef _this0, std::string &value)
+/**
+ * Begins update of a member without value, returns false when its statements
+ * were already emitted.
+ */
+inline bool beginDeltaMember(DeltaMember &member)
 {
-    if (_this0.is_literal())
+    if (member.valid)
+        return false;
+    member.next.clear();
+    return true;
+}
+
+/**
+ * Begins update of a member, returns false when the value is a scalar equal to
+ * the snapshot.
+ */
+template <class T>
+inline bool beginDeltaMember(DeltaMember &member, const T &value)
+{
+    const bool changed = deltaValueChanged(member.value, value);
+    if (member.valid && !changed)
+        return false;
+    member.next.clear();
+    return true;
+}
+
+inline void addDeltaStatement(DeltaMember &member, const Redland::Node &subject, const Redland::Node &predicate, const Redland::Node &object)
+{
+    member.next.push_back(Triple(subject, predicate, object));
+}
+
+/**
+ * Compares statements of the current update with the snapshot of member and
+ * appends the differences to delta.
+ */
+inline void endDeltaMember(Delta &delta, DeltaMember &member)
+{
+    for (const auto &it : member.triples)
+        if (!containsTriple(member.next, it))
+            delta.removed.push_back(it);
+    for (const auto &it : member.next)
+        if (!containsTriple(member.triples, it))
+            delta.added.push_back(it);
+    member.triples.swap(member.next);
+    member.next.clear();
+    member.valid = true;
+}
+
+inline Redland::Node & deltaNodeSlot(DeltaMember &member, size_t index)
+{
+    if (index >= member.nodes.size())
+        member.nodes.resize(index + 1);
+    return member.nodes[index];
+}
+
+/**
+ * Ends the elements of a member after count elements were serialized: subjects of
+ * removed elements without path are removed with their slots.
+ */
+inline void endDeltaElements(Delta &delta, DeltaMember &member, size_t count)
+{
+    for (size_t i = count + 1; i < member.nodes.size(); ++i)
+        if (member.nodes[i].is_valid())
+            delta.removeSubject(member.nodes[i]);
+    if (member.nodes.size() > count + 1)
+        member.nodes.resize(count + 1);
+}
+
+/**
+ * Like toRDF, but statements of generated classes are passed to delta instead of
+ * the model. Only literals are serialized with toRDF, other values need an
+ * overload, e.g. generated with --delta.
+ */
+template<class T>
+inline NodeRef toRDFDelta(const Context &ctx, Delta &delta, NodeRef thisNode, const T &value)
+{
+    static_assert(DeltaLiteral<T>::value,
+                  "toRDFDelta is not defined for this type, generate its code with --delta");
+    return toRDF(ctx, thisNode, value);
+}
+
+template<class T>
+inline NodeRef toRDFDelta(const Context &ctx, Delta &delta, NodeRef thisNode, const std::shared_ptr<T> &value)
+{
+    if (value)
+        return toRDFDelta(ctx, delta, thisNode, *value);
+    if (!thisNode.is_blank())
+        thisNode = deltaBlankNode(ctx);
+    return thisNode;
+}
+
+/**
+ * Same as createRDFNode / createRDFNodeAndSerialize for toRDFDelta, values without
+ * path use the blank node stored in slot.
+ */
+template<class T, class M>
+Node createDeltaNode(const Context &ctx, Delta &delta, Redland::Node &slot, const T &value,
+                     PathType memberPathType, const M &memberPath, bool serialize)
+{
+    const void *identity = serialize ? sharedIdentity(value) : 0;
+    if (identity)
     {
-        value = _this0.get_literal_value();
-        return true;
+        auto it = ctx.state->shared.find(identity);
+        if (it != ctx.state->shared.end())
+            return it->second;
     }
-    return false;
+
+    const PathType thatPathType = pathTypeOf(ctx, value);
+    if (thatPathType == NO_PATH)
+    {
+        if (!slot.is_valid())
+            slot = deltaBlankNode(ctx);
+        Redland::Node thatNode(slot);
+        if (identity)
+            ctx.state->shared.insert(std::make_pair(identity, thatNode));
+        if (serialize)
+            toRDFDelta(ctx, delta, thatNode, value);
+        return thatNode;
+    }
+    else
+    {
+        const std::string &thatPath = memberNodePath(ctx, value, thatPathType, memberPathType, memberPath);
+        ARVIDA_RDF_COUNT(ctx, bytes, thatPath.size());
+        Arvida::RDF::Context thatCtx(ctx, thatPath);
+        Redland::Node thatNode(Redland::Node::make_uri_node(ctx.world, thatPath));
+        if (identity)
+            ctx.state->shared.insert(std::make_pair(identity, thatNode));
+        if (serialize)
+            toRDFDelta(thatCtx, delta, thatNode, value);
+        return thatNode;
+    }
+}
+
+/**
+ * Removes the statements of delta.removed from model and adds delta.added.
+ */
+inline void applyDelta(Redland::World &world, Redland::Model &model, const Delta &delta)
+{
+    for (const auto &it : delta.removed)
+        model.remove_statement(world, it.subject, it.predicate, it.object);
+    Redland::StatementBatch added;
+    added.reserve(delta.added.size());
+    for (const auto &it : delta.added)
+        added.add(it.subject, it.predicate, it.object);
+    model.add_statements(world, added);
+}
+
+// Batches
+
+/**
+ * Imports nodes of another World. Blank nodes get new identifiers of world and
+ * datatype URIs are created once per source model. Imported nodes are cached by
+ * source node, the cache keeps a reference to the source node so that its address
+ * is not reused by another node.
+ */
+class NodeImporter
+{
+public:
+    explicit NodeImporter(Redland::World &world) : world_(world) { }
+
+    Redland::Node import(librdf_node *node)
+    {
+        if (!node)
+            return Redland::Node();
+
+        auto it = imported_.find(node);
+        if (it == imported_.end())
+        {
+            Redland::Node source(checked(librdf_new_node_from_node(node), "librdf_new_node_from_node"));
+            it = imported_.insert(std::make_pair(node, std::make_pair(std::move(source), create(node)))).first;
+        }
+        return it->second.second;
+    }
+
+private:
+    Redland::Node create(librdf_node *node)
+    {
+        size_t length = 0;
+        if (librdf_node_is_resource(node))
+        {
+            const unsigned char *uri = librdf_uri_as_counted_string(librdf_node_get_uri(node), &length);
+            return checked(librdf_new_node_from_counted_uri_string(world_.c_obj(), uri, length),
+                           "librdf_new_node_from_counted_uri_string");
+        }
+        if (librdf_node_is_blank(node))
+        {
+            const unsigned char *id = librdf_node_get_counted_blank_identifier(node, &length);
+            std::string key((const char *) id, length);
+            auto it = blanks_.find(key);
+            if (it == blanks_.end())
+                it = blanks_.insert(std::make_pair(std::move(key), Redland::Node::make_blank_node(world_))).first;
+            return it->second;
+        }
+
+        const unsigned char *value = librdf_node_get_literal_value_as_counted_string(node, &length);
+        const char *language = librdf_node_get_literal_value_language(node);
+        return checked(librdf_new_node_from_typed_counted_literal(
+                           world_.c_obj(), value, length,
+                           language, language ? std::strlen(language) : 0,
+                           datatype(librdf_node_get_literal_value_datatype_uri(node))),
+                       "librdf_new_node_from_typed_counted_literal");
+    }
+
+    librdf_uri * datatype(librdf_uri *uri)
+    {
+        if (!uri)
+            return NULL;
+        size_t length = 0;
+        const unsigned char *str = librdf_uri_as_counted_string(uri, &length);
+        std::string key((const char *) str, length);
+        auto it = datatypes_.find(key);
+        if (it == datatypes_.end())
+            it = datatypes_.insert(std::make_pair(key, Redland::Uri(world_, str, length))).first;
+        return it->second.c_obj();
+    }
+
+    static Redland::Node checked(librdf_node *node, const char *function)
+    {
+        if (!node)
+            throw Redland::AllocException(function);
+        return Redland::Node(node);
+    }
+
+    Redland::World &world_;
+    // Source node and imported node by address of the source node
+    std::unordered_map<librdf_node *, std::pair<Redland::Node, Redland::Node> > imported_;
+    std::unordered_map<std::string, Redland::Node> blanks_;
+    std::unordered_map<std::string, Redland::Uri> datatypes_;
+};
+
+/**
+ * Copies all statements of source into model, source and model may belong to
+ * different Worlds.
+ */
+inline void mergeModel(Redland::World &world, Redland::Model &model, Redland::Model &source, NodeImporter &importer)
+{
+    librdf_stream *stream = librdf_model_as_stream(source.c_obj());
+    if (!stream)
+        throw Redland::Exception("librdf_model_as_stream");
+    Redland::StatementBatch batch;
+    batch.reserve(static_cast<size_t>(std::max(librdf_model_size(source.c_obj()), 0)));
+    for (; !librdf_stream_end(stream); librdf_stream_next(stream))
+    {
+        librdf_statement *statement = librdf_stream_get_object(stream);
+        batch.add(importer.import(librdf_statement_get_subject(statement)),
+                  importer.import(librdf_statement_get_predicate(statement)),
+                  importer.import(librdf_statement_get_object(statement)));
+    }
+    librdf_free_stream(stream);
+    model.add_statements(world, batch);
+}
+
+/**
+ * Serializes objects of [first, last) into model like members without path and
+ * returns their nodes in the same order.
+ *
+ * The range is split into BATCH_SHARDS_PER_WORKER shards per worker, which are
+ * serialized on num_workers threads (0 = one per hardware thread) into memory models
+ * of private Worlds, namespaces are only read. The calling thread merges each shard
+ * into model as soon as it is finished, with a NodeImporter per shard, so blank node
+ * identifiers are allocated only by world; they depend on the order in which the
+ * shards finish. Objects referenced from several shards are serialized once per shard.
+ */
+template <class RandomIt>
+std::vector<Redland::Node> toRDFBatch(Redland::World &world, Redland::Namespaces &namespaces, Redland::Model &model,
+                                      const std::string &path, RandomIt first, RandomIt last,
+                                      size_t num_workers = 0, const void *user_data = 0)
+{
+    const size_t count = static_cast<size_t>(last - first);
+    std::vector<Redland::Node> nodes;
+    num_workers = batchWorkerCount(count, num_workers);
+
+    if (num_workers == 1)
+    {
+        nodes.reserve(count);
+        Context ctx(world, namespaces, model, path, 0, user_data);
+        for (RandomIt it = first; it != last; ++it)
+            nodes.push_back(createRDFNodeAndSerialize(ctx, *it, NO_PATH, ""));
+        return nodes;
+    }
+
+    struct Shard
+    {
+        std::unique_ptr<Redland::World> world;
+        std::unique_ptr<Redland::Storage> storage;
+        std::unique_ptr<Redland::Model> model;
+        size_t begin;
+        std::vector<Redland::Node> nodes;
+    };
+
+    // Worlds are created on the calling thread, worker threads only use their own
+    const size_t num_shards = batchShardCount(count, num_workers);
+    std::vector<Shard> shards(num_shards);
+    for (auto &shard : shards)
+    {
+        shard.world.reset(new Redland::World());
+        shard.storage.reset(new Redland::Storage(*shard.world, "memory", NULL, NULL));
+        shard.model.reset(new Redland::Model(*shard.world, *shard.storage, NULL));
+    }
+    nodes.resize(count);
+
+    runShards(count, num_workers, num_shards, [&](size_t index, size_t begin, size_t end)
+    {
+        Shard &shard = shards[index];
+        Context ctx(*shard.world, namespaces, *shard.model, path, 0, user_data);
+        shard.begin = begin;
+        shard.nodes.reserve(end - begin);
+        for (size_t i = begin; i != end; ++i)
+            shard.nodes.push_back(createRDFNodeAndSerialize(ctx, first[i], NO_PATH, ""));
+    },
+    [&](size_t index)
+    {
+        Shard &shard = shards[index];
+        {
+            NodeImporter importer(world);
+            mergeModel(world, model, *shard.model, importer);
+            for (size_t i = 0; i != shard.nodes.size(); ++i)
+                nodes[shard.begin + i] = importer.import(shard.nodes[i].c_obj());
+        }
+        shard.nodes.clear();
+        shard.model.reset();
+        shard.storage.reset();
+        shard.world.reset();
+    });
+    return nodes;
 }
 
 
+/**
+ * World, namespaces, ContextState and a memory model kept between messages.
+ * Vocabulary nodes, cached nodes and literal datatypes, path buffers and the memory
+ * of visited nodes are reused, reset() only replaces storage and model.
+ *
+ *   RedlandSession session(namespaces);
+ *   for (...)
+ *   {
+ *       Context ctx = session.context(path);
+ *       toRDF(ctx, node, value);
+ *       ...
+ *       session.reset();
+ *   }
+ */
+class RedlandSession
+{
+public:
+
+    explicit RedlandSession(const Redland::Namespaces &namespaces)
+        : namespaces_(namespaces), state_(world_, namespaces_)
+    {
+        reset();
+    }
+
+    RedlandSession(const RedlandSession &) = delete;
+    RedlandSession & operator=(const RedlandSession &) = delete;
+
+    Redland::World & world() { return world_; }
+    Redland::Namespaces & namespaces() { return namespaces_; }
+    Redland::Model & model() { return *model_; }
+    ContextState & state() { return state_; }
+
+    // Root context of the model, path is referenced by the context
+    Context context(const std::string &path, Cache *cache = 0, const void *user_data = 0)
+    {
+        return Context(world_, namespaces_, *model_, path, cache, user_data, &state_);
+    }
+
+    // Starts the next message with an empty model
+    void reset()
+    {
+        model_.reset();
+        storage_.reset(new Redland::Storage(world_, "memory", NULL, NULL));
+        model_.reset(new Redland::Model(world_, *storage_, NULL));
+    }
+
+private:
+    Redland::World world_;
+    Redland::Namespaces namespaces_;
+    ContextState state_;
+    std::unique_ptr<Redland::Storage> storage_;
+    std::unique_ptr<Redland::Model> model_;
+};
+
+/**
+ * Buffer of a Pipeline: a session with a private World that is serialized with a
+ * librdf serializer (default: turtle) that knows the prefixes of namespaces.
+ *
+ *   Pipeline<RedlandPipelineBuffer> pipeline(fileDescriptorSink(fd), 2, namespaces, base_uri);
+ *   RedlandPipelineBuffer &buffer = pipeline.acquire();
+ *   Context ctx = buffer.context(path);
+ *   toRDF(ctx, node, value);
+ *   pipeline.submit(buffer);
+ */
+class RedlandPipelineBuffer : public RedlandSession
+{
+public:
+
+    RedlandPipelineBuffer(const Redland::Namespaces &namespaces, const std::string &base_uri,
+                          const char *serializer_name = "turtle")
+        : RedlandSession(namespaces), base_uri_(world(), base_uri.c_str()), serializer_(world(), serializer_name)
+    {
+        this->namespaces().register_with_serializer(world(), serializer_.c_obj());
+    }
+
+    void serialize(std::string &data)
+    {
+        if (!serializer_.serialize_model(model(), base_uri_.c_obj(), data))
+            throw Redland::Exception("librdf_serializer_serialize_model_to_counted_string");
+    }
+
+    void clear()
+    {
+        reset();
+    }
+
+private:
+    Redland::Uri base_uri_;
+    Redland::Serializer serializer_;
+};
+
 } // namespace Arvida
 } // namespace RDF
 
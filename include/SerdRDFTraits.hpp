@@ -0,0 +1,1291 @@
+/*  ARVIDAPP - ARVIDA C++ Preprocessor
+ *
+ *  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef SERD_RDF_TRAITS_HPP_INCLUDED
+#define SERD_RDF_TRAITS_HPP_INCLUDED
+
+#include "serd/serd.h"
+#include "RDFTraitsCommon.hpp"
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <list>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <boost/any.hpp>
+
+
+namespace Arvida {
+namespace RDF {
+
+/**
+ * RDF term that owns its lexical form, used instead of a model node since
+ * triples are passed directly to a serd statement sink.
+ */
+class Node
+{
+public:
+
+    Node() : type_(SERD_NOTHING) { }
+
+    Node(SerdType type, const std::string &value) : type_(type), value_(value) { }
+
+    Node(SerdType type, const std::string &value, const std::string &datatype)
+        : type_(type), value_(value), datatype_(datatype)
+    { }
+
+    // Copies serd node, as passed to the statement sink
+    explicit Node(const SerdNode &node, const SerdNode *datatype = 0)
+        : type_(node.type)
+        , value_(reinterpret_cast<const char *>(node.buf), node.n_bytes)
+    {
+        if (datatype && datatype->buf)
+            datatype_.assign(reinterpret_cast<const char *>(datatype->buf), datatype->n_bytes);
+    }
+
+    static Node make_uri_node(const std::string &uri) { return Node(SERD_URI, uri); }
+
+    static Node make_curie_node(const std::string &curie) { return Node(SERD_CURIE, curie); }
+
+    static Node make_typed_literal_node(const std::string &value, const std::string &datatype)
+    {
+        return Node(SERD_LITERAL, value, datatype);
+    }
+
+    SerdType type() const { return type_; }
+
+    bool is_valid() const { return type_ != SERD_NOTHING; }
+
+    bool is_blank() const { return type_ == SERD_BLANK; }
+
+    bool is_uri() const { return type_ == SERD_URI; }
+
+    bool is_literal() const { return type_ == SERD_LITERAL; }
+
+    bool is_literal_type(const char *type_uri) const
+    {
+        return type_ == SERD_LITERAL && datatype_ == type_uri;
+    }
+
+    const std::string & value() const { return value_; }
+
+    const std::string & datatype() const { return datatype_; }
+
+    const char * to_c_string() const { return value_.c_str(); }
+
+    SerdNode serd_node() const
+    {
+        return serd_node_from_substring(type_, reinterpret_cast<const uint8_t *>(value_.data()), value_.size());
+    }
+
+    SerdNode serd_datatype_node() const
+    {
+        if (datatype_.empty())
+            return SERD_NODE_NULL;
+        return serd_node_from_substring(SERD_URI, reinterpret_cast<const uint8_t *>(datatype_.data()), datatype_.size());
+    }
+
+    bool operator==(const Node &other) const
+    {
+        return type_ == other.type_ && value_ == other.value_ && datatype_ == other.datatype_;
+    }
+
+    bool operator!=(const Node &other) const { return !(*this == other); }
+
+private:
+    SerdType type_;
+    std::string value_;
+    std::string datatype_;
+};
+
+typedef Node * NodePtr;
+typedef Node & NodeRef;
+typedef std::unordered_map<std::string, boost::any> Cache;
+
+struct NodeHash
+{
+    size_t operator()(const Node &node) const
+    {
+        return std::hash<std::string>()(node.value()) ^ static_cast<size_t>(node.type());
+    }
+};
+
+/**
+ * Typed cache of values per node, e.g. objects created by create_element hooks.
+ * Unlike Cache lookups do not hash strings or use boost::any_cast.
+ */
+typedef TypedCache<Node, NodeHash, std::equal_to<Node> > NodeCache;
+
+/**
+ * Copies serd node, CURIEs and relative URIs are expanded with env.
+ */
+inline Node expandNode(const SerdEnv *env, const SerdNode &node, const SerdNode *datatype = 0)
+{
+    if (env && (node.type == SERD_CURIE || (node.type == SERD_URI && !serd_uri_string_has_scheme(node.buf))))
+    {
+        SerdNode expanded = serd_env_expand_node(env, &node);
+        if (expanded.buf)
+        {
+            Node result(expanded);
+            serd_node_free(&expanded);
+            return result;
+        }
+    }
+    if (datatype && datatype->type == SERD_CURIE)
+    {
+        const Node expandedDatatype = expandNode(env, *datatype);
+        const SerdNode datatypeNode = expandedDatatype.serd_node();
+        return Node(node, &datatypeNode);
+    }
+    return Node(node, datatype);
+}
+
+/**
+ * Passes statements to a serd statement sink, usually a SerdWriter.
+ */
+class Writer
+{
+public:
+
+    explicit Writer(SerdWriter *writer) : sink_(&writeToSerdWriter), handle_(writer) { }
+
+    Writer(SerdStatementSink sink, void *handle) : sink_(sink), handle_(handle) { }
+
+    bool add_statement(const Node &subject, const Node &predicate, const Node &object) const
+    {
+        const SerdNode s = subject.serd_node();
+        const SerdNode p = predicate.serd_node();
+        const SerdNode o = object.serd_node();
+        const SerdNode datatype = object.serd_datatype_node();
+        return sink_(handle_, 0, NULL, &s, &p, &o, datatype.buf ? &datatype : NULL, NULL) == SERD_SUCCESS;
+    }
+
+private:
+    static SerdStatus writeToSerdWriter(void *handle, SerdStatementFlags flags, const SerdNode *graph,
+                                        const SerdNode *subject, const SerdNode *predicate, const SerdNode *object,
+                                        const SerdNode *object_datatype, const SerdNode *object_lang)
+    {
+        return serd_writer_write_statement(static_cast<SerdWriter *>(handle), flags, graph,
+                                           subject, predicate, object, object_datatype, object_lang);
+    }
+
+    SerdStatementSink sink_;
+    void *handle_;
+};
+
+// Vocabulary
+
+/**
+ * Cache of vocabulary nodes. Prefixed names without resolved IRI are expanded with
+ * env when given, the reader passes its environment. Otherwise they are passed as
+ * CURIE nodes and the writer expands them with its environment.
+ */
+class Vocabulary
+{
+public:
+
+    explicit Vocabulary(const SerdEnv *env = 0) : env_(env) { }
+
+    template <class Table>
+    const Node & get(size_t index)
+    {
+        const size_t id = vocabularyTableId<Table>();
+        if (id >= tables_.size())
+            tables_.resize(id + 1);
+        std::vector<Node> &nodes = tables_[id];
+        if (nodes.empty())
+        {
+            nodes.reserve(Table::size);
+            for (size_t i = 0; i < Table::size; ++i)
+            {
+                if (const char *iri = Table::iri(i))
+                    nodes.push_back(Node::make_uri_node(iri));
+                else
+                {
+                    const SerdNode curie = serd_node_from_string(SERD_CURIE, reinterpret_cast<const uint8_t *>(Table::term(i)));
+                    nodes.push_back(expandNode(env_, curie));
+                }
+            }
+        }
+        return nodes[index];
+    }
+
+private:
+    const SerdEnv *env_;
+    std::vector<std::vector<Node> > tables_;
+};
+
+struct CoreVocabulary
+{
+    enum Term { RDF_TYPE, CORE_CONTAINER, CORE_MEMBER };
+
+    static const size_t size = 3;
+
+    static const char * term(size_t index)
+    {
+        static const char * const terms[size] = { "rdf:type", "core:Container", "core:member" };
+        return terms[index];
+    }
+
+    static const char * iri(size_t)
+    {
+        return 0;
+    }
+};
+
+/**
+ * State shared by all contexts derived from one root context. Pass the same state
+ * to all root contexts writing to one document, so blank node labels stay unique.
+ * The set of written nodes is cleared by each root context, memory does not grow
+ * with the number of serialized messages.
+ */
+struct ContextState
+{
+    Vocabulary vocabulary;
+    unsigned long blank_id;
+    std::unordered_set<std::string> written;
+    // Nodes of shared objects serialized by the current root context
+    std::unordered_map<const void *, Node> shared;
+    // Paths of derived contexts
+    PathBuffers paths;
+    // Not reset by begin(), values stay cached while the state is shared
+    NodeCache node_cache;
+    // Reused for encoding packed literals
+    std::string literal_buffer;
+    // Counters of generated code and traits, used with ARVIDA_RDF_INSTRUMENTATION
+    Instrumentation *instrumentation;
+
+    ContextState() : blank_id(0), instrumentation(0) { }
+
+    void begin()
+    {
+        written.clear();
+        shared.clear();
+    }
+};
+
+struct Context
+{
+    const Writer &writer;
+    const std::string &base_path;
+    const std::string &path;
+    Cache *cache;
+    const void *user_data;
+    ContextState *state;
+    // Nesting depth of derived contexts, selects buffer in ContextState::paths
+    size_t depth;
+
+    Context(const Writer &writer, const std::string &base_path, const std::string &path, Cache *cache = 0, const void *user_data = 0, ContextState *state = 0) : writer(writer), base_path(base_path), path(path), cache(cache), user_data(user_data), state(state), depth(0) { initState(); }
+    Context(const Writer &writer, const std::string &path, Cache *cache = 0, const void *user_data = 0, ContextState *state = 0) : writer(writer), base_path(path), path(path), cache(cache), user_data(user_data), state(state), depth(0) { initState(); }
+    Context(const Context &ctx) : writer(ctx.writer), base_path(ctx.base_path), path(ctx.path), cache(ctx.cache), user_data(ctx.user_data), state(ctx.state), depth(ctx.depth), ownState_(ctx.ownState_) { }
+    Context(const Context &ctx, const std::string &path) : writer(ctx.writer), base_path(ctx.base_path), path(path), cache(ctx.cache), user_data(ctx.user_data), state(ctx.state), depth(ctx.depth + 1) { }
+
+private:
+    void initState()
+    {
+        if (!state)
+        {
+            ownState_.reset(new ContextState());
+            state = ownState_.get();
+        }
+        state->begin();
+    }
+
+    // Shared with copies of a root context, which may outlive the original
+    std::shared_ptr<ContextState> ownState_;
+};
+
+template <class Table>
+inline const Node & vocabularyNode(const Context &ctx, size_t index)
+{
+    return ctx.state->vocabulary.get<Table>(index);
+}
+
+inline NodeCache & nodeCache(const Context &ctx)
+{
+    return ctx.state->node_cache;
+}
+
+inline Node blankNode(const Context &ctx)
+{
+    char buf[32];
+    const int len = std::snprintf(buf, sizeof(buf), "b%lu", ++ctx.state->blank_id);
+    return Node(SERD_BLANK, std::string(buf, len));
+}
+
+/**
+ * Returns true when node was not written before by the current root context and
+ * marks it as written. Blank nodes are unique and never written twice.
+ */
+inline bool markNodeWritten(const Context &ctx, const Node &node)
+{
+    ARVIDA_RDF_COUNT(ctx, lookups, 1);
+    if (node.is_blank())
+        return true;
+    return ctx.state->written.insert(node.value()).second;
+}
+
+template <class T>
+inline bool isValidValue(const T &value)
+{
+    return true;
+}
+
+template < class T >
+inline bool isValidValue(const std::shared_ptr<T> &value)
+{
+    return value.operator bool();
+}
+
+// PathType
+
+enum PathType
+{
+    NO_PATH, RELATIVE_PATH, RELATIVE_TO_BASE_PATH, ABSOLUTE_PATH
+};
+
+// uidOf
+
+template<class T>
+inline std::string uidOf(const Context &ctx, const T &value)
+{
+    return value.getUid();
+}
+
+// pathOf_impl, pathTypeOf_impl
+
+template<class T>
+inline std::string pathOf_impl(const Context &ctx, const T &value)
+{
+    return uidOf(ctx, value);
+}
+
+template<class T>
+inline PathType pathTypeOf_impl(const Context &ctx, const T &value)
+{
+    return RELATIVE_TO_BASE_PATH;
+}
+
+// pathOf
+
+template<class T>
+inline std::string pathOf(const Context &ctx, const T &value)
+{
+    return pathOf_impl(ctx, value);
+}
+
+template<class T>
+inline std::string pathOf(const Context &ctx, const std::shared_ptr<T> &value)
+{
+    if (value)
+        return pathOf(ctx, *value);
+    else
+        return "";
+}
+
+template<class T>
+inline PathType pathTypeOf(const Context &ctx, const T &value)
+{
+    return pathTypeOf_impl(ctx, value);
+}
+
+template<class T>
+inline PathType pathTypeOf(const Context &ctx, const std::shared_ptr<T> &value)
+{
+    if (value)
+        return pathTypeOf(ctx, *value);
+    else
+        return NO_PATH;
+}
+
+// appendPathOf
+
+/**
+ * Appends path of value to path. Generated code specializes it for annotated
+ * classes to build the path without temporary strings.
+ */
+template<class T>
+inline void appendPathOf(const Context &ctx, std::string &path, const T &value)
+{
+    appendPath(path, pathOf(ctx, value));
+}
+
+template<class T>
+inline void appendPathOf(const Context &ctx, std::string &path, const std::shared_ptr<T> &value)
+{
+    if (value)
+        appendPathOf(ctx, path, *value);
+}
+
+template<>
+inline std::string pathOf(const Context &ctx, const double &value)
+{
+    return "";
+}
+
+template<>
+inline PathType pathTypeOf(const Context &ctx, const double &value)
+{
+    return NO_PATH;
+}
+
+template<>
+inline std::string pathOf(const Context &ctx, const float &value)
+{
+    return "";
+}
+
+template<>
+inline PathType pathTypeOf(const Context &ctx, const float &value)
+{
+    return NO_PATH;
+}
+
+#define ARVIDA_SERD_INTEGER_PATH(T)                                             \
+template<>                                                                      \
+inline std::string pathOf(const Context &ctx, const T &value)                   \
+{                                                                               \
+    return "";                                                                  \
+}                                                                               \
+                                                                                \
+template<>                                                                      \
+inline PathType pathTypeOf(const Context &ctx, const T &value)                  \
+{                                                                               \
+    return NO_PATH;                                                             \
+}
+
+ARVIDA_RDF_INTEGER_TYPES(ARVIDA_SERD_INTEGER_PATH)
+
+#undef ARVIDA_SERD_INTEGER_PATH
+
+template<>
+inline std::string pathOf(const Context &ctx, const std::string &value)
+{
+    return "";
+}
+
+template<>
+inline PathType pathTypeOf(const Context &ctx, const std::string &value)
+{
+    return NO_PATH;
+}
+
+template<class T>
+inline std::string pathOf(const Context &ctx, const std::vector<T> &value)
+{
+    return "";
+}
+
+template<class T>
+inline PathType pathTypeOf(const Context &ctx, const std::vector<T> &value)
+{
+    return RELATIVE_PATH;
+}
+
+
+// createRDFNode
+
+template<class T, class M>
+inline const std::string & memberNodePath(const Context &ctx, const T &value, PathType thatPathType, PathType memberPathType, const M &memberPath)
+{
+    ARVIDA_RDF_COUNT(ctx, paths, 1);
+    std::string &thatPath = ctx.state->paths.at(ctx.depth + 1);
+    if (thatPathType == ABSOLUTE_PATH)
+        thatPath.clear();
+    else if (thatPathType == RELATIVE_TO_BASE_PATH)
+        thatPath = ctx.base_path;
+    else {
+        switch (memberPathType)
+        {
+            case NO_PATH:
+                thatPath = ctx.path;
+                break;
+            case RELATIVE_PATH:
+                thatPath = ctx.path;
+                appendPath(thatPath, memberPath);
+                break;
+            case RELATIVE_TO_BASE_PATH:
+                thatPath = ctx.base_path;
+                appendPath(thatPath, memberPath);
+                break;
+            case ABSOLUTE_PATH:
+                thatPath.clear();
+                appendPath(thatPath, memberPath);
+                break;
+        }
+        if (thatPathType != RELATIVE_PATH)
+            return thatPath;
+    }
+    appendPathOf(ctx, thatPath, value);
+    return thatPath;
+}
+
+template<class T, class M>
+Node createRDFNode(const Context &ctx, const T &value, PathType memberPathType, const M &memberPath)
+{
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
+    const PathType thatPathType = pathTypeOf(ctx, value);
+    if (thatPathType == NO_PATH)
+        return blankNode(ctx);
+    return Node::make_uri_node(memberNodePath(ctx, value, thatPathType, memberPathType, memberPath));
+}
+
+template<class T, class M>
+Node createRDFNodeAndSerialize(const Context &ctx, const T &value, PathType memberPathType, const M &memberPath)
+{
+    const void *identity = sharedIdentity(value);
+    if (identity)
+    {
+        auto it = ctx.state->shared.find(identity);
+        if (it != ctx.state->shared.end())
+        {
+            ARVIDA_RDF_COUNT(ctx, cache_hits, 1);
+            return it->second;
+        }
+    }
+
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
+    const PathType thatPathType = pathTypeOf(ctx, value);
+    if (thatPathType == NO_PATH)
+    {
+        Node thatNode(blankNode(ctx));
+        if (identity)
+            ctx.state->shared.insert(std::make_pair(identity, thatNode));
+        toRDF(ctx, thatNode, value);
+        return thatNode;
+    }
+    else
+    {
+        const std::string thatPath = memberNodePath(ctx, value, thatPathType, memberPathType, memberPath);
+        Arvida::RDF::Context thatCtx(ctx, thatPath);
+        Node thatNode(Node::make_uri_node(thatPath));
+        if (identity)
+            ctx.state->shared.insert(std::make_pair(identity, thatNode));
+        if (markNodeWritten(ctx, thatNode))
+            toRDF(thatCtx, thatNode, value);
+        else
+            ARVIDA_RDF_COUNT(ctx, cache_hits, 1);
+        return thatNode;
+    }
+}
+
+// toRDF
+
+template < class T >
+Node toRDF(const Context &ctx, const T &value)
+{
+    Node valueNode = blankNode(ctx);
+    return toRDF(ctx, valueNode, value);
+}
+
+template < class T >
+inline NodeRef toRDF(const Context &ctx, NodeRef thisNode, const T &value)
+{
+    return value.toRDF(ctx, thisNode);
+}
+
+template < class T >
+inline NodeRef toRDF(const Context &ctx, NodeRef thisNode, const std::shared_ptr<T> &value)
+{
+    if (value)
+        return toRDF(ctx, thisNode, *value);
+    else
+    {
+        if (!thisNode.is_blank())
+            thisNode = blankNode(ctx);
+        return thisNode;
+    }
+}
+
+template < class T >
+inline NodeRef toRDF(const Context &ctx, NodeRef thisNode, const std::vector<T> &value)
+{
+    ARVIDA_RDF_COUNT(ctx, statements, 1 + value.size());
+    ctx.writer.add_statement(thisNode,
+                             vocabularyNode<CoreVocabulary>(ctx, CoreVocabulary::RDF_TYPE),
+                             vocabularyNode<CoreVocabulary>(ctx, CoreVocabulary::CORE_CONTAINER));
+
+    const Node &memberNode = vocabularyNode<CoreVocabulary>(ctx, CoreVocabulary::CORE_MEMBER);
+    for (auto it = std::begin(value); it != std::end(value); ++it)
+    {
+        const auto & _that = *it;
+        ctx.writer.add_statement(thisNode, memberNode, Arvida::RDF::toRDF(ctx, _that));
+    }
+    return thisNode;
+}
+
+template<class T>
+inline NodeRef numericToRDF(const Context &ctx, NodeRef _this, T value)
+{
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
+    char buffer[NUMERIC_LITERAL_BUFFER_SIZE];
+    const size_t length = formatNumericLiteral(buffer, value);
+    ARVIDA_RDF_COUNT(ctx, bytes, length);
+    _this = Node::make_typed_literal_node(std::string(buffer, length), NumericLiteral<T>::datatype());
+    return _this;
+}
+
+template<>
+inline NodeRef toRDF(const Context &ctx, NodeRef _this, const double &value)
+{
+    return numericToRDF(ctx, _this, value);
+}
+
+template<>
+inline NodeRef toRDF(const Context &ctx, NodeRef _this, const float &value)
+{
+    return numericToRDF(ctx, _this, value);
+}
+
+#define ARVIDA_SERD_INTEGER_TO_RDF(T)                                           \
+template<>                                                                      \
+inline NodeRef toRDF(const Context &ctx, NodeRef _this, const T &value)         \
+{                                                                               \
+    return numericToRDF(ctx, _this, value);                                     \
+}
+
+ARVIDA_RDF_INTEGER_TYPES(ARVIDA_SERD_INTEGER_TO_RDF)
+
+#undef ARVIDA_SERD_INTEGER_TO_RDF
+
+template<>
+inline NodeRef toRDF(const Context &ctx, NodeRef _this, const std::string &value)
+{
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
+    ARVIDA_RDF_COUNT(ctx, bytes, value.size());
+    _this = Node::make_typed_literal_node(value, ARVIDA_XSD_NS "string");
+    return _this;
+}
+
+/**
+ * Serializes all elements of an array, std::array or std::vector of numbers as one
+ * literal with a PackedVocabulary datatype.
+ */
+template <class C>
+inline Node packedToRDF(const Context &ctx, const C &values)
+{
+    std::string &literal = ctx.state->literal_buffer;
+    const size_t index = encodePackedLiteral(values, literal);
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
+    ARVIDA_RDF_COUNT(ctx, bytes, literal.size());
+    return Node::make_typed_literal_node(literal, PackedVocabulary::iri(index));
+}
+
+
+// Streaming reader
+
+class Reader;
+class PendingValue;
+struct Binding;
+
+struct ReaderContext
+{
+    Reader &reader;
+    Cache *cache;
+    const void *user_data;
+
+    ReaderContext(Reader &reader, Cache *cache = 0, const void *user_data = 0) : reader(reader), cache(cache), user_data(user_data) { }
+};
+
+typedef bool (*StatementHandler)(const ReaderContext &ctx, const Binding &binding, const Node &predicate, const Node &object);
+
+/**
+ * Binds a subject node to the object filled from its statements. var selects the
+ * subject of the triple annotations: 0 is $this, i is the i-th blank node of the class.
+ */
+struct Binding
+{
+    StatementHandler handler;
+    void *target;
+    unsigned var;
+    PendingValue *owner;
+
+    Binding(StatementHandler handler, void *target, unsigned var, PendingValue *owner)
+        : handler(handler), target(target), var(var), owner(owner)
+    { }
+
+    Binding with_var(unsigned var) const { return Binding(handler, target, var, owner); }
+};
+
+/**
+ * Generated code specializes handleRDF for every annotated class. Returns true when
+ * statement with bound subject was consumed.
+ */
+template <class T>
+inline bool handleRDF(const ReaderContext &ctx, const Binding &binding, const Node &predicate, const Node &object, T &value)
+{
+    return false;
+}
+
+template <class T>
+inline bool dispatchRDF(const ReaderContext &ctx, const Binding &binding, const Node &predicate, const Node &object)
+{
+    return handleRDF(ctx, binding, predicate, object, *static_cast<T *>(binding.target));
+}
+
+template <class T>
+inline Binding makeBinding(T &value, unsigned var, PendingValue *owner)
+{
+    return Binding(&dispatchRDF<T>, &value, var, owner);
+}
+
+template <class T>
+inline Binding makeBinding(std::shared_ptr<T> &value, unsigned var, PendingValue *owner)
+{
+    if (!value)
+        value = std::make_shared<T>();
+    return makeBinding(*value, var, owner);
+}
+
+// fromRDF for literal objects
+
+template <class T>
+inline bool fromRDF(const ReaderContext &ctx, const Node &node, T &value)
+{
+    return false;
+}
+
+template <class T>
+inline bool numericFromRDF(const ReaderContext &ctx, const Node &node, T &value)
+{
+    if (!node.is_literal() || !isNumericDatatype(node.datatype().data(), node.datatype().size()))
+        return false;
+    const std::string &str = node.value();
+    return parseNumericLiteral(str.data(), str.data() + str.size(), value);
+}
+
+template <>
+inline bool fromRDF(const ReaderContext &ctx, const Node &node, double &value)
+{
+    return numericFromRDF(ctx, node, value);
+}
+
+template <>
+inline bool fromRDF(const ReaderContext &ctx, const Node &node, float &value)
+{
+    return numericFromRDF(ctx, node, value);
+}
+
+#define ARVIDA_SERD_INTEGER_FROM_RDF(T)                                         \
+template <>                                                                     \
+inline bool fromRDF(const ReaderContext &ctx, const Node &node, T &value)       \
+{                                                                               \
+    return numericFromRDF(ctx, node, value);                                    \
+}
+
+ARVIDA_RDF_INTEGER_TYPES(ARVIDA_SERD_INTEGER_FROM_RDF)
+
+#undef ARVIDA_SERD_INTEGER_FROM_RDF
+
+template <>
+inline bool fromRDF(const ReaderContext &ctx, const Node &node, std::string &value)
+{
+    value = node.value();
+    return true;
+}
+
+/**
+ * Reads packed literal node written by packedToRDF, fails when the datatype does not
+ * match the element type or the number of elements of a fixed size array differs.
+ */
+template <class C>
+inline bool packedFromRDF(const ReaderContext &ctx, const Node &node, C &values)
+{
+    if (!node.is_literal_type(PackedVocabulary::iri(PackedContainer<C>::packed_index)))
+        return false;
+    const std::string &literal = node.value();
+    return decodePackedLiteral(literal.data(), literal.data() + literal.size(), values);
+}
+
+/**
+ * Value of a member whose object is a resource. It is filled by the statements of
+ * its node and passed to the member setter when the node ends and all its own
+ * pending values are assigned.
+ */
+class PendingValue
+{
+public:
+    PendingValue() : parent(0), open_children(0), ended(false), type_key(0), source(0), owner_target(0), member(0) { }
+    virtual ~PendingValue() { }
+
+    virtual void * target() = 0;
+    virtual void assign() = 0;
+    virtual void copy_from(const void *value) = 0;
+
+    PendingValue *parent;
+    unsigned open_children;
+    bool ended;
+    Node node;
+    std::list<std::unique_ptr<PendingValue> >::iterator self;
+
+    // Node reached from several objects is filled once, aliases copy the value of their source
+    const void *type_key;
+    PendingValue *source;
+    std::vector<PendingValue *> aliases;
+
+    // Blank nodes of the value's class, released with the value
+    std::vector<Node> var_nodes;
+
+    // Containers collecting elements of the value's members, assigned before the value
+    std::vector<std::unique_ptr<PendingValue> > containers;
+    const void *owner_target;
+    unsigned member;
+};
+
+template <class T>
+inline const void * pendingTypeKey()
+{
+    static const char key = 0;
+    return &key;
+}
+
+template <class T, class Setter>
+class PendingValueImpl : public PendingValue
+{
+public:
+    PendingValueImpl(T &&value, const Setter &setter) : value(std::move(value)), setter(setter) { }
+
+    void * target() { return &value; }
+
+    void assign() { setter(value); }
+
+    void copy_from(const void *other) { value = *static_cast<const T *>(other); }
+
+    T value;
+    Setter setter;
+};
+
+/**
+ * Fills objects while parsing: statements are dispatched by their subject to the
+ * generated handleRDF functions. Statements of subjects that are not bound yet are
+ * buffered until the subject is reached from a bound object. Memory is bounded by
+ * the number of open subjects and buffered statements, not by document size.
+ * A node reached again with a different value type only receives the statements
+ * that follow.
+ *
+ * Statements of a named subject must be written together, as serd and the Writer do:
+ * the subject ends when the next named subject starts, anonymous nodes end with
+ * their closing bracket. Call set_subjects_grouped(false) for documents that mention
+ * a subject again later, then named subjects end in finish().
+ *
+ * Prefixed names of the vocabulary are expanded when they are used first, so
+ * prefixes must be declared in the beginning of the document or in env.
+ */
+class Reader
+{
+public:
+
+    explicit Reader(SerdSyntax syntax = SERD_TURTLE, SerdEnv *env = 0, Cache *cache = 0, const void *user_data = 0)
+        : env_(env ? env : serd_env_new(NULL))
+        , ownEnv_(env == 0)
+        , vocabulary_(env_)
+        , ctx_(*this, cache, user_data)
+        , discard_writer_(&discardStatement, 0)
+        , element_ctx_(discard_writer_, element_path_, cache, user_data)
+        , dispatching_(0)
+        , grouped_(true)
+    {
+        reader_ = serd_reader_new(syntax, this, NULL, &onBase, &onPrefix, &onStatement, &onEnd);
+    }
+
+    ~Reader()
+    {
+        if (reader_)
+            serd_reader_free(reader_);
+        if (ownEnv_)
+            serd_env_free(env_);
+    }
+
+    const ReaderContext & context() const { return ctx_; }
+
+    // Passed to create_element hooks, which share their signature with the writer hooks
+    const Context & element_context() const { return element_ctx_; }
+
+    void set_subjects_grouped(bool grouped) { grouped_ = grouped; }
+
+    Vocabulary & vocabulary() { return vocabulary_; }
+    NodeCache & node_cache() { return node_cache_; }
+
+    SerdReader * serd_reader() const { return reader_; }
+
+    SerdEnv * env() const { return env_; }
+
+    /**
+     * Binds root object to the node, must be called before reading.
+     */
+    template <class T>
+    void bind(const Node &node, T &value)
+    {
+        bind(node, makeBinding(value, 0, 0));
+    }
+
+    void bind(const Node &node, const Binding &binding)
+    {
+        std::vector<std::pair<Node, Node> > buffered;
+        {
+            Subject &subject = subjects_[node];
+            subject.bindings.push_back(binding);
+            if (binding.owner && binding.var != 0)
+                binding.owner->var_nodes.push_back(node);
+            buffered.swap(subject.buffered);
+        }
+
+        // Dispatched statements may release the subject, copy the node and look it up again
+        const Node subjectNode(node);
+        for (auto it = buffered.begin(); it != buffered.end(); ++it)
+            dispatch(subjectNode, it->first, it->second);
+        auto it = subjects_.find(subjectNode);
+        if (it != subjects_.end() && it->second.ended)
+            end(subjectNode);
+    }
+
+    SerdStatus read_string(const std::string &str)
+    {
+        if (!reader_)
+            return SERD_ERR_UNKNOWN;
+        return serd_reader_read_string(reader_, reinterpret_cast<const uint8_t *>(str.c_str()));
+    }
+
+    SerdStatus read_file(const std::string &path)
+    {
+        if (!reader_)
+            return SERD_ERR_UNKNOWN;
+        return serd_reader_read_file(reader_, reinterpret_cast<const uint8_t *>(path.c_str()));
+    }
+
+    /**
+     * Assigns all remaining pending values, call after the document was read.
+     */
+    void finish()
+    {
+        for (auto it = pendings_.begin(); it != pendings_.end(); ++it)
+            (*it)->ended = true;
+        while (!pendings_.empty())
+        {
+            // Values are created after their parents, look for the last one without open children.
+            // When there is none the values reference each other and the last one is finished first.
+            PendingValue *next = pendings_.back().get();
+            for (auto it = pendings_.rbegin(); it != pendings_.rend(); ++it)
+            {
+                if ((*it)->open_children == 0)
+                {
+                    next = it->get();
+                    break;
+                }
+            }
+            finishPending(next);
+        }
+        for (auto it = rootContainers_.begin(); it != rootContainers_.end(); ++it)
+            (*it)->assign();
+        rootContainers_.clear();
+        subjects_.clear();
+        anonymous_.clear();
+        current_ = Node();
+    }
+
+    // Interface of generated code
+
+    template <class T, class Setter>
+    void readValue(const Binding &parent, const Node &object, Setter setter)
+    {
+        readValue(parent, object, T(), setter);
+    }
+
+    template <class T, class Setter>
+    void readValue(const Binding &parent, const Node &object, T initial, Setter setter)
+    {
+        if (object.is_literal())
+        {
+            if (fromRDF(ctx_, object, initial))
+                setter(initial);
+            return;
+        }
+
+        PendingValueImpl<T, Setter> *pending = new PendingValueImpl<T, Setter>(std::move(initial), setter);
+        pendings_.push_back(std::unique_ptr<PendingValue>(pending));
+        pending->self = std::prev(pendings_.end());
+        pending->parent = parent.owner;
+        if (parent.owner)
+            ++parent.owner->open_children;
+        pending->type_key = pendingTypeKey<T>();
+
+        Subject &subject = subjects_[object];
+        if (subject.pending && subject.pending->type_key == pending->type_key)
+        {
+            pending->source = subject.pending;
+            pending->ended = true;
+            ++pending->open_children;
+            subject.pending->aliases.push_back(pending);
+            return;
+        }
+
+        pending->node = object;
+        subject.pending = pending;
+        bind(object, makeBinding(pending->value, 0, pending));
+    }
+
+    template <class Container, class Setter>
+    Container & container(const Binding &parent, unsigned member, Setter setter)
+    {
+        std::vector<std::unique_ptr<PendingValue> > &containers = parent.owner ? parent.owner->containers : rootContainers_;
+        for (auto it = containers.begin(); it != containers.end(); ++it)
+        {
+            if ((*it)->owner_target == parent.target && (*it)->member == member)
+                return *static_cast<Container *>((*it)->target());
+        }
+        PendingValueImpl<Container, Setter> *pending = new PendingValueImpl<Container, Setter>(Container(), setter);
+        pending->owner_target = parent.target;
+        pending->member = member;
+        containers.push_back(std::unique_ptr<PendingValue>(pending));
+        return pending->value;
+    }
+
+    template <class Container, class Setter>
+    void readElement(const Binding &parent, unsigned member, const Node &object, Setter setter)
+    {
+        readElement<Container>(parent, member, object, typename Container::value_type(), setter);
+    }
+
+    template <class Container, class Setter>
+    void readElement(const Binding &parent, unsigned member, const Node &object,
+                     typename Container::value_type initial, Setter setter)
+    {
+        typedef typename Container::value_type element_type;
+        Container &elements = container<Container>(parent, member, setter);
+        const size_t index = elements.size();
+        elements.emplace_back();
+        readValue(parent, object, std::move(initial), [&elements, index](element_type &element) {
+            elements[index] = std::move(element);
+        });
+    }
+
+private:
+
+    struct Subject
+    {
+        std::vector<Binding> bindings;
+        std::vector<std::pair<Node, Node> > buffered;
+        PendingValue *pending;
+        bool ended;
+
+        Subject() : pending(0), ended(false) { }
+    };
+
+    Reader(const Reader &);
+    Reader & operator=(const Reader &);
+
+    void statement(SerdStatementFlags flags, const Node &subject, const Node &predicate, const Node &object)
+    {
+        if (flags & SERD_ANON_S_BEGIN)
+            anonymous_.insert(subject);
+        if (grouped_ && subject != current_ && anonymous_.find(subject) == anonymous_.end())
+        {
+            // Statements of the previous named subject are complete
+            const Node previous(current_);
+            current_ = subject;
+            if (previous.is_valid())
+                end(previous);
+        }
+        dispatch(subject, predicate, object);
+        if (flags & SERD_ANON_O_BEGIN)
+            anonymous_.insert(object);
+    }
+
+    void dispatch(const Node &subjectNode, const Node &predicate, const Node &object)
+    {
+        Subject &subject = subjects_[subjectNode];
+        if (subject.bindings.empty())
+        {
+            subject.buffered.emplace_back(predicate, object);
+            return;
+        }
+
+        // Subjects released by handlers are erased after dispatching
+        ++dispatching_;
+        for (size_t i = 0; i < subject.bindings.size(); ++i)
+        {
+            const Binding binding = subject.bindings[i];
+            binding.handler(ctx_, binding, predicate, object);
+        }
+        if (--dispatching_ == 0)
+        {
+            for (auto it = released_.begin(); it != released_.end(); ++it)
+                subjects_.erase(*it);
+            released_.clear();
+        }
+    }
+
+    void end(const Node &node)
+    {
+        Subject &subject = subjects_[node];
+        subject.ended = true;
+        if (subject.bindings.empty())
+            return;
+        if (subject.pending)
+        {
+            subject.pending->ended = true;
+            tryFinish(subject.pending);
+        }
+        else
+            release(node);
+    }
+
+    void release(const Node &node)
+    {
+        if (dispatching_)
+            released_.push_back(node);
+        else
+            subjects_.erase(node);
+    }
+
+    void tryFinish(PendingValue *pending)
+    {
+        if (pending->ended && pending->open_children == 0)
+            finishPending(pending);
+    }
+
+    void finishPending(PendingValue *pending)
+    {
+        if (pending->source)
+        {
+            // Alias finished before its source, only when values reference each other
+            std::vector<PendingValue *> &aliases = pending->source->aliases;
+            aliases.erase(std::find(aliases.begin(), aliases.end(), pending));
+            pending->copy_from(pending->source->target());
+            pending->source = 0;
+        }
+        for (auto it = pending->containers.begin(); it != pending->containers.end(); ++it)
+            (*it)->assign();
+
+        std::vector<PendingValue *> aliases;
+        aliases.swap(pending->aliases);
+        for (auto it = aliases.begin(); it != aliases.end(); ++it)
+        {
+            (*it)->copy_from(pending->target());
+            (*it)->source = 0;
+        }
+
+        pending->assign();
+
+        if (pending->open_children)
+        {
+            for (auto it = pendings_.begin(); it != pendings_.end(); ++it)
+            {
+                if ((*it)->parent == pending)
+                    (*it)->parent = 0;
+            }
+        }
+
+        PendingValue *parent = pending->parent;
+        if (pending->node.is_valid())
+            release(pending->node);
+        for (auto it = pending->var_nodes.begin(); it != pending->var_nodes.end(); ++it)
+            release(*it);
+        pendings_.erase(pending->self);
+
+        for (auto it = aliases.begin(); it != aliases.end(); ++it)
+        {
+            --(*it)->open_children;
+            tryFinish(*it);
+        }
+        if (parent)
+        {
+            --parent->open_children;
+            tryFinish(parent);
+        }
+    }
+
+    static SerdStatus onBase(void *handle, const SerdNode *uri)
+    {
+        return serd_env_set_base_uri(static_cast<Reader *>(handle)->env_, uri);
+    }
+
+    static SerdStatus onPrefix(void *handle, const SerdNode *name, const SerdNode *uri)
+    {
+        return serd_env_set_prefix(static_cast<Reader *>(handle)->env_, name, uri);
+    }
+
+    static SerdStatus onStatement(void *handle, SerdStatementFlags flags, const SerdNode *graph,
+                                  const SerdNode *subject, const SerdNode *predicate, const SerdNode *object,
+                                  const SerdNode *object_datatype, const SerdNode *object_lang)
+    {
+        Reader *reader = static_cast<Reader *>(handle);
+        reader->statement(flags,
+                          expandNode(reader->env_, *subject),
+                          expandNode(reader->env_, *predicate),
+                          expandNode(reader->env_, *object, object_datatype));
+        return SERD_SUCCESS;
+    }
+
+    static SerdStatus onEnd(void *handle, const SerdNode *node)
+    {
+        Reader *reader = static_cast<Reader *>(handle);
+        const Node anonymous = expandNode(reader->env_, *node);
+        reader->anonymous_.erase(anonymous);
+        reader->end(anonymous);
+        return SERD_SUCCESS;
+    }
+
+    static SerdStatus discardStatement(void *, SerdStatementFlags, const SerdNode *,
+                                       const SerdNode *, const SerdNode *, const SerdNode *,
+                                       const SerdNode *, const SerdNode *)
+    {
+        return SERD_SUCCESS;
+    }
+
+    SerdEnv *env_;
+    bool ownEnv_;
+    Vocabulary vocabulary_;
+    NodeCache node_cache_;
+    ReaderContext ctx_;
+    Writer discard_writer_;
+    std::string element_path_;
+    Context element_ctx_;
+    SerdReader *reader_;
+    std::unordered_map<Node, Subject, NodeHash> subjects_;
+    std::list<std::unique_ptr<PendingValue> > pendings_;
+    std::vector<std::unique_ptr<PendingValue> > rootContainers_;
+    std::vector<Node> released_;
+    int dispatching_;
+    bool grouped_;
+    // Last named subject and open anonymous nodes
+    Node current_;
+    std::unordered_set<Node, NodeHash> anonymous_;
+};
+
+template <class Table>
+inline const Node & vocabularyNode(const ReaderContext &ctx, size_t index)
+{
+    return ctx.reader.vocabulary().get<Table>(index);
+}
+
+inline NodeCache & nodeCache(const ReaderContext &ctx)
+{
+    return ctx.reader.node_cache();
+}
+
+inline const Context & elementContext(const ReaderContext &ctx)
+{
+    return ctx.reader.element_context();
+}
+
+} // namespace RDF
+} // namespace Arvida
+
+#endif
@@ -20,9 +20,15 @@
 
 #include "sord/sordmm.hpp"
 #include "serd/serd.h"
+#include "RDFTraitsCommon.hpp"
 #include <memory>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <new>
 #include <boost/any.hpp>
 
 namespace Arvida {
@@ -33,6 +39,246 @@ typedef Sord::Node * NodePtr;
 typedef Sord::Node & NodeRef;
 typedef std::unordered_map<std::string, boost::any> Cache;
 
+// Sord nodes are interned, node identity is the SordNode pointer
+struct NodeCacheHash
+{
+    size_t operator()(const Sord::Node &node) const { return std::hash<const void *>()(node.c_obj()); }
+};
+
+struct NodeCacheEqual
+{
+    bool operator()(const Sord::Node &a, const Sord::Node &b) const { return a.c_obj() == b.c_obj(); }
+};
+
+/**
+ * Typed cache of values per node, e.g. objects created by create_element hooks.
+ * Unlike Cache lookups do not hash strings or use boost::any_cast.
+ */
+typedef TypedCache<Sord::Node, NodeCacheHash, NodeCacheEqual> NodeCache;
+
+// Vocabulary
+
+/**
+ * Per-World cache of vocabulary nodes. Prefixed names of a table without resolved
+ * IRI are expanded and interned on the first access of the table, so all prefixes
+ * must be added to the World before the first serialization.
+ */
+class Vocabulary
+{
+public:
+
+    explicit Vocabulary(Sord::World &world) : world_(world) { }
+
+    Sord::World & world() const { return world_; }
+
+    template <class Table>
+    const Sord::Node & get(size_t index)
+    {
+        const size_t id = vocabularyTableId<Table>();
+        if (id >= tables_.size())
+            tables_.resize(id + 1);
+        std::vector<Sord::Node> &nodes = tables_[id];
+        if (nodes.empty())
+        {
+            nodes.reserve(Table::size);
+            for (size_t i = 0; i < Table::size; ++i)
+            {
+                if (const char *iri = Table::iri(i))
+                    nodes.push_back(Sord::URI(world_, iri));
+                else
+                    nodes.push_back(Sord::Curie(world_, Table::term(i)));
+            }
+        }
+        return nodes[index];
+    }
+
+    // Drops the nodes without releasing them, they were freed with a destroyed World
+    void forget()
+    {
+        for (auto &nodes : tables_)
+            for (auto &node : nodes)
+                new (&node) Sord::Node();
+        tables_.clear();
+    }
+
+private:
+    Sord::World &world_;
+    std::vector<std::vector<Sord::Node> > tables_;
+};
+
+/**
+ * Vocabularies of the Worlds used by root contexts without ContextState, one per
+ * World and thread. Sord::World has no destruction hook, so each entry holds a node
+ * with a URI of its own: when interning that URI adds a node to the World, the World
+ * at that address was replaced and the entry is built again. Entries do not release
+ * their nodes, they are freed with the World.
+ */
+class WorldVocabularies
+{
+public:
+
+    static Vocabulary & get(Sord::World &world)
+    {
+        static thread_local WorldVocabularies vocabularies;
+        return vocabularies.entry(world);
+    }
+
+    WorldVocabularies(const WorldVocabularies &) = delete;
+    WorldVocabularies & operator=(const WorldVocabularies &) = delete;
+
+private:
+    WorldVocabularies() { }
+
+    // Few Worlds are used at the same time, the least recently used one is dropped
+    static const size_t max_entries = 4;
+
+    // Entries are not copied, their nodes may belong to a destroyed World
+    struct Entry
+    {
+        Entry(Sord::World &world, const std::string &key)
+            : world(&world), key(key), key_node(Sord::URI(world, key)), vocabulary(world)
+        {
+        }
+
+        Entry(const Entry &) = delete;
+        Entry & operator=(const Entry &) = delete;
+
+        ~Entry()
+        {
+            vocabulary.forget();
+            new (&key_node) Sord::Node();
+        }
+
+        Sord::World *world;
+        std::string key;
+        Sord::Node key_node;
+        Vocabulary vocabulary;
+    };
+
+    static bool isCurrent(const Entry &entry, Sord::World &world)
+    {
+        SordWorld *c_world = world.c_obj();
+        const size_t num_nodes = sord_num_nodes(c_world);
+        SordNode *probe = sord_new_uri(c_world, (const uint8_t *) entry.key.c_str());
+        const bool current = sord_num_nodes(c_world) == num_nodes;
+        sord_node_free(c_world, probe);
+        return current;
+    }
+
+    Vocabulary & entry(Sord::World &world)
+    {
+        for (size_t i = 0; i < entries_.size(); ++i)
+        {
+            if (entries_[i]->world != &world)
+                continue;
+            if (!isCurrent(*entries_[i], world))
+            {
+                entries_.erase(entries_.begin() + i);
+                break;
+            }
+            std::rotate(entries_.begin(), entries_.begin() + i, entries_.begin() + i + 1);
+            return entries_.front()->vocabulary;
+        }
+
+        // A dropped World may still exist, its nodes stay referenced until it is destroyed
+        if (entries_.size() == max_entries)
+            entries_.pop_back();
+        static std::atomic<unsigned long long> serial(0);
+        const std::string key = "urn:x-arvida:vocabulary:" + std::to_string(serial++);
+        entries_.insert(entries_.begin(), std::unique_ptr<Entry>(new Entry(world, key)));
+        return entries_.front()->vocabulary;
+    }
+
+    std::vector<std::unique_ptr<Entry> > entries_;
+};
+
+struct CoreVocabulary
+{
+    enum Term { RDF_TYPE, CORE_CONTAINER, CORE_MEMBER };
+
+    static const size_t size = 3;
+
+    static const char * term(size_t index)
+    {
+        static const char * const terms[size] = { "rdf:type", "core:Container", "core:member" };
+        return terms[index];
+    }
+
+    static const char * iri(size_t)
+    {
+        return 0;
+    }
+};
+
+class SubjectIndex;
+
+typedef std::unordered_set<const SordNode *, std::hash<const SordNode *>, std::equal_to<const SordNode *>,
+                           PoolAllocator<const SordNode *> > VisitedNodes;
+typedef std::unordered_map<const void *, Sord::Node, std::hash<const void *>, std::equal_to<const void *>,
+                           PoolAllocator<std::pair<const void * const, Sord::Node> > > SharedNodes;
+
+/**
+ * State shared by all contexts derived from one root context. Pass the same state
+ * to all root contexts of a World to reuse interned nodes between serializations.
+ * Each root context resets the per-serialization members.
+ */
+struct ContextState
+{
+private:
+    std::unique_ptr<Vocabulary> own_vocabulary_;
+
+public:
+    // Owned by the state, or by WorldVocabularies for root contexts without state
+    Vocabulary &vocabulary;
+
+    // Elements of visited and shared, the memory is reused by following serializations
+    NodePool pool;
+    // Nodes used in statements of the current root context, nodes are interned by the World
+    VisitedNodes visited;
+    // Nodes of shared objects serialized by the current root context
+    SharedNodes shared;
+    // Model was not empty when the root context was created, visited nodes are not complete
+    bool check_model;
+    // Paths of derived contexts
+    PathBuffers paths;
+    // Not reset by begin(), values stay cached while the state is shared
+    NodeCache node_cache;
+    // Counters of generated code and traits, used with ARVIDA_RDF_INSTRUMENTATION
+    Instrumentation *instrumentation;
+    // Optional snapshot of the model used by readers instead of searching the model,
+    // owned by the caller and not reset by begin()
+    const SubjectIndex *subject_index;
+    // Reused for encoding packed literals
+    std::string literal_buffer;
+    // Blank nodes of root contexts that serialize into an empty model
+    BlankNodePool<Sord::Node> blanks;
+
+    explicit ContextState(Sord::World &world)
+        : own_vocabulary_(new Vocabulary(world)), vocabulary(*own_vocabulary_),
+          visited(0, VisitedNodes::hasher(), VisitedNodes::key_equal(), VisitedNodes::allocator_type(pool)),
+          shared(0, SharedNodes::hasher(), SharedNodes::key_equal(), SharedNodes::allocator_type(pool)),
+          check_model(false), instrumentation(0), subject_index(0)
+    {
+    }
+
+    // Uses vocabulary of a World, which must outlive the state
+    explicit ContextState(Vocabulary &vocabulary)
+        : vocabulary(vocabulary),
+          visited(0, VisitedNodes::hasher(), VisitedNodes::key_equal(), VisitedNodes::allocator_type(pool)),
+          shared(0, SharedNodes::hasher(), SharedNodes::key_equal(), SharedNodes::allocator_type(pool)),
+          check_model(false), instrumentation(0), subject_index(0)
+    {
+    }
+
+    void begin(Sord::Model &model)
+    {
+        visited.clear();
+        shared.clear();
+        check_model = model.num_quads() != 0;
+        blanks.begin(!check_model);
+    }
+};
+
 struct Context
 {
     Sord::Model &model;
@@ -40,13 +286,58 @@ struct Context
     const std::string &path;
     Cache *cache;
     const void *user_data;
+    ContextState *state;
+    // Nesting depth of derived contexts, selects buffer in ContextState::paths
+    size_t depth;
+
+    Context(Sord::Model &model, const std::string &base_path, const std::string &path, Cache *cache = 0, const void *user_data = 0, ContextState *state = 0) : model(model), base_path(base_path), path(path), cache(cache), user_data(user_data), state(state), depth(0) { initState(); }
+    Context(Sord::Model &model, const std::string &path, Cache *cache = 0, const void *user_data = 0, ContextState *state = 0) : model(model), base_path(path), path(path), cache(cache), user_data(user_data), state(state), depth(0) { initState(); }
+    Context(const Context &ctx) : model(ctx.model), base_path(ctx.base_path), path(ctx.path), cache(ctx.cache), user_data(ctx.user_data), state(ctx.state), depth(ctx.depth), ownState_(ctx.ownState_) { }
+    Context(const Context &ctx, const std::string &path) : model(ctx.model), base_path(ctx.base_path), path(path), cache(ctx.cache), user_data(ctx.user_data), state(ctx.state), depth(ctx.depth + 1) { }
+
+private:
+    void initState()
+    {
+        if (!state)
+        {
+            ownState_.reset(new ContextState(WorldVocabularies::get(model.world())));
+            state = ownState_.get();
+        }
+        state->begin(model);
+    }
 
-    Context(Sord::Model &model, const std::string &base_path, const std::string &path, Cache *cache = 0, const void *user_data = 0) : model(model), base_path(base_path), path(path), cache(cache), user_data(user_data) { }
-    Context(Sord::Model &model, const std::string &path, Cache *cache = 0, const void *user_data = 0) : model(model), base_path(path), path(path), cache(cache), user_data(user_data) { }
-    Context(const Context &ctx) : model(ctx.model), base_path(ctx.base_path), path(ctx.path), cache(ctx.cache), user_data(ctx.user_data) { }
-    Context(const Context &ctx, const std::string &path) : model(ctx.model), base_path(ctx.base_path), path(path), cache(ctx.cache), user_data(ctx.user_data) { }
+    // Shared with copies of a root context, which may outlive the original
+    std::shared_ptr<ContextState> ownState_;
 };
 
+template <class Table>
+inline const Sord::Node & vocabularyNode(const Context &ctx, size_t index)
+{
+    return ctx.state->vocabulary.get<Table>(index);
+}
+
+inline NodeCache & nodeCache(const Context &ctx)
+{
+    return ctx.state->node_cache;
+}
+
+/**
+ * Returns a new blank node of the model of ctx. Blank nodes of a root context that
+ * started with an empty model are labeled n0, n1, ... in order of creation and are
+ * reused from ContextState::blanks, otherwise a unique blank node of the World is
+ * created.
+ */
+inline Sord::Node blankNode(const Context &ctx)
+{
+    BlankNodePool<Sord::Node> &blanks = ctx.state->blanks;
+    if (!blanks.deterministic())
+        return Sord::Node::blank_id(ctx.model.world());
+    return blanks.next([&ctx](const std::string &label)
+    {
+        return Sord::Node(ctx.model.world(), Sord::Node::BLANK, label);
+    });
+}
+
 struct Triple
 {
     Sord::Node subject;
@@ -91,6 +382,224 @@ inline std::vector<Triple> find_triples(Sord::Model &model, const Sord::Node &su
     return result;
 }
 
+/**
+ * Lazy range over the triples of model matching a pattern, unlike find_triples
+ * nodes are only copied when they are accessed with get_subject/predicate/object.
+ * Sord::Node() in the pattern matches any node.
+ */
+class TripleRange
+{
+public:
+
+    class iterator
+    {
+    public:
+        iterator() : range_(0) { }
+
+        Sord::Node get_subject() const { return node(SORD_SUBJECT); }
+        Sord::Node get_predicate() const { return node(SORD_PREDICATE); }
+        Sord::Node get_object() const { return node(SORD_OBJECT); }
+
+        const iterator & operator*() const { return *this; }
+        const iterator * operator->() const { return this; }
+
+        iterator & operator++()
+        {
+            if (sord_iter_next(range_->iter_))
+                range_ = 0;
+            return *this;
+        }
+
+        bool operator==(const iterator &other) const { return range_ == other.range_; }
+        bool operator!=(const iterator &other) const { return range_ != other.range_; }
+
+    private:
+        friend class TripleRange;
+
+        explicit iterator(const TripleRange *range) : range_(range) { }
+
+        Sord::Node node(SordQuadIndex index) const
+        {
+            return Sord::Node(range_->world_, sord_iter_get_node(range_->iter_, index));
+        }
+
+        const TripleRange *range_;
+    };
+
+    TripleRange(Sord::Model &model, const Sord::Node &subject, const Sord::Node &predicate, const Sord::Node &object)
+        : world_(model.world())
+        , model_(model.c_obj())
+        , subject_(subject.c_obj())
+        , predicate_(predicate.c_obj())
+        , object_(object.c_obj())
+        , iter_(sord_search(model_, subject_, predicate_, object_, NULL))
+    {
+    }
+
+    // Range over the model of ctx, like the TripleRange of the binary traits
+    TripleRange(const Context &ctx, const Sord::Node &subject, const Sord::Node &predicate, const Sord::Node &object)
+        : TripleRange(ctx.model, subject, predicate, object)
+    {
+    }
+
+    TripleRange(const TripleRange &) = delete;
+    TripleRange & operator=(const TripleRange &) = delete;
+
+    ~TripleRange()
+    {
+        sord_iter_free(iter_);
+    }
+
+    bool empty() const { return !iter_ || sord_iter_end(iter_); }
+
+    // Single pass, begin() returns the current position
+    iterator begin() const { return empty() ? iterator() : iterator(this); }
+    iterator end() const { return iterator(); }
+
+private:
+    Sord::World &world_;
+    SordModel *model_;
+    const SordNode *subject_;
+    const SordNode *predicate_;
+    const SordNode *object_;
+    SordIter *iter_;
+};
+
+/**
+ * Read-only snapshot of the statements of a model grouped by subject. The index is
+ * built with a single scan over the model and stores (predicate, object) pairs of
+ * all subjects in one array, subjects are sorted by node pointer and refer to
+ * contiguous ranges of the array. Statements of one subject keep the order of the
+ * model, so lookups return the same triple as find_triple.
+ *
+ * Nodes are not referenced by the index, it must be rebuilt after the model is
+ * modified. is_current() detects changes of the number of statements only.
+ */
+class SubjectIndex
+{
+public:
+
+    struct Entry
+    {
+        const SordNode *predicate;
+        const SordNode *object;
+    };
+
+    typedef const Entry * const_iterator;
+
+    SubjectIndex() : model_(0), num_quads_(0) { }
+
+    explicit SubjectIndex(Sord::Model &model) : model_(0), num_quads_(0)
+    {
+        build(model);
+    }
+
+    void build(Sord::Model &model)
+    {
+        typedef std::pair<const SordNode *, Entry> Statement;
+        std::vector<Statement> statements;
+        statements.reserve(model.num_quads());
+        SordIter *iter = sord_begin(model.c_obj());
+        for (; iter && !sord_iter_end(iter); sord_iter_next(iter))
+        {
+            Entry entry = {sord_iter_get_node(iter, SORD_PREDICATE), sord_iter_get_node(iter, SORD_OBJECT)};
+            statements.push_back(Statement(sord_iter_get_node(iter, SORD_SUBJECT), entry));
+        }
+        sord_iter_free(iter);
+
+        std::stable_sort(statements.begin(), statements.end(),
+                         [](const Statement &a, const Statement &b) { return std::less<const SordNode *>()(a.first, b.first); });
+
+        clear();
+        entries_.reserve(statements.size());
+        for (const Statement &statement : statements)
+        {
+            if (subjects_.empty() || subjects_.back() != statement.first)
+            {
+                subjects_.push_back(statement.first);
+                offsets_.push_back(entries_.size());
+            }
+            entries_.push_back(statement.second);
+        }
+        offsets_.push_back(entries_.size());
+        model_ = model.c_obj();
+        num_quads_ = model.num_quads();
+    }
+
+    void clear()
+    {
+        subjects_.clear();
+        offsets_.clear();
+        entries_.clear();
+        model_ = 0;
+        num_quads_ = 0;
+    }
+
+    bool is_current(const Sord::Model &model) const
+    {
+        return model_ && model_ == model.c_obj() && num_quads_ == model.num_quads();
+    }
+
+    size_t num_subjects() const { return subjects_.size(); }
+    size_t size() const { return entries_.size(); }
+
+    /**
+     * Sets [first, last) to the statements of subject, returns false when subject
+     * has no statements.
+     */
+    bool find(const SordNode *subject, const_iterator &first, const_iterator &last) const
+    {
+        std::vector<const SordNode *>::const_iterator it =
+            std::lower_bound(subjects_.begin(), subjects_.end(), subject, std::less<const SordNode *>());
+        if (it == subjects_.end() || *it != subject)
+        {
+            first = last = 0;
+            return false;
+        }
+        const size_t i = it - subjects_.begin();
+        first = entries_.data() + offsets_[i];
+        last = entries_.data() + offsets_[i + 1];
+        return true;
+    }
+
+private:
+    std::vector<const SordNode *> subjects_;
+    // offsets_[i] .. offsets_[i + 1] are the entries of subjects_[i]
+    std::vector<size_t> offsets_;
+    std::vector<Entry> entries_;
+    const SordModel *model_;
+    size_t num_quads_;
+};
+
+inline const SubjectIndex * currentSubjectIndex(const Context &ctx)
+{
+    const SubjectIndex *index = ctx.state->subject_index;
+    return index && index->is_current(ctx.model) ? index : 0;
+}
+
+/**
+ * Like find_triple on ctx.model, patterns with a subject are looked up in the
+ * subject index of the context when it is current.
+ */
+inline Triple find_triple(const Context &ctx, const Sord::Node &subject, const Sord::Node &predicate, const Sord::Node &object)
+{
+    const SubjectIndex *index = subject.c_obj() ? currentSubjectIndex(ctx) : 0;
+    if (!index)
+        return find_triple(ctx.model, subject, predicate, object);
+
+    SubjectIndex::const_iterator first, last;
+    index->find(subject.c_obj(), first, last);
+    for (; first != last; ++first)
+    {
+        if ((!predicate.c_obj() || first->predicate == predicate.c_obj()) &&
+            (!object.c_obj() || first->object == object.c_obj()))
+        {
+            return Triple(subject, Sord::Node(ctx.model.world(), first->predicate), Sord::Node(ctx.model.world(), first->object));
+        }
+    }
+    return Triple();
+}
+
 inline bool isNodeExists(Sord::Model &model, const Sord::Node &node)
 {
     Sord::Node empty;
@@ -112,6 +621,27 @@ inline bool isNodeExists(Sord::Model &model, const Sord::Node &node)
     return false;
 }
 
+inline void addStatement(const Context &ctx, const Sord::Node &subject, const Sord::Node &predicate, const Sord::Node &object)
+{
+    ARVIDA_RDF_COUNT(ctx, statements, 1);
+    ctx.model.add_statement(subject, predicate, object);
+    ctx.state->visited.insert(subject.c_obj());
+    ctx.state->visited.insert(predicate.c_obj());
+    ctx.state->visited.insert(object.c_obj());
+}
+
+/**
+ * Same as isNodeExists(ctx.model, node), the model is only queried when it was not
+ * empty before the root context was created.
+ */
+inline bool isNodeExists(const Context &ctx, const Sord::Node &node)
+{
+    ARVIDA_RDF_COUNT(ctx, lookups, 1);
+    if (ctx.state->visited.count(node.c_obj()))
+        return true;
+    return ctx.state->check_model && isNodeExists(ctx.model, node);
+}
+
 template <class T>
 inline bool isValidValue(const T &value)
 {
@@ -185,6 +715,25 @@ inline PathType pathTypeOf(const Context &ctx, const std::shared_ptr<T> &value)
         return NO_PATH;
 }
 
+// appendPathOf
+
+/**
+ * Appends path of value to path. Generated code specializes it for annotated
+ * classes to build the path without temporary strings.
+ */
+template<class T>
+inline void appendPathOf(const Context &ctx, std::string &path, const T &value)
+{
+    appendPath(path, pathOf(ctx, value));
+}
+
+template<class T>
+inline void appendPathOf(const Context &ctx, std::string &path, const std::shared_ptr<T> &value)
+{
+    if (value)
+        appendPathOf(ctx, path, *value);
+}
+
 template<>
 inline std::string pathOf(const Context &ctx, const double &value)
 {
@@ -209,6 +758,23 @@ inline PathType pathTypeOf(const Context &ctx, const float &value)
     return NO_PATH; // FIXME: LITERAL_NODE ?
 }
 
+#define ARVIDA_SORD_INTEGER_PATH(T)                                             \
+template<>                                                                      \
+inline std::string pathOf(const Context &ctx, const T &value)                   \
+{                                                                               \
+    return "";                                                                  \
+}                                                                               \
+                                                                                \
+template<>                                                                      \
+inline PathType pathTypeOf(const Context &ctx, const T &value)                  \
+{                                                                               \
+    return NO_PATH;                                                             \
+}
+
+ARVIDA_RDF_INTEGER_TYPES(ARVIDA_SORD_INTEGER_PATH)
+
+#undef ARVIDA_SORD_INTEGER_PATH
+
 template<>
 inline std::string pathOf(const Context &ctx, const std::string &value)
 {
@@ -221,6 +787,20 @@ inline PathType pathTypeOf(const Context &ctx, const std::string &value)
     return NO_PATH; // FIXME: LITERAL_NODE ?
 }
 
+#ifdef ARVIDA_RDF_HAS_STRING_VIEW
+template<>
+inline std::string pathOf(const Context &ctx, const std::string_view &value)
+{
+    return "";
+}
+
+template<>
+inline PathType pathTypeOf(const Context &ctx, const std::string_view &value)
+{
+    return NO_PATH;
+}
+#endif
+
 
 template<class T>
 inline std::string pathOf(const Context &ctx, const std::vector<T> &value)
@@ -234,109 +814,99 @@ inline PathType pathTypeOf(const Context &ctx, const std::vector<T> &value)
     return RELATIVE_PATH;
 }
 
-std::string joinPath(const std::string &path1, const std::string path2)
-{
-    if (path2.empty())
-        return path1;
-    if (path1.empty())
-        return path2;
 
-    const char p1b = path1.back();
-    const char p2f = path2.front();
+// createRDFNode
 
-    if (p1b == '/' && p2f == '/') {
-        return path1.substr(0, path1.size()-1) + path2;
-    } else if (p1b != '/' && p2f != '/') {
-        return path1 + '/' + path2;
-    } else {
-        return path1 + path2;
+template<class T, class M>
+inline const std::string & memberNodePath(const Context &ctx, const T &value, PathType thatPathType, PathType memberPathType, const M &memberPath)
+{
+    ARVIDA_RDF_COUNT(ctx, paths, 1);
+    std::string &thatPath = ctx.state->paths.at(ctx.depth + 1);
+    if (thatPathType == ABSOLUTE_PATH)
+        thatPath.clear();
+    else if (thatPathType == RELATIVE_TO_BASE_PATH)
+        thatPath = ctx.base_path;
+    else {
+        switch (memberPathType)
+        {
+            case NO_PATH:
+                thatPath = ctx.path;
+                break;
+            case RELATIVE_PATH:
+                thatPath = ctx.path;
+                appendPath(thatPath, memberPath);
+                break;
+            case RELATIVE_TO_BASE_PATH:
+                thatPath = ctx.base_path;
+                appendPath(thatPath, memberPath);
+                break;
+            case ABSOLUTE_PATH:
+                thatPath.clear();
+                appendPath(thatPath, memberPath);
+                break;
+        }
+        if (thatPathType != RELATIVE_PATH)
+            return thatPath;
     }
+    appendPathOf(ctx, thatPath, value);
+    return thatPath;
 }
 
-// createRDFNode
-
-template<class T>
-Node createRDFNode(const Context &ctx, const T &value, PathType memberPathType, const std::string &memberPath)
+template<class T, class M>
+Node createRDFNode(const Context &ctx, const T &value, PathType memberPathType, const M &memberPath)
 {
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
     const PathType thatPathType = pathTypeOf(ctx, value);
     if (thatPathType == NO_PATH)
     {
-        Node thatNode(Node::blank_id(ctx.model.world()));
+        Node thatNode(blankNode(ctx));
         return thatNode;
     }
     else
     {
-        std::string thatPath;
-        if (thatPathType == ABSOLUTE_PATH)
-            thatPath = pathOf(ctx, value);
-        else if (thatPathType == RELATIVE_TO_BASE_PATH)
-            thatPath = joinPath(ctx.base_path, pathOf(ctx, value));
-        else {
-            switch (memberPathType)
-            {
-                case NO_PATH:
-                    thatPath = ctx.path;
-                    break;
-                case RELATIVE_PATH:
-                    thatPath = joinPath(ctx.path, memberPath);
-                    break;
-                case RELATIVE_TO_BASE_PATH:
-                    thatPath = joinPath(ctx.base_path, memberPath);
-                    break;
-                case ABSOLUTE_PATH:
-                    thatPath = memberPath;
-                    break;
-            }
-            if (thatPathType == RELATIVE_PATH)
-                thatPath = joinPath(thatPath, pathOf(ctx, value));
-        }
-        Arvida::RDF::Context thatCtx(ctx, thatPath);
+        const std::string &thatPath = memberNodePath(ctx, value, thatPathType, memberPathType, memberPath);
+        ARVIDA_RDF_COUNT(ctx, bytes, thatPath.size());
         Sord::URI thatNode(ctx.model.world(), thatPath);
         return thatNode;
     }
 }
 
-template<class T>
-Node createRDFNodeAndSerialize(const Context &ctx, const T &value, PathType memberPathType, const std::string &memberPath)
+template<class T, class M>
+Node createRDFNodeAndSerialize(const Context &ctx, const T &value, PathType memberPathType, const M &memberPath)
 {
+    const void *identity = sharedIdentity(value);
+    if (identity)
+    {
+        auto it = ctx.state->shared.find(identity);
+        if (it != ctx.state->shared.end())
+        {
+            ARVIDA_RDF_COUNT(ctx, cache_hits, 1);
+            return it->second;
+        }
+    }
+
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
     const PathType thatPathType = pathTypeOf(ctx, value);
     if (thatPathType == NO_PATH)
     {
-        Node thatNode(Node::blank_id(ctx.model.world()));
-        if (!isNodeExists(ctx.model, thatNode))
-            toRDF(ctx, thatNode, value);
+        Node thatNode(blankNode(ctx));
+        if (identity)
+            ctx.state->shared.insert(std::make_pair(identity, thatNode));
+        toRDF(ctx, thatNode, value);
         return thatNode;
     }
     else
     {
-        std::string thatPath;
-        if (thatPathType == ABSOLUTE_PATH)
-            thatPath = pathOf(ctx, value);
-        else if (thatPathType == RELATIVE_TO_BASE_PATH)
-            thatPath = joinPath(ctx.base_path, pathOf(ctx, value));
-        else {
-            switch (memberPathType)
-            {
-                case NO_PATH:
-                    thatPath = ctx.path;
-                    break;
-                case RELATIVE_PATH:
-                    thatPath = joinPath(ctx.path, memberPath);
-                    break;
-                case RELATIVE_TO_BASE_PATH:
-                    thatPath = joinPath(ctx.base_path, memberPath);
-                    break;
-                case ABSOLUTE_PATH:
-                    thatPath = memberPath;
-                    break;
-            }
-            if (thatPathType == RELATIVE_PATH)
-                thatPath = joinPath(thatPath, pathOf(ctx, value));
-        }
+        const std::string &thatPath = memberNodePath(ctx, value, thatPathType, memberPathType, memberPath);
+        ARVIDA_RDF_COUNT(ctx, bytes, thatPath.size());
         Arvida::RDF::Context thatCtx(ctx, thatPath);
         Sord::URI thatNode(ctx.model.world(), thatPath);
-        if (!isNodeExists(ctx.model, thatNode))
+        if (identity)
+            ctx.state->shared.insert(std::make_pair(identity, thatNode));
+        if (!isNodeExists(ctx, thatNode))
             toRDF(thatCtx, thatNode, value);
+        else
+            ARVIDA_RDF_COUNT(ctx, cache_hits, 1);
         return thatNode;
     }
 }
@@ -346,7 +916,7 @@ Node createRDFNodeAndSerialize(const Context &ctx, const T &value, PathType memb
 template < class T >
 Node toRDF(const Context &ctx, const T &value)
 {
-    Sord::Node valueNode = Sord::Node::blank_id(ctx.model.world());
+    Sord::Node valueNode = blankNode(ctx);
     return toRDF(ctx, valueNode, value);
 }
 
@@ -364,7 +934,7 @@ inline NodeRef toRDF(const Context &ctx, NodeRef thisNode, const std::shared_ptr
     else
     {
         if (!thisNode.is_blank())
-            thisNode = Sord::Node::blank_id(ctx.model.world());
+            thisNode = blankNode(ctx);
         return thisNode;
     }
 }
@@ -372,37 +942,61 @@ inline NodeRef toRDF(const Context &ctx, NodeRef thisNode, const std::shared_ptr
 template < class T >
 inline NodeRef toRDF(const Context &ctx, NodeRef thisNode, const std::vector<T> &value)
 {
-    using namespace Sord;
-    ctx.model.add_statement(thisNode, Curie(ctx.model.world(), "rdf:type"), Curie(ctx.model.world(), "core:Container"));
+    addStatement(ctx, thisNode,
+                 vocabularyNode<CoreVocabulary>(ctx, CoreVocabulary::RDF_TYPE),
+                 vocabularyNode<CoreVocabulary>(ctx, CoreVocabulary::CORE_CONTAINER));
 
+    const Sord::Node &memberNode = vocabularyNode<CoreVocabulary>(ctx, CoreVocabulary::CORE_MEMBER);
     for (auto it = std::begin(value); it != std::end(value); ++it)
     {
         const auto & _that = *it;
-        ctx.model.add_statement(thisNode, Curie(ctx.model.world(), "core:member"), Arvida::RDF::toRDF(ctx, _that));
+        addStatement(ctx, thisNode, memberNode, Arvida::RDF::toRDF(ctx, _that));
     }
     return thisNode;
 }
 
-template<>
-inline NodeRef toRDF(const Context &ctx, NodeRef _this, const double &value)
+template<class T>
+inline NodeRef numericToRDF(const Context &ctx, NodeRef _this, T value)
 {
-    const SerdNode val = serd_node_new_decimal(value, 7);
-    const SerdNode type = serd_node_from_string(SERD_URI, (const uint8_t*) SORD_NS_XSD "double");
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
+    char buffer[NUMERIC_LITERAL_BUFFER_SIZE];
+    formatNumericLiteral(buffer, value);
+    ARVIDA_RDF_COUNT(ctx, bytes, std::strlen(buffer));
+    const Sord::Node &datatype = vocabularyNode<XsdVocabulary>(ctx, NumericLiteral<T>::xsd_index);
 
     _this = Sord::Node(ctx.model.world(),
-        sord_node_from_serd_node(ctx.model.world().c_obj(), ctx.model.world().prefixes().c_obj(), &val, &type, NULL),
+        sord_new_literal(ctx.model.world().c_obj(), datatype.c_obj(), (const uint8_t*) buffer, NULL),
         false);
     return _this;
 }
 
+template<>
+inline NodeRef toRDF(const Context &ctx, NodeRef _this, const double &value)
+{
+    return numericToRDF(ctx, _this, value);
+}
+
 template<>
 inline NodeRef toRDF(const Context &ctx, NodeRef _this, const float &value)
 {
-    const SerdNode val = serd_node_new_decimal(value, 7);
-    const SerdNode type = serd_node_from_string(SERD_URI, (const uint8_t*) SORD_NS_XSD "float");
+    return numericToRDF(ctx, _this, value);
+}
+
+/**
+ * Creates xsd:string literal of the length bytes at str, which need not be NUL
+ * terminated and may contain NUL. The counted serd node is copied once into the
+ * interned node, which is the only allocation of the literal.
+ */
+inline NodeRef stringToRDF(const Context &ctx, NodeRef _this, const char *str, size_t length)
+{
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
+    ARVIDA_RDF_COUNT(ctx, bytes, length);
+    const Sord::Node &datatype = vocabularyNode<XsdVocabulary>(ctx, XsdVocabulary::STRING);
+    const SerdNode literal = serd_node_from_substring(SERD_LITERAL, (const uint8_t*) str, length);
 
     _this = Sord::Node(ctx.model.world(),
-        sord_node_from_serd_node(ctx.model.world().c_obj(), ctx.model.world().prefixes().c_obj(), &val, &type, NULL),
+        sord_node_from_serd_node(ctx.model.world().c_obj(), ctx.model.world().prefixes().c_obj(),
+                                 &literal, sord_node_to_serd_node(datatype.c_obj()), NULL),
         false);
     return _this;
 }
@@ -410,14 +1004,16 @@ inline NodeRef toRDF(const Context &ctx, NodeRef _this, const float &value)
 template<>
 inline NodeRef toRDF(const Context &ctx, NodeRef _this, const std::string &value)
 {
-    const SerdNode val = serd_node_from_string(SERD_LITERAL, (const uint8_t*)value.c_str());
-    const SerdNode type = serd_node_from_string(SERD_URI, (const uint8_t*) SORD_NS_XSD "string");
+    return stringToRDF(ctx, _this, value.data(), value.size());
+}
 
-    _this = Sord::Node(ctx.model.world(),
-        sord_node_from_serd_node(ctx.model.world().c_obj(), ctx.model.world().prefixes().c_obj(), &val, &type, NULL),
-        false);
-    return _this;
+#ifdef ARVIDA_RDF_HAS_STRING_VIEW
+template<>
+inline NodeRef toRDF(const Context &ctx, NodeRef _this, const std::string_view &value)
+{
+    return stringToRDF(ctx, _this, value.data(), value.size());
 }
+#endif
 
 template < class T >
 bool fromRDF(const Context &ctx, const NodeRef thisNode, T &value)
@@ -431,43 +1027,735 @@ bool fromRDF(const Context &ctx, const NodeRef thisNode, std::shared_ptr<T> &val
     return value ? fromRDF(ctx, thisNode, *value) : false;
 }
 
-template <>
-inline bool fromRDF(const Context &ctx, const NodeRef _this0, double &value)
+/**
+ * Reads a container written by toRDF, elements are read in the order of the
+ * core:member statements of the model.
+ */
+template < class T >
+bool fromRDF(const Context &ctx, const NodeRef thisNode, std::vector<T> &value)
 {
-    if (_this0.is_literal_type(SORD_NS_XSD "integer") ||
-        _this0.is_literal_type(SORD_NS_XSD "decimal") ||
-        _this0.is_literal_type(SORD_NS_XSD "double"))
+    TripleRange members(ctx, thisNode, vocabularyNode<CoreVocabulary>(ctx, CoreVocabulary::CORE_MEMBER), Sord::Node());
+    value.clear();
+    for (auto it = std::begin(members); it != std::end(members); ++it)
     {
-        char* endptr;
-        value = serd_strtod(_this0.to_c_string(), &endptr);
-        return true;
+        Sord::Node elementNode = it->get_object();
+        T element;
+        if (!Arvida::RDF::fromRDF(ctx, elementNode, element))
+            return false;
+        value.push_back(std::move(element));
     }
+    return true;
+}
 
+/**
+ * Returns true when datatype is one of the interned numeric XsdVocabulary nodes.
+ * Sord interns nodes per World, so nodes are compared by pointer.
+ */
+inline bool isNumericDatatype(const Context &ctx, const SordNode *datatype)
+{
+    for (size_t i = 0; i < XsdVocabulary::numeric_size; ++i)
+    {
+        if (vocabularyNode<XsdVocabulary>(ctx, i).c_obj() == datatype)
+            return true;
+    }
     return false;
 }
 
+template<class T>
+inline bool numericFromRDF(const Context &ctx, const SordNode *node, T &value)
+{
+    const SordNode *datatype = node ? sord_node_get_datatype(node) : NULL;
+    if (!datatype || !isNumericDatatype(ctx, datatype))
+        return false;
+
+    size_t length;
+    const char *str = (const char*) sord_node_get_string_counted(node, &length);
+    ARVIDA_RDF_COUNT(ctx, literal_parses, 1);
+    return parseNumericLiteral(str, str + length, value);
+}
+
+template<class T>
+inline bool numericFromRDF(const Context &ctx, const NodeRef _this0, T &value)
+{
+    return numericFromRDF(ctx, static_cast<const SordNode *>(_this0.c_obj()), value);
+}
+
+/**
+ * Reads numeric literal objects of triples (subject, predicates[i], object) into values[i]
+ * with a single scan over the statements of subject, instead of one lookup per
+ * predicate. When several triples match, the first one is used like in find_triple.
+ * Returns number of values read, values without a matching triple stay unchanged.
+ */
+template<class T>
+inline size_t readNumericLiterals(const Context &ctx, const Sord::Node &subject,
+                                  const Sord::Node * const *predicates, T * const *values, size_t count)
+{
+    // Read flags of one chunk are kept in a bit mask
+    const size_t chunk = 64;
+    if (count > chunk)
+        return readNumericLiterals(ctx, subject, predicates, values, chunk) +
+            readNumericLiterals(ctx, subject, predicates + chunk, values + chunk, count - chunk);
+
+    size_t numRead = 0;
+    unsigned long long readMask = 0;
+    auto readStatement = [&](const SordNode *predicate, const SordNode *object)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const unsigned long long bit = 1ULL << i;
+            if (!(readMask & bit) && predicates[i]->c_obj() == predicate)
+            {
+                if (numericFromRDF(ctx, object, *values[i]))
+                {
+                    readMask |= bit;
+                    ++numRead;
+                }
+                break;
+            }
+        }
+    };
+
+    if (const SubjectIndex *index = currentSubjectIndex(ctx))
+    {
+        SubjectIndex::const_iterator first, last;
+        index->find(subject.c_obj(), first, last);
+        for (; first != last && numRead < count; ++first)
+            readStatement(first->predicate, first->object);
+        return numRead;
+    }
+
+    SordIter *iter = sord_search(ctx.model.c_obj(), subject.c_obj(), NULL, NULL, NULL);
+    for (; iter && !sord_iter_end(iter) && numRead < count; sord_iter_next(iter))
+        readStatement(sord_iter_get_node(iter, SORD_PREDICATE), sord_iter_get_node(iter, SORD_OBJECT));
+    sord_iter_free(iter);
+    return numRead;
+}
+
+template <>
+inline bool fromRDF(const Context &ctx, const NodeRef _this0, double &value)
+{
+    return numericFromRDF(ctx, _this0, value);
+}
+
 template <>
 inline bool fromRDF(const Context &ctx, const NodeRef _this0, float &value)
 {
-    if (_this0.is_literal_type(SORD_NS_XSD "integer") ||
-        _this0.is_literal_type(SORD_NS_XSD "decimal") ||
-        _this0.is_literal_type(SORD_NS_XSD "double"))
+    return numericFromRDF(ctx, _this0, value);
+}
+
+#define ARVIDA_SORD_INTEGER_LITERAL(T)                                          \
+template<>                                                                      \
+inline NodeRef toRDF(const Context &ctx, NodeRef _this, const T &value)         \
+{                                                                               \
+    return numericToRDF(ctx, _this, value);                                     \
+}                                                                               \
+                                                                                \
+template <>                                                                     \
+inline bool fromRDF(const Context &ctx, const NodeRef _this0, T &value)         \
+{                                                                               \
+    return numericFromRDF(ctx, _this0, value);                                  \
+}
+
+ARVIDA_RDF_INTEGER_TYPES(ARVIDA_SORD_INTEGER_LITERAL)
+
+#undef ARVIDA_SORD_INTEGER_LITERAL
+
+template <>
+inline bool fromRDF(const Context &ctx, const NodeRef _this0, std::string &value)
+{
+    size_t length = 0;
+    const uint8_t *str = sord_node_get_string_counted(_this0.c_obj(), &length);
+    value.assign(reinterpret_cast<const char *>(str), length);
+    return true;
+}
+
+#ifdef ARVIDA_RDF_HAS_STRING_VIEW
+/**
+ * The view refers to the string of the node in the model, it is valid while the
+ * node is, setters taking std::string_view must copy it.
+ */
+template <>
+inline bool fromRDF(const Context &ctx, const NodeRef _this0, std::string_view &value)
+{
+    size_t length = 0;
+    const uint8_t *str = sord_node_get_string_counted(_this0.c_obj(), &length);
+    value = std::string_view(reinterpret_cast<const char *>(str), length);
+    return true;
+}
+#endif
+
+/**
+ * Serializes all elements of an array, std::array or std::vector of numbers as one
+ * literal with a PackedVocabulary datatype.
+ */
+template <class C>
+inline Sord::Node packedToRDF(const Context &ctx, const C &values)
+{
+    std::string &literal = ctx.state->literal_buffer;
+    const size_t index = encodePackedLiteral(values, literal);
+    ARVIDA_RDF_COUNT(ctx, nodes, 1);
+    ARVIDA_RDF_COUNT(ctx, bytes, literal.size());
+    const Sord::Node &datatype = vocabularyNode<PackedVocabulary>(ctx, index);
+
+    return Sord::Node(ctx.model.world(),
+        sord_new_literal(ctx.model.world().c_obj(), datatype.c_obj(), (const uint8_t*) literal.c_str(), NULL),
+        false);
+}
+
+/**
+ * Reads packed literal node written by packedToRDF, fails when the datatype does not
+ * match the element type or the number of elements of a fixed size array differs.
+ */
+template <class C>
+inline bool packedFromRDF(const Context &ctx, const Sord::Node &node, C &values)
+{
+    const SordNode *literal = node.c_obj();
+    const Sord::Node &datatype = vocabularyNode<PackedVocabulary>(ctx, PackedContainer<C>::packed_index);
+    if (!literal || sord_node_get_datatype(literal) != datatype.c_obj())
+        return false;
+
+    size_t length;
+    const char *str = (const char*) sord_node_get_string_counted(literal, &length);
+    ARVIDA_RDF_COUNT(ctx, literal_parses, 1);
+    return decodePackedLiteral(str, str + length, values);
+}
+
+// Delta serialization
+
+/**
+ * Returns a unique blank node of the World for nodes kept in a Delta. They are
+ * used by following updates, while labels of blankNode() restart with each root
+ * context of an empty model.
+ */
+inline Sord::Node deltaBlankNode(const Context &ctx)
+{
+    return Sord::Node::blank_id(ctx.model.world());
+}
+
+/**
+ * Statements last emitted by one member triple container for one subject.
+ */
+struct DeltaMember
+{
+    // Snapshot is valid, statements were emitted at least once
+    bool valid;
+    // Last scalar value, see deltaValueChanged
+    std::string value;
+    std::vector<Triple> triples;
+    // Statements of the current update
+    std::vector<Triple> next;
+    // Blank nodes of the member value (index 0) and of its elements (index 1 + i)
+    std::vector<Sord::Node> nodes;
+
+    DeltaMember() : valid(false) { }
+};
+
+struct DeltaSubject
+{
+    std::vector<Sord::Node> blanks;
+    std::vector<DeltaMember> members;
+};
+
+/**
+ * Snapshots of subjects serialized by toRDFDelta and statement sets of the current
+ * update. Blank nodes of a subject are created once, so unchanged members produce
+ * no statements. Call begin() before each update.
+ */
+class Delta
+{
+public:
+    std::vector<Triple> added;
+    std::vector<Triple> removed;
+
+    void begin()
     {
-        char* endptr;
-        value = serd_strtod(_this0.to_c_string(), &endptr);
-        return true;
+        added.clear();
+        removed.clear();
     }
 
+    // Forgets all snapshots, the next update emits all statements again
+    void reset()
+    {
+        subjects_.clear();
+        begin();
+    }
+
+    template <class T>
+    DeltaSubject & subject(const Context &ctx, const Sord::Node &node, size_t numBlanks, size_t numMembers)
+    {
+        SubjectEntry &entry = subjects_[node.c_obj()];
+        if (!entry.node.c_obj())
+            entry.node = node;
+        auto it = entry.classes.find(deltaClassId<T>());
+        if (it == entry.classes.end())
+        {
+            it = entry.classes.insert(std::make_pair(deltaClassId<T>(), DeltaSubject())).first;
+            it->second.blanks.reserve(numBlanks);
+            for (size_t i = 0; i < numBlanks; ++i)
+                it->second.blanks.push_back(deltaBlankNode(ctx));
+            it->second.members.resize(numMembers);
+        }
+        return it->second;
+    }
+
+    /**
+     * Moves the statements of node into removed and forgets its snapshot. Blank
+     * nodes of member values and elements belong to node and are removed with it,
+     * objects with a path may be referenced by other subjects and are kept.
+     */
+    void removeSubject(const Sord::Node &node)
+    {
+        auto it = subjects_.find(node.c_obj());
+        if (it == subjects_.end())
+            return;
+        std::vector<Sord::Node> owned;
+        for (auto &cls : it->second.classes)
+            for (auto &member : cls.second.members)
+            {
+                removed.insert(removed.end(), member.triples.begin(), member.triples.end());
+                for (const auto &slot : member.nodes)
+                    if (slot.is_blank())
+                        owned.push_back(slot);
+            }
+        subjects_.erase(it);
+        for (const auto &slot : owned)
+            removeSubject(slot);
+    }
+
+private:
+    struct SubjectEntry
+    {
+        // Keeps the interned key node alive
+        Sord::Node node;
+        std::unordered_map<size_t, DeltaSubject> classes;
+    };
+
+    std::unordered_map<const SordNode *, SubjectEntry> subjects_;
+};
+
+inline bool isSameTriple(const Triple &a, const Triple &b)
+{
+    return a.subject.c_obj() == b.subject.c_obj() &&
+        a.predicate.c_obj() == b.predicate.c_obj() &&
+        a.object.c_obj() == b.object.c_obj();
+}
+
+inline bool containsTriple(const std::vector<Triple> &triples, const Triple &triple)
+{
+    for (const auto &it : triples)
+        if (isSameTriple(it, triple))
+            return true;
     return false;
 }
 
-template <>
-inline bool fromRDF(const Context &ctx, const NodeRef _this0, std::string &value)
+/**
+ * Begins update of a member without value, returns false when its statements
+ * were already emitted.
+ */
+inline bool beginDeltaMember(DeltaMember &member)
 {
-    value = _this0.to_c_string();
+    if (member.valid)
+        return false;
+    member.next.clear();
     return true;
 }
 
+/**
+ * Begins update of a member, returns false when the value is a scalar equal to
+ * the snapshot.
+ */
+template <class T>
+inline bool beginDeltaMember(DeltaMember &member, const T &value)
+{
+    const bool changed = deltaValueChanged(member.value, value);
+    if (member.valid && !changed)
+        return false;
+    member.next.clear();
+    return true;
+}
+
+inline void addDeltaStatement(DeltaMember &member, const Sord::Node &subject, const Sord::Node &predicate, const Sord::Node &object)
+{
+    member.next.push_back(Triple(subject, predicate, object));
+}
+
+/**
+ * Compares statements of the current update with the snapshot of member and
+ * appends the differences to delta.
+ */
+inline void endDeltaMember(Delta &delta, DeltaMember &member)
+{
+    for (const auto &it : member.triples)
+        if (!containsTriple(member.next, it))
+            delta.removed.push_back(it);
+    for (const auto &it : member.next)
+        if (!containsTriple(member.triples, it))
+            delta.added.push_back(it);
+    member.triples.swap(member.next);
+    member.next.clear();
+    member.valid = true;
+}
+
+inline Sord::Node & deltaNodeSlot(DeltaMember &member, size_t index)
+{
+    if (index >= member.nodes.size())
+        member.nodes.resize(index + 1);
+    return member.nodes[index];
+}
+
+/**
+ * Ends the elements of a member after count elements were serialized: subjects of
+ * removed elements without path are removed with their slots.
+ */
+inline void endDeltaElements(Delta &delta, DeltaMember &member, size_t count)
+{
+    for (size_t i = count + 1; i < member.nodes.size(); ++i)
+        delta.removeSubject(member.nodes[i]);
+    if (member.nodes.size() > count + 1)
+        member.nodes.resize(count + 1);
+}
+
+/**
+ * Like toRDF, but statements of generated classes are passed to delta instead of
+ * the model. Only literals are serialized with toRDF, other values need an
+ * overload, e.g. generated with --delta.
+ */
+template < class T >
+inline NodeRef toRDFDelta(const Context &ctx, Delta &delta, NodeRef thisNode, const T &value)
+{
+    static_assert(DeltaLiteral<T>::value,
+                  "toRDFDelta is not defined for this type, generate its code with --delta");
+    return toRDF(ctx, thisNode, value);
+}
+
+template < class T >
+inline NodeRef toRDFDelta(const Context &ctx, Delta &delta, NodeRef thisNode, const std::shared_ptr<T> &value)
+{
+    if (value)
+        return toRDFDelta(ctx, delta, thisNode, *value);
+    if (!thisNode.is_blank())
+        thisNode = deltaBlankNode(ctx);
+    return thisNode;
+}
+
+/**
+ * Container referenced by $that, emits the same statements as toRDF. Elements get
+ * blank nodes that are kept in the snapshot of the container node.
+ */
+template < class T >
+inline NodeRef toRDFDelta(const Context &ctx, Delta &delta, NodeRef thisNode, const std::vector<T> &value)
+{
+    DeltaMember &member = delta.subject<std::vector<T> >(ctx, thisNode, 0, 1).members[0];
+    member.next.clear();
+    addDeltaStatement(member, thisNode,
+                      vocabularyNode<CoreVocabulary>(ctx, CoreVocabulary::RDF_TYPE),
+                      vocabularyNode<CoreVocabulary>(ctx, CoreVocabulary::CORE_CONTAINER));
+
+    const Sord::Node &memberNode = vocabularyNode<CoreVocabulary>(ctx, CoreVocabulary::CORE_MEMBER);
+    for (size_t i = 0; i < value.size(); ++i)
+    {
+        Sord::Node &slot = deltaNodeSlot(member, i + 1);
+        if (!slot.c_obj())
+            slot = deltaBlankNode(ctx);
+        Node elementNode(slot);
+        toRDFDelta(ctx, delta, elementNode, value[i]);
+        addDeltaStatement(member, thisNode, memberNode, elementNode);
+    }
+    endDeltaElements(delta, member, value.size());
+    endDeltaMember(delta, member);
+    return thisNode;
+}
+
+/**
+ * Same as createRDFNode / createRDFNodeAndSerialize for toRDFDelta, values without
+ * path use the blank node stored in slot.
+ */
+template<class T, class M>
+Node createDeltaNode(const Context &ctx, Delta &delta, Sord::Node &slot, const T &value,
+                     PathType memberPathType, const M &memberPath, bool serialize)
+{
+    const void *identity = serialize ? sharedIdentity(value) : 0;
+    if (identity)
+    {
+        auto it = ctx.state->shared.find(identity);
+        if (it != ctx.state->shared.end())
+            return it->second;
+    }
+
+    const PathType thatPathType = pathTypeOf(ctx, value);
+    if (thatPathType == NO_PATH)
+    {
+        if (!slot.c_obj())
+            slot = deltaBlankNode(ctx);
+        Node thatNode(slot);
+        if (identity)
+            ctx.state->shared.insert(std::make_pair(identity, thatNode));
+        if (serialize)
+            toRDFDelta(ctx, delta, thatNode, value);
+        return thatNode;
+    }
+    else
+    {
+        const std::string &thatPath = memberNodePath(ctx, value, thatPathType, memberPathType, memberPath);
+        ARVIDA_RDF_COUNT(ctx, bytes, thatPath.size());
+        Arvida::RDF::Context thatCtx(ctx, thatPath);
+        Sord::URI thatNode(ctx.model.world(), thatPath);
+        if (identity)
+            ctx.state->shared.insert(std::make_pair(identity, thatNode));
+        if (serialize)
+            toRDFDelta(thatCtx, delta, thatNode, value);
+        return thatNode;
+    }
+}
+
+/**
+ * Removes the statements of delta.removed from model and adds delta.added.
+ */
+inline void applyDelta(Sord::Model &model, const Delta &delta)
+{
+    for (const auto &it : delta.removed)
+    {
+        SordQuad quad = { it.subject.c_obj(), it.predicate.c_obj(), it.object.c_obj(), NULL };
+        sord_remove(model.c_obj(), quad);
+    }
+    for (const auto &it : delta.added)
+        model.add_statement(it.subject, it.predicate, it.object);
+}
+
+// Batches
+
+typedef std::unordered_map<const SordNode *, Sord::Node> ImportedNodes;
+
+/**
+ * Returns node of another World as node of world. Blank nodes get new identifiers
+ * of world, imported keeps them consistent within one source model.
+ */
+inline Sord::Node importNode(Sord::World &world, const SordNode *node, ImportedNodes &imported)
+{
+    if (!node)
+        return Sord::Node();
+    auto it = imported.find(node);
+    if (it != imported.end())
+        return it->second;
+
+    Sord::Node result;
+    const uint8_t *str = sord_node_get_string(node);
+    switch (sord_node_get_type(node))
+    {
+        case SORD_URI:
+            result = Sord::Node(world, sord_new_uri(world.c_obj(), str), false);
+            break;
+        case SORD_BLANK:
+            result = Sord::Node::blank_id(world);
+            break;
+        case SORD_LITERAL:
+        {
+            const Sord::Node datatype = importNode(world, sord_node_get_datatype(node), imported);
+            result = Sord::Node(world,
+                sord_new_literal(world.c_obj(), datatype.c_obj(), str, sord_node_get_language(node)),
+                false);
+            break;
+        }
+    }
+    imported.insert(std::make_pair(node, result));
+    return result;
+}
+
+/**
+ * Copies all statements of source into model, source and model may belong to
+ * different Worlds.
+ */
+inline void mergeModel(Sord::Model &model, const Sord::Model &source, ImportedNodes &imported)
+{
+    Sord::World &world = model.world();
+    SordQuad quad;
+    SordIter *iter = sord_begin(source.c_obj());
+    for (; !sord_iter_end(iter); sord_iter_next(iter))
+    {
+        sord_iter_get(iter, quad);
+        model.add_statement(importNode(world, quad[SORD_SUBJECT], imported),
+                            importNode(world, quad[SORD_PREDICATE], imported),
+                            importNode(world, quad[SORD_OBJECT], imported));
+    }
+    sord_iter_free(iter);
+}
+
+inline SerdStatus copyPrefix(void *handle, const SerdNode *name, const SerdNode *uri)
+{
+    static_cast<Sord::World *>(handle)->add_prefix(
+        std::string((const char *) name->buf, name->n_bytes),
+        std::string((const char *) uri->buf, uri->n_bytes));
+    return SERD_SUCCESS;
+}
+
+/**
+ * Serializes objects of [first, last) into model like members without path and
+ * returns their nodes in the same order.
+ *
+ * The range is split into BATCH_SHARDS_PER_WORKER shards per worker, which are
+ * serialized on num_workers threads (0 = one per hardware thread) into models of
+ * private Worlds with copies of the prefixes of model.world(). The calling thread
+ * merges each shard into model as soon as it is finished, with a cache of the
+ * imported nodes of the shard, so blank node identifiers are allocated only by
+ * model.world(); they depend on the order in which the shards finish. Objects
+ * referenced from several shards are serialized once per shard.
+ */
+template <class RandomIt>
+std::vector<Sord::Node> toRDFBatch(Sord::Model &model, const std::string &path, RandomIt first, RandomIt last,
+                                   size_t num_workers = 0, const void *user_data = 0)
+{
+    const size_t count = static_cast<size_t>(last - first);
+    std::vector<Sord::Node> nodes;
+    num_workers = batchWorkerCount(count, num_workers);
+
+    if (num_workers == 1)
+    {
+        nodes.reserve(count);
+        Context ctx(model, path, 0, user_data);
+        for (RandomIt it = first; it != last; ++it)
+            nodes.push_back(createRDFNodeAndSerialize(ctx, *it, NO_PATH, ""));
+        return nodes;
+    }
+
+    struct Shard
+    {
+        std::unique_ptr<Sord::World> world;
+        std::unique_ptr<Sord::Model> model;
+        size_t begin;
+        std::vector<Sord::Node> nodes;
+    };
+
+    // Worlds are created on the calling thread, worker threads only use their own
+    const size_t num_shards = batchShardCount(count, num_workers);
+    std::vector<Shard> shards(num_shards);
+    for (auto &shard : shards)
+    {
+        shard.world.reset(new Sord::World());
+        serd_env_foreach(model.world().prefixes().c_obj(), copyPrefix, shard.world.get());
+        shard.model.reset(new Sord::Model(*shard.world, path));
+    }
+    nodes.resize(count);
+
+    runShards(count, num_workers, num_shards, [&](size_t index, size_t begin, size_t end)
+    {
+        Shard &shard = shards[index];
+        Context ctx(*shard.model, path, 0, user_data);
+        shard.begin = begin;
+        shard.nodes.reserve(end - begin);
+        for (size_t i = begin; i != end; ++i)
+            shard.nodes.push_back(createRDFNodeAndSerialize(ctx, first[i], NO_PATH, ""));
+    },
+    [&](size_t index)
+    {
+        Shard &shard = shards[index];
+        {
+            ImportedNodes imported;
+            mergeModel(model, *shard.model, imported);
+            for (size_t i = 0; i != shard.nodes.size(); ++i)
+                nodes[shard.begin + i] = importNode(model.world(), shard.nodes[i].c_obj(), imported);
+        }
+        shard.nodes.clear();
+        shard.model.reset();
+        shard.world.reset();
+    });
+    return nodes;
+}
+
+
+/**
+ * World, ContextState and model kept between messages. Vocabulary nodes, cached
+ * nodes, path buffers and the memory of visited nodes are reused, reset() only
+ * replaces the model, so nodes that are still referenced by the state stay
+ * interned by the World.
+ *
+ *   SordSession session(base_uri);
+ *   for (...)
+ *   {
+ *       Context ctx = session.context(path);
+ *       toRDF(ctx, node, value);
+ *       send(session.model().write_to_string(session.baseURI()));
+ *       session.reset();
+ *   }
+ */
+class SordSession
+{
+public:
+
+    explicit SordSession(const std::string &base_uri)
+        : base_uri_(base_uri), state_(world_), model_(new Sord::Model(world_, base_uri_))
+    {
+    }
+
+    // The World has copies of the prefixes of prefixes_world, which is only read
+    SordSession(Sord::World &prefixes_world, const std::string &base_uri)
+        : base_uri_(base_uri), state_(world_)
+    {
+        serd_env_foreach(prefixes_world.prefixes().c_obj(), copyPrefix, &world_);
+        model_.reset(new Sord::Model(world_, base_uri_));
+    }
+
+    SordSession(const SordSession &) = delete;
+    SordSession & operator=(const SordSession &) = delete;
+
+    Sord::World & world() { return world_; }
+    Sord::Model & model() { return *model_; }
+    ContextState & state() { return state_; }
+    const std::string & baseURI() const { return base_uri_; }
+
+    // Root context of the model, path is referenced by the context
+    Context context(const std::string &path, Cache *cache = 0, const void *user_data = 0)
+    {
+        return Context(*model_, path, cache, user_data, &state_);
+    }
+
+    // Starts the next message with an empty model
+    void reset()
+    {
+        model_.reset();
+        model_.reset(new Sord::Model(world_, base_uri_));
+    }
+
+private:
+    Sord::World world_;
+    std::string base_uri_;
+    ContextState state_;
+    std::unique_ptr<Sord::Model> model_;
+};
+
+/**
+ * Buffer of a Pipeline: a session with a private World that is serialized with
+ * Sord::Model::write_to_string. The World has copies of the prefixes of
+ * prefixes_world, which is only read by the constructor.
+ *
+ *   Pipeline<SordPipelineBuffer> pipeline(fileDescriptorSink(fd), 2, world, base_uri);
+ *   SordPipelineBuffer &buffer = pipeline.acquire();
+ *   Context ctx = buffer.context(path);
+ *   toRDF(ctx, node, value);
+ *   pipeline.submit(buffer);
+ */
+class SordPipelineBuffer : public SordSession
+{
+public:
+
+    SordPipelineBuffer(Sord::World &prefixes_world, const std::string &base_uri, SerdSyntax syntax = SERD_TURTLE)
+        : SordSession(prefixes_world, base_uri), syntax_(syntax)
+    {
+    }
+
+    void serialize(std::string &data)
+    {
+        data = model().write_to_string(baseURI(), syntax_);
+    }
+
+    void clear()
+    {
+        reset();
+    }
+
+private:
+    SerdSyntax syntax_;
+};
+
 } // namespace Arvida
 } // namespace RDF
 
@@ -0,0 +1,268 @@
+/*  ARVIDAPP - ARVIDA C++ Preprocessor
+ *
+ *  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef SORD_TABLE_RDF_TRAITS_HPP_INCLUDED
+#define SORD_TABLE_RDF_TRAITS_HPP_INCLUDED
+
+#include "SordRDFTraits.hpp"
+#include <vector>
+
+namespace Arvida {
+namespace RDF {
+
+/**
+ * TableDescriptor<T>::get() returns the Table::Class descriptor of annotated class T,
+ * specializations are generated by the sord_table template.
+ */
+template <class T>
+struct TableDescriptor;
+
+/**
+ * Descriptors of annotated classes and the interpreter used by code of the sord_table
+ * template. Instead of code for every statement the template emits one constant table
+ * per class with the statement patterns of its members, and small accessor functions
+ * that convert member values to and from nodes.
+ */
+namespace Table {
+
+enum TermKind
+{
+    THIS,   // $this
+    THAT,   // $that, the node of the member value
+    BLANK,  // _:N, index is the blank node slot of the class
+    TERM    // prefixed name, index is the term in the vocabulary table of the class
+};
+
+struct Term
+{
+    TermKind kind;
+    unsigned index;
+};
+
+struct Statement
+{
+    Term subject;
+    Term predicate;
+    Term object;
+};
+
+typedef const Sord::Node & (*VocabularyFunction)(const Context &ctx, size_t index);
+// Returns false when the member value is not valid and its statements are skipped
+typedef bool (*WriteValueFunction)(const Context &ctx, const void *object, Sord::Node &that_node);
+typedef bool (*ReadValueFunction)(const Context &ctx, Sord::Node &that_node, void *object);
+// Members that refer to container elements are generated as code
+typedef void (*WriteMemberFunction)(const Context &ctx, Sord::Node &_this, Sord::Node *blanks, const void *object);
+typedef bool (*ReadMemberFunction)(const Context &ctx, Sord::Node &_this, Sord::Node *blanks, void *object);
+
+/**
+ * Statements of one annotated member, or of the class annotations when scope is null.
+ * Statements are ordered like the lookups of the sord template.
+ */
+struct Member
+{
+    const char *scope;
+    bool writer;
+    bool reader;
+    unsigned first_statement;
+    unsigned num_statements;
+    WriteValueFunction write_value;
+    ReadValueFunction read_value;
+    WriteMemberFunction write_member;
+    ReadMemberFunction read_member;
+};
+
+struct Class
+{
+    unsigned num_blanks;
+    const Statement *statements;
+    const Member *members;
+    unsigned num_members;
+    VocabularyFunction vocabulary;
+};
+
+/**
+ * Blank node slots of one object, kept on the stack for classes with few blank nodes.
+ */
+class BlankNodes
+{
+public:
+
+    explicit BlankNodes(size_t size) : heap_(size > local_size ? size : 0)
+    {
+        nodes_ = size > local_size ? heap_.data() : local_;
+    }
+
+    BlankNodes(const BlankNodes &) = delete;
+    BlankNodes & operator=(const BlankNodes &) = delete;
+
+    Sord::Node * data() { return nodes_; }
+    Sord::Node & operator[](size_t index) { return nodes_[index]; }
+
+private:
+    static const size_t local_size = 8;
+    Sord::Node local_[local_size];
+    std::vector<Sord::Node> heap_;
+    Sord::Node *nodes_;
+};
+
+#ifdef ARVIDA_RDF_INSTRUMENTATION
+
+// Makes scope of member current while the descriptor of member is interpreted
+class MemberScope
+{
+public:
+    MemberScope(const Context &ctx, const Member &member)
+        : scope_(member.scope ? ctx.state->instrumentation : 0,
+                 member.scope && ctx.state->instrumentation ? instrumentationScopeId(member.scope) : 0)
+    {
+    }
+
+private:
+    InstrumentationScope scope_;
+};
+
+#else
+
+class MemberScope
+{
+public:
+    MemberScope(const Context &, const Member &) { }
+};
+
+#endif
+
+inline const Sord::Node & node(const Context &ctx, const Class &cls, const Term &term,
+                               const Sord::Node &_this, const Sord::Node &that_node, const Sord::Node *blanks)
+{
+    switch (term.kind)
+    {
+        case THIS:
+            return _this;
+        case THAT:
+            return that_node;
+        case BLANK:
+            return blanks[term.index];
+        default:
+            return cls.vocabulary(ctx, term.index);
+    }
+}
+
+/**
+ * Stores a node found by a lookup in the slot referred by term, reads member value
+ * for $that.
+ */
+inline bool bindNode(const Context &ctx, const Member &member, const Term &term, Sord::Node &found,
+                     Sord::Node &_this, Sord::Node *blanks, void *object)
+{
+    switch (term.kind)
+    {
+        case THIS:
+            _this = found;
+            return true;
+        case THAT:
+            return member.read_value(ctx, found, object);
+        case BLANK:
+            blanks[term.index] = found;
+            return true;
+        default:
+            return true;
+    }
+}
+
+/**
+ * Writes statements of all members of cls for object, like toRDF of the sord template.
+ */
+inline NodeRef toRDF(const Context &ctx, NodeRef _this, const Class &cls, const void *object)
+{
+    BlankNodes blanks(cls.num_blanks);
+    for (unsigned i = 0; i < cls.num_blanks; ++i)
+        blanks[i] = blankNode(ctx);
+
+    for (const Member *member = cls.members, *end = cls.members + cls.num_members; member != end; ++member)
+    {
+        if (!member->writer)
+            continue;
+        // Generated member functions enter their scope themselves
+        if (member->write_member)
+        {
+            member->write_member(ctx, _this, blanks.data(), object);
+            continue;
+        }
+
+        MemberScope scope(ctx, *member);
+        Sord::Node that_node;
+        if (member->write_value && !member->write_value(ctx, object, that_node))
+            continue;
+        const Statement *statement = cls.statements + member->first_statement;
+        for (const Statement *last = statement + member->num_statements; statement != last; ++statement)
+        {
+            addStatement(ctx,
+                         node(ctx, cls, statement->subject, _this, that_node, blanks.data()),
+                         node(ctx, cls, statement->predicate, _this, that_node, blanks.data()),
+                         node(ctx, cls, statement->object, _this, that_node, blanks.data()));
+        }
+    }
+    return _this;
+}
+
+/**
+ * Reads all members of cls into object, like fromRDF of the sord template. Lookups of
+ * $that and of blank nodes that are not bound yet match any node.
+ */
+inline bool fromRDF(const Context &ctx, NodeRef _this, const Class &cls, void *object)
+{
+    BlankNodes blanks(cls.num_blanks);
+    const Sord::Node any;
+    for (const Member *member = cls.members, *end = cls.members + cls.num_members; member != end; ++member)
+    {
+        if (!member->reader)
+            continue;
+        if (member->read_member)
+        {
+            if (!member->read_member(ctx, _this, blanks.data(), object))
+                return false;
+            continue;
+        }
+
+        MemberScope scope(ctx, *member);
+        const Statement *statement = cls.statements + member->first_statement;
+        for (const Statement *last = statement + member->num_statements; statement != last; ++statement)
+        {
+            Triple triple = find_triple(ctx,
+                                        node(ctx, cls, statement->subject, _this, any, blanks.data()),
+                                        node(ctx, cls, statement->predicate, _this, any, blanks.data()),
+                                        node(ctx, cls, statement->object, _this, any, blanks.data()));
+            ARVIDA_RDF_COUNT(ctx, lookups, 1);
+            if (!triple.is_valid())
+            {
+                ARVIDA_RDF_COUNT(ctx, lookup_misses, 1);
+                return false;
+            }
+            if (!bindNode(ctx, *member, statement->subject, triple.subject, _this, blanks.data(), object) ||
+                !bindNode(ctx, *member, statement->object, triple.object, _this, blanks.data(), object))
+                return false;
+        }
+    }
+    return true;
+}
+
+} // namespace Table
+
+} // namespace RDF
+} // namespace Arvida
+
+#endif
@@ -91,6 +91,7 @@ void   arvida_global_annotation_func(const char *str, ...);
 #define RdfAbsoluteElementPath(path)  ArvidaMemberAnnotationBegin("absolute-element-path") ArvidaMemberAnnotation(path) ArvidaMemberAnnotationEnd()
 #define RdfUseVisitor() ArvidaMemberAnnotationBegin("use-visitor") ArvidaMemberAnnotationEnd()
 #define RdfInclude(include) ArvidaMemberAnnotationBegin("include") ArvidaMemberAnnotation(include) ArvidaMemberAnnotationEnd()
+#define RdfPacked() ArvidaMemberAnnotationBegin("packed") ArvidaMemberAnnotationEnd()
 
 #define RdfStmt(a, b, c)                           \
     ArvidaMemberAnnotationBegin("triple")          \
@@ -138,6 +139,9 @@ void   arvida_global_annotation_func(const char *str, ...);
 #define arvida_member_path(member_name, path)                                       \
         "arvida-member-path", #member_name, path, "arvida-eop"
 
+#define arvida_member_packed(member_name)                                           \
+        "arvida-member-packed", #member_name, "arvida-eop"
+
 #define arvida_member_absolute_path(member_name, path)                              \
         "arvida-member-absolute-path", #member_name, path, "arvida-eop"
 
@@ -182,6 +186,7 @@ void   arvida_global_annotation_func(const char *str, ...);
 #define RdfAbsoluteElementPath(path)
 #define RdfUseVisitor()
 #define RdfInclude(include)
+#define RdfPacked()
 #define RdfStmt(a, b, c)
 #define RdfCreateElement(name)
 
@@ -201,6 +206,7 @@ void   arvida_global_annotation_func(const char *str, ...);
 #define arvida_member_stmt(member_name, a, b, c)
 #define arvida_member_create_element(member_name, name)
 #define arvida_member_path(member_name, path)
+#define arvida_member_packed(member_name)
 #define arvida_member_absolute_path(member_name, path)
 #define arvida_member_element_path(member_name, path)
 #define arvida_member_absolute_element_path(member_name, path)
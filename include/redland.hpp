@@ -32,6 +32,7 @@
 #include <string>
 #include <sstream>
 #include <map>
+#include <vector>
 
 // Macros from Boost C++ Libraries
 
@@ -110,10 +111,10 @@ protected:
     CObjWrapper(T *c_obj) : c_obj_(c_obj) { }
     CObjWrapper(CObjWrapper && other) : c_obj_(other.release()) { }
 
+    // Swaps objects, the previous object of this wrapper is freed by the destructor of other
     CObjWrapper & operator=(CObjWrapper && other)
     {
-        if (this != &other)
-            c_obj_ = other.release();
+        std::swap(c_obj_, other.c_obj_);
         return *this;
     }
 
@@ -314,6 +315,10 @@ class Node : public CObjWrapper<librdf_node>
 {
 public:
 
+    Node()
+        : CObjWrapper(NULL)
+    { }
+
     Node(librdf_node *node)
         : CObjWrapper(node)
     { }
@@ -326,9 +331,9 @@ public:
     }
 
     Node(const Node &other)
-        : CObjWrapper(librdf_new_node_from_node(other.c_obj()))
+        : CObjWrapper(other.c_obj() ? librdf_new_node_from_node(other.c_obj()) : NULL)
     {
-        if (!c_obj_)
+        if (!c_obj_ && other.c_obj())
             throw AllocException("librdf_new_node_from_node");
     }
 
@@ -339,15 +344,22 @@ public:
 
     Node & operator=(Node && other)
     {
-        return static_cast<Node&>(CObjWrapper::operator=(std::move(other)));
+        if (this != &other)
+        {
+            if (c_obj_)
+                librdf_free_node(c_obj_);
+            c_obj_ = other.release();
+        }
+        return *this;
     }
 
     Node & operator=(const Node & other)
     {
         if (this != &other)
         {
-            librdf_free_node(c_obj_);
-            c_obj_ = librdf_new_node_from_node(other.c_obj());
+            if (c_obj_)
+                librdf_free_node(c_obj_);
+            c_obj_ = other.c_obj() ? librdf_new_node_from_node(other.c_obj()) : NULL;
         }
         return *this;
     }
@@ -379,8 +391,15 @@ public:
     {
     }
 
+    Node(const World &world, const unsigned char *value, size_t length, librdf_uri *datatype_uri)
+        : CObjWrapper(librdf_new_node_from_typed_counted_literal(world.c_obj(), value, length, NULL, 0, datatype_uri))
+    {
+        if (!c_obj_)
+            throw AllocException("librdf_new_node_from_typed_counted_literal");
+    }
+
     Node(const World &world, const std::string &value, const Uri &datatype_uri)
-        : Node(world, (const unsigned char *)value.c_str(), datatype_uri)
+        : Node(world, (const unsigned char *)value.data(), value.size(), datatype_uri.c_obj())
     {
     }
 
@@ -414,6 +433,8 @@ public:
         : Node(world, (const unsigned char *)NULL, tag)
     { }
 
+    bool is_valid() const { return c_obj_ != NULL; }
+
     bool is_blank() const { return librdf_node_is_blank(c_obj_); }
 
     bool is_literal() const { return librdf_node_is_literal(c_obj_); }
@@ -446,6 +467,11 @@ public:
         return Node(world, value, datatype_uri);
     }
 
+    static Node make_typed_literal_node(const World &world, const char *value, size_t length, librdf_uri *datatype_uri)
+    {
+        return Node(world, (const unsigned char *)value, length, datatype_uri);
+    }
+
     static Node make_uri_node(const World &world, const char *uri_string)
     {
         return Node(world, uri_string);
@@ -456,9 +482,24 @@ public:
         return Node(world, uri_string);
     }
 
+    std::string get_literal_value() const
+    {
+        const unsigned char *value = librdf_node_get_literal_value(c_obj_);
+        return value ? reinterpret_cast<const char *>(value) : "";
+    }
+
+    // Literal value without copy and its length in bytes, valid while the node is
+    const char * get_literal_value(size_t &length) const
+    {
+        length = 0;
+        const unsigned char *value = librdf_node_get_literal_value_as_counted_string(c_obj_, &length);
+        return value ? reinterpret_cast<const char *>(value) : "";
+    }
+
     ~Node()
     {
-        librdf_free_node(c_obj_);
+        if (c_obj_)
+            librdf_free_node(c_obj_);
     }
 
 };
@@ -539,6 +580,156 @@ public:
 
 };
 
+/**
+ * Statement on the stack that refers to nodes without taking references, for passing
+ * nodes to functions that copy the statement, e.g. librdf_model_add_statement.
+ * The nodes must outlive the statement.
+ */
+class BorrowedStatement
+{
+public:
+
+    BorrowedStatement(const World &world, const Node &subject, const Node &predicate, const Node &object)
+    {
+        librdf_statement_init(world.c_obj(), &statement_);
+        librdf_statement_set_subject(&statement_, subject.c_obj());
+        librdf_statement_set_predicate(&statement_, predicate.c_obj());
+        librdf_statement_set_object(&statement_, object.c_obj());
+    }
+
+    BorrowedStatement(const BorrowedStatement &other) = delete;
+    BorrowedStatement & operator=(const BorrowedStatement &other) = delete;
+
+    ~BorrowedStatement()
+    {
+        // Nodes are not owned, librdf_statement_clear would free them
+        librdf_statement_set_subject(&statement_, NULL);
+        librdf_statement_set_predicate(&statement_, NULL);
+        librdf_statement_set_object(&statement_, NULL);
+    }
+
+    librdf_statement * c_obj() const { return &statement_; }
+
+private:
+    mutable librdf_statement statement_;
+};
+
+/**
+ * Statements collected for Model::add_statements. Nodes passed as rvalues are moved
+ * into the batch, other nodes are referenced.
+ */
+class StatementBatch
+{
+public:
+
+    StatementBatch() { }
+
+    StatementBatch(const StatementBatch &other) = delete;
+    StatementBatch & operator=(const StatementBatch &other) = delete;
+
+    ~StatementBatch()
+    {
+        clear();
+    }
+
+    template <class N1, class N2, class N3>
+    void add(N1 &&subject, N2 &&predicate, N3 &&object)
+    {
+        nodes_.reserve(nodes_.size() + 3);
+        nodes_.push_back(take(std::forward<N1>(subject)));
+        nodes_.push_back(take(std::forward<N2>(predicate)));
+        nodes_.push_back(take(std::forward<N3>(object)));
+    }
+
+    size_t size() const { return nodes_.size() / 3; }
+
+    bool empty() const { return nodes_.empty(); }
+
+    void reserve(size_t statements) { nodes_.reserve(statements * 3); }
+
+    void clear()
+    {
+        for (librdf_node *node : nodes_)
+            if (node)
+                librdf_free_node(node);
+        nodes_.clear();
+    }
+
+    /**
+     * Returns new stream over the statements, the batch must not be changed until the
+     * stream is freed. Statements of the stream are valid until the next call of
+     * librdf_stream_next.
+     */
+    librdf_stream * as_stream(const World &world) const
+    {
+        Cursor *cursor = new Cursor(world, nodes_);
+        librdf_stream *stream = librdf_new_stream(world.c_obj(), cursor,
+                                                  &Cursor::is_end, &Cursor::next, &Cursor::get, &Cursor::finished);
+        if (!stream)
+            throw AllocException("librdf_new_stream");
+        return stream;
+    }
+
+private:
+
+    static librdf_node * take(Node &&node)
+    {
+        return node.release();
+    }
+
+    static librdf_node * take(const Node &node)
+    {
+        return node.c_obj() ? librdf_new_node_from_node(node.c_obj()) : NULL;
+    }
+
+    struct Cursor
+    {
+        const std::vector<librdf_node *> &nodes;
+        size_t index;
+        librdf_statement statement;
+
+        Cursor(const World &world, const std::vector<librdf_node *> &nodes)
+            : nodes(nodes), index(0)
+        {
+            librdf_statement_init(world.c_obj(), &statement);
+        }
+
+        static int is_end(void *context)
+        {
+            Cursor *cursor = static_cast<Cursor *>(context);
+            return cursor->index >= cursor->nodes.size();
+        }
+
+        static int next(void *context)
+        {
+            Cursor *cursor = static_cast<Cursor *>(context);
+            cursor->index += 3;
+            return is_end(context);
+        }
+
+        static void * get(void *context, int flags)
+        {
+            Cursor *cursor = static_cast<Cursor *>(context);
+            if (flags != LIBRDF_ITERATOR_GET_METHOD_GET_OBJECT)
+                return NULL;
+            librdf_statement_set_subject(&cursor->statement, cursor->nodes[cursor->index]);
+            librdf_statement_set_predicate(&cursor->statement, cursor->nodes[cursor->index + 1]);
+            librdf_statement_set_object(&cursor->statement, cursor->nodes[cursor->index + 2]);
+            return &cursor->statement;
+        }
+
+        static void finished(void *context)
+        {
+            Cursor *cursor = static_cast<Cursor *>(context);
+            librdf_statement_set_subject(&cursor->statement, NULL);
+            librdf_statement_set_predicate(&cursor->statement, NULL);
+            librdf_statement_set_object(&cursor->statement, NULL);
+            delete cursor;
+        }
+    };
+
+    std::vector<librdf_node *> nodes_;
+};
 
 class Model : public CObjWrapper<librdf_model>
 {
@@ -578,13 +769,83 @@ public:
         return librdf_model_add_statement(c_obj_, statement.c_obj()) == 0;
     }
 
-    template <class N1, class N2, class N3>
-    bool add_statement(const World &world, N1 &&subject, N2 &&predicate, N3 &&object)
+    // The model copies the nodes, no statement is allocated
+    bool add_statement(const World &world, const Node &subject, const Node &predicate, const Node &object)
+    {
+        BorrowedStatement statement(world, subject, predicate, object);
+        return librdf_model_add_statement(c_obj_, statement.c_obj()) == 0;
+    }
+
+    bool add_statements(librdf_stream *stream)
+    {
+        return librdf_model_add_statements(c_obj_, stream) == 0;
+    }
+
+    // Adds all statements of batch and clears it
+    bool add_statements(const World &world, StatementBatch &batch)
+    {
+        if (batch.empty())
+            return true;
+        librdf_stream *stream = batch.as_stream(world);
+        const bool result = add_statements(stream);
+        librdf_free_stream(stream);
+        batch.clear();
+        return result;
+    }
+
+    bool remove_statement(const Statement &statement)
+    {
+        return librdf_model_remove_statement(c_obj_, statement.c_obj()) == 0;
+    }
+
+    bool remove_statement(const World &world, const Node &subject, const Node &predicate, const Node &object)
+    {
+        BorrowedStatement statement(world, subject, predicate, object);
+        return librdf_model_remove_statement(c_obj_, statement.c_obj()) == 0;
+    }
+
+};
+
+class Serializer : public CObjWrapper<librdf_serializer>
+{
+public:
+
+    Serializer(const World &world, const char *name, const char *mime_type = NULL, librdf_uri *type_uri = NULL)
+        : CObjWrapper(librdf_new_serializer(world.c_obj(), name, mime_type, type_uri))
+    {
+        if (!c_obj_)
+            throw AllocException("librdf_new_serializer");
+    }
+
+    Serializer(const Serializer &) = delete;
+
+    Serializer(Serializer && other)
+        : CObjWrapper(std::move(other))
+    {
+    }
+
+    Serializer & operator=(Serializer && other)
+    {
+        return static_cast<Serializer&>(CObjWrapper::operator=(std::move(other)));
+    }
+
+    Serializer & operator=(const Serializer & other) = delete;
+
+    ~Serializer()
+    {
+        librdf_free_serializer(c_obj_);
+    }
+
+    // Appends serialization of model to data
+    bool serialize_model(const Model &model, librdf_uri *base_uri, std::string &data)
     {
-        return add_statement(Statement(world,
-            std::forward<N1>(subject),
-            std::forward<N2>(predicate),
-            std::forward<N3>(object)));
+        size_t length = 0;
+        unsigned char *result = librdf_serializer_serialize_model_to_counted_string(c_obj_, base_uri, model.c_obj(), &length);
+        if (!result)
+            return false;
+        data.append((const char *) result, length);
+        librdf_free_memory(result);
+        return true;
     }
 
 };
@@ -0,0 +1,43 @@
+{# Variant of the sord template for BinaryRDFTraits.hpp, generated code only differs by the traits it includes #}
+{% import 'sord.cpp' as unrolled %}
+
+{# ---------------------------------------------------------------------------- #}
+{# Main #}
+
+{% macro main(env, include_files, include_file) %}
+/** This file was generated by ARVIDA C++ preprocessor **/
+{% for it in env.prolog %}
+{{ it }}
+{% endfor %}
+#include "BinaryRDFTraits.hpp"
+{% for it in env.includes %}
+#include {{it}}
+{% endfor %}
+namespace Arvida
+{
+namespace RDF
+{
+
+{{ unrolled.make_vocabulary(env.vocabulary) }}
+{% for c in env.annotated_classes %}
+{{ unrolled.make_pathOf(c)}}
+{% endfor %}
+
+{% for c in env.annotated_classes %}
+{{ unrolled.make_toRDF(c)}}
+{% endfor %}
+
+
+
+{% for c in env.annotated_classes %}
+{{ unrolled.make_fromRDF(c)}}
+{% endfor %}
+
+
+} // namespace Arvida
+} // namespace RDF
+{% for it in env.epilog %}
+{{ it }}
+{% endfor %}
+
+{% endmacro %}
@@ -0,0 +1,369 @@
+{# Vocabulary #}
+
+{% macro vocabulary_node_expr(value) %}
+Arvida::RDF::vocabularyNode<{{ value.vocabulary.name }}>(ctx, {{ value.vocabulary_index }} /* {{ value.value }} */)
+{%- endmacro %}
+
+{% macro make_vocabulary(vocabulary) %}
+{% if vocabulary %}
+#ifndef ARVIDA_{{ vocabulary.name | upper }}_DEFINED
+#define ARVIDA_{{ vocabulary.name | upper }}_DEFINED
+struct {{ vocabulary.name }}
+{
+    static const size_t size = {{ vocabulary | length }};
+
+    static const char * term(size_t index)
+    {
+        static const char * const terms[size] = {
+            {% for it in vocabulary.terms %}
+            {{ it }}{% if not loop.last %},{% endif %}
+
+            {% endfor %}
+        };
+        return terms[index];
+    }
+
+    static const char * iri(size_t index)
+    {
+        static const char * const iris[size] = {
+            {% for it in vocabulary.iris %}
+            {{ it or 0 }}{% if not loop.last %},{% endif %}
+
+            {% endfor %}
+        };
+        return iris[index];
+    }
+};
+#endif
+
+{% endif %}
+{% endmacro %}
+
+{# Writer #}
+
+{% macro member_ref(mtc, arg='') %}
+value.{{mtc.member.name}}{% if mtc.is_function() %}({{arg}}){% endif %}
+{% endmacro %}
+
+{# Declares _that as the value of the getter, getters with an output argument write to a local value #}
+{% macro define_that(mtc) %}
+{% if mtc.get_getter_output_type() %}
+{{ mtc.get_getter_output_type() }} _that{};
+{{ member_ref(mtc, arg='_that') }};
+{% else %}
+const auto & _that = {{ member_ref(mtc) }};
+{% endif %}
+{% endmacro %}
+
+{% macro define_blank_node(value) %}
+Node {{ value.var_name }} = Arvida::RDF::blankNode(ctx);
+{% endmacro %}
+
+{% macro make_writer_triple_statement(mtc, triple) %}
+ctx.writer.add_statement({{make_writer_node_expr(mtc=mtc, value=triple.subject)}}, {{make_writer_node_expr(mtc=mtc, value=triple.predicate)}}, {{make_writer_node_expr(mtc=mtc, value=triple.object)}});
+ARVIDA_RDF_COUNT(ctx, statements, 1);
+{% endmacro %}
+
+// Example: <({make_writer_<triple.subject.kind>_defs})(mtc=mtc, value=triple.subject)>
+
+{% macro make_writer_node_expr(mtc, value) %}
+{% if value.is_this_ref() -%}
+_this
+{%- elif value.is_that_ref() -%}
+that_node
+{%- elif value.is_that_element_ref() -%}
+element_node
+{%- elif value.is_prefixed_name() -%}
+{{ vocabulary_node_expr(value) }}
+{%- elif value.that_element_ref -%}
+element_node
+{%- elif value.is_blank_node() -%}
+{{ value.var_name }}
+{%- else -%}
+UNKNOWN EXPR
+{%- endif -%}
+{% endmacro %}
+
+
+{% macro create_rdf_node(dont_serialize_flag, ctx, value, member_path_type, member_path) %}
+{% if dont_serialize_flag %}
+Arvida::RDF::createRDFNode
+{%-else-%}
+Arvida::RDF::createRDFNodeAndSerialize
+{%-endif-%}
+({{ctx}}, {{value}}, Arvida::RDF::{{ member_path_type }}, {%if member_path%}{{member_path}}{%else%}""{%endif%})
+{%-endmacro-%}
+
+
+{% macro make_writer_member_statements(mtc) %}
+{% if mtc.is_for_writer() %}
+{% if mtc.member %}
+// Serialize member {{mtc.member.name}}
+{%endif-%}
+{
+    {% if mtc.member %}
+    ARVIDA_RDF_SCOPE(ctx, "{{ mtc.get_class().full_name }}::{{ mtc.member.name }}");
+    {% endif %}
+    {% if mtc.has_that_or_that_element_ref() %}
+    {{ define_that(mtc) }}
+    if (Arvida::RDF::isValidValue(_that))
+    {
+    {%endif%}
+    {# Triples with only that reference or no that references #}
+    {% if mtc.packed and mtc.has_that_ref() %}
+    Node that_node(Arvida::RDF::packedToRDF(ctx, _that));
+    {% elif mtc.has_that_ref() %}
+    Node that_node({{ create_rdf_node(dont_serialize_flag=mtc.has_that_element_ref(), ctx="ctx", value="_that",
+                         member_path_type=mtc.path_type, member_path=mtc.pp_path) }});
+    {%endif%}
+    {# Begin of triples #}
+    {% for it in mtc.triples %}
+      {% if not it.has_that_element_ref() -%}
+          {{ make_writer_triple_statement(mtc=mtc, triple=it) | indent(4, True) }}
+      {%endif%}
+    {% endfor %}
+    {# End of triples #}
+    {# Triples with only that element references  #}
+    {% if mtc.has_that_element_ref() %}
+    for (auto it = std::begin(_that); it != std::end(_that); ++it)
+    {
+        const auto & _element = *it;
+
+        Node element_node({{ create_rdf_node(ctx="ctx", value="_element",
+                 member_path_type=mtc.element_path_type, member_path=mtc.pp_element_path)}});
+
+    {# Begin of triples #}
+    {% for it in mtc.triples %}
+      {% if it.has_that_element_ref() %}
+        {{make_writer_triple_statement(mtc=mtc, triple=it)}}
+      {%endif%}
+    {%endfor%}
+    {# End of triples #}
+    }
+    {%endif%}
+    {% if mtc.has_that_or_that_element_ref() %}
+    }
+    {%endif%}
+}
+{%endif%}
+{% endmacro %}
+
+{% macro make_pathOf(c) %}
+{% if c.use_visitor %}
+inline PathType pathTypeOf_impl(const Context &ctx, const {{c.full_name}} &value)
+{% else %}
+template<>
+inline PathType pathTypeOf(const Context &ctx, const {{c.full_name}} &value)
+{% endif %}
+{
+    return {{ c.path_type }};
+}
+
+{% if c.use_visitor %}
+inline std::string pathOf_impl(const Context &ctx, const {{ c.full_name }} &value)
+{% else %}
+template<>
+inline std::string pathOf(const Context &ctx, const {{ c.full_name }} &value)
+{% endif %}
+{
+{% if c.uid_method %}
+    return value.{{ c.uid_method | first }}();
+{% else %}
+    const auto _this = &value;
+    return {{ c.pp_path }};
+{% endif %}
+}
+{% if not c.use_visitor %}
+
+template<>
+inline void appendPathOf(const Context &ctx, std::string &path, const {{ c.full_name }} &value)
+{
+{% if c.uid_method %}
+    Arvida::RDF::appendPath(path, value.{{ c.uid_method | first }}());
+{% else %}
+    const auto _this = &value;
+{% for it in c.pp_path_segments %}
+    Arvida::RDF::appendPath(path, {{ it }});
+{% endfor %}
+{% endif %}
+}
+{% endif %}
+{% endmacro %}
+
+
+{% macro make_toRDF(c) %}
+{% if c.use_visitor %}
+inline NodeRef toRDF_impl(const Context &ctx, NodeRef _this, const {{ c.full_name }} &value)
+{% else %}
+template<>
+inline NodeRef toRDF(const Context &ctx, NodeRef _this, const {{ c.full_name }} &value)
+{% endif %}
+{
+    ARVIDA_RDF_SCOPE(ctx, "{{ c.full_name }}");
+    {% for it in c.annotated_base_classes %}
+    {{ make_toRDF_call(it) }}
+    {% endfor %}
+    {% for it in c.blanks.values() -%}
+        {{ define_blank_node(it)|indent(4, True) }}
+    {% endfor %}
+    {% for it in c.mtcs -%}
+       {{ make_writer_member_statements(it)|indent(4, True) }}
+    {% endfor %}
+    {% for it in c.writer.defs %}{{ it }}{% endfor %}
+    {% for it in c.writer.statements %}{{ it }}{% endfor %}
+
+    return _this;
+}
+{% endmacro %}
+
+{% macro make_toRDF_call(c) %}
+{% if c.use_visitor %}
+toRDF_impl(ctx, _this, static_cast<const {{ c.full_name }} &>(value));
+{% else %}
+toRDF(ctx, _this, static_cast<const {{ c.full_name }} &>(value));
+{% endif %}
+{% endmacro %}
+
+{# ---------------------------------------------------------------------------- #}
+{# Streaming reader #}
+
+{% macro member_value_type(mtc) %}
+{% if mtc.is_function() %}{{ mtc.get_setter_value_type() }}{% else %}decltype(value.{{ mtc.member.name }}){% endif %}
+{%- endmacro %}
+
+{% macro member_assign(mtc, arg) %}
+{% if mtc.is_function() %}value.{{ mtc.member.name }}({{ arg }}){% else %}value.{{ mtc.member.name }} = {{ arg }}{% endif %}
+{%- endmacro %}
+
+{% macro member_setter(mtc) %}
+[&value]({{ member_value_type(mtc) }} &_that) { {{ member_assign(mtc, mtc.get_setter_argument('_that')) }}; }
+{%- endmacro %}
+
+{# Packed literals are complete in their statement and read without a pending value #}
+{% macro read_packed(mtc) %}
+{% if mtc.is_function() %}
+{{ member_value_type(mtc) }} _that;
+if (Arvida::RDF::packedFromRDF(ctx, object, _that))
+    {{ member_assign(mtc, mtc.get_setter_argument('_that')) }};
+{% else %}
+Arvida::RDF::packedFromRDF(ctx, object, value.{{ mtc.member.name }});
+{% endif %}
+{% endmacro %}
+
+{% macro make_handler_triple_statement(mtc, triple) %}
+{% set object = triple.object %}
+{% if object.is_prefixed_name() %}
+if (predicate == {{ vocabulary_node_expr(triple.predicate) }} &&
+    object == {{ vocabulary_node_expr(object) }})
+{% else %}
+if (predicate == {{ vocabulary_node_expr(triple.predicate) }})
+{% endif %}
+{
+{% if object.is_blank_node() %}
+    ctx.reader.bind(object, binding.with_var({{ object.index + 1 }}));
+{% elif object.is_that_ref() and mtc.packed %}
+    {{ read_packed(mtc) | indent(4) }}
+{% elif object.is_that_ref() %}
+    ctx.reader.readValue<{{ member_value_type(mtc) }}>(binding, object, {{ member_setter(mtc) }});
+{% elif object.is_that_element_ref() %}
+    ctx.reader.readElement<{{ member_value_type(mtc) }}>(binding, {{ mtc.id }}, object, {% if mtc.create_element %}{{ mtc.create_element }}(Arvida::RDF::elementContext(ctx), object), {% endif %}{{ member_setter(mtc) }});
+{% endif %}
+    return true;
+}
+{% endmacro %}
+
+{% macro is_streamed_triple(triple) %}
+{%- if triple.predicate.is_prefixed_name() and (triple.object.is_blank_node() or triple.object.is_that_ref() or triple.object.is_that_element_ref() or triple.object.is_prefixed_name()) -%}
+true
+{%- endif -%}
+{% endmacro %}
+
+{% macro make_handler_statements(c, subject) %}
+{% for mtc in c.mtcs if mtc.is_for_reader() %}
+{% for it in mtc.triples if is_streamed_triple(it) %}
+{% if (subject is none and it.subject.is_this_ref()) or (subject is not none and it.subject.is_blank_node() and it.subject.var_name == subject.var_name) %}
+{% if mtc.member %}
+// Deserialize member {{mtc.member.name}}
+{% endif %}
+{{ make_handler_triple_statement(mtc, it) }}
+{% endif %}
+{% endfor %}
+{% endfor %}
+{% endmacro %}
+
+{% macro make_handleRDF_decl(c) %}
+template<>
+inline bool handleRDF(const ReaderContext &ctx, const Binding &binding, const Node &predicate, const Node &object, {{ c.full_name }} &value);
+{% endmacro %}
+
+{% macro make_handleRDF(c) %}
+template<>
+inline bool handleRDF(const ReaderContext &ctx, const Binding &binding, const Node &predicate, const Node &object, {{ c.full_name }} &value)
+{
+    {% for it in c.annotated_base_classes %}
+    if (binding.var == 0 &&
+        handleRDF(ctx, makeBinding(static_cast<{{ it.full_name }} &>(value), 0, binding.owner), predicate, object, static_cast<{{ it.full_name }} &>(value)))
+        return true;
+    {% endfor %}
+
+    switch (binding.var)
+    {
+        case 0:
+        {
+            {{ make_handler_statements(c, none) | indent(12) }}
+            break;
+        }
+    {% for it in c.blanks.values() %}
+        case {{ it.index + 1 }}: // {{ it.label }}
+        {
+            {{ make_handler_statements(c, it) | indent(12) }}
+            break;
+        }
+    {% endfor %}
+    }
+    return false;
+}
+{% endmacro %}
+
+{# ---------------------------------------------------------------------------- #}
+{# Main #}
+
+{% macro main(env, include_files, include_file) %}
+/** This file was generated by ARVIDA C++ preprocessor **/
+{% for it in env.prolog %}
+{{ it }}
+{% endfor %}
+#include "SerdRDFTraits.hpp"
+{% for it in env.includes %}
+#include {{it}}
+{% endfor %}
+namespace Arvida
+{
+namespace RDF
+{
+
+{{ make_vocabulary(env.vocabulary) }}
+{% for c in env.annotated_classes %}
+{{ make_pathOf(c)}}
+{% endfor %}
+
+{% for c in env.annotated_classes %}
+{{ make_toRDF(c)}}
+{% endfor %}
+
+{% for c in env.annotated_classes %}
+{{ make_handleRDF_decl(c)}}
+{% endfor %}
+
+{% for c in env.annotated_classes %}
+{{ make_handleRDF(c)}}
+{% endfor %}
+
+
+} // namespace Arvida
+} // namespace RDF
+{% for it in env.epilog %}
+{{ it }}
+{% endfor %}
+
+{% endmacro %}
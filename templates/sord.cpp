@@ -1,15 +1,70 @@
+{# Vocabulary #}
+
+{% macro vocabulary_node_expr(value) %}
+Arvida::RDF::vocabularyNode<{{ value.vocabulary.name }}>(ctx, {{ value.vocabulary_index }} /* {{ value.value }} */)
+{%- endmacro %}
+
+{% macro make_vocabulary(vocabulary) %}
+{% if vocabulary %}
+#ifndef ARVIDA_{{ vocabulary.name | upper }}_DEFINED
+#define ARVIDA_{{ vocabulary.name | upper }}_DEFINED
+struct {{ vocabulary.name }}
+{
+    static const size_t size = {{ vocabulary | length }};
+
+    static const char * term(size_t index)
+    {
+        static const char * const terms[size] = {
+            {% for it in vocabulary.terms %}
+            {{ it }}{% if not loop.last %},{% endif %}
+
+            {% endfor %}
+        };
+        return terms[index];
+    }
+
+    static const char * iri(size_t index)
+    {
+        static const char * const iris[size] = {
+            {% for it in vocabulary.iris %}
+            {{ it or 0 }}{% if not loop.last %},{% endif %}
+
+            {% endfor %}
+        };
+        return iris[index];
+    }
+};
+#endif
+
+{% endif %}
+{% endmacro %}
+
 {# Writer #}
 
 {% macro member_ref(mtc, arg='') %}
-value.{{mtc.member.name}}{% if mtc.is_function() %}({{arg}}){% endif %}
+value.{{mtc.member.name}}{% if mtc.is_function() %}({{arg}}){% elif arg %} = {{arg}}{% endif %}
 {% endmacro %}
 
+{# Declares _that as the value of the getter, getters with an output argument write to a local value #}
+{% macro define_that(mtc) %}
+{% if mtc.get_getter_output_type() %}
+{{ mtc.get_getter_output_type() }} _that{};
+{{ member_ref(mtc, arg='_that') }};
+{% else %}
+const auto & _that = {{ member_ref(mtc) }};
+{% endif %}
+{% endmacro %}
+
+{% macro from_rdf_function(mtc) %}
+{% if mtc.packed %}Arvida::RDF::packedFromRDF{% else %}Arvida::RDF::fromRDF{% endif %}
+{%- endmacro %}
+
 {% macro define_blank_node(value) %}
-Sord::Node {{ value.var_name }} = Sord::Node::blank_id(ctx.model.world());
+Node {{ value.var_name }} = Arvida::RDF::blankNode(ctx);
 {% endmacro %}
 
 {% macro make_writer_triple_statement(mtc, triple) %}
-ctx.model.add_statement({{make_writer_node_expr(mtc=mtc, value=triple.subject)}}, {{make_writer_node_expr(mtc=mtc, value=triple.predicate)}}, {{make_writer_node_expr(mtc=mtc, value=triple.object)}});
+Arvida::RDF::addStatement(ctx, {{make_writer_node_expr(mtc=mtc, value=triple.subject)}}, {{make_writer_node_expr(mtc=mtc, value=triple.predicate)}}, {{make_writer_node_expr(mtc=mtc, value=triple.object)}});
 {% endmacro %}
 
 // Example: <({make_writer_<triple.subject.kind>_defs})(mtc=mtc, value=triple.subject)>
@@ -22,7 +77,7 @@ that_node
 {%- elif value.is_that_element_ref() -%}
 element_node
 {%- elif value.is_prefixed_name() -%}
-Sord::Curie(ctx.model.world(), {{ value.value }})
+{{ vocabulary_node_expr(value) }}
 {%- elif value.that_element_ref -%}
 element_node
 {%- elif value.is_blank_node() -%}
@@ -49,14 +104,19 @@ Arvida::RDF::createRDFNodeAndSerialize
 // Serialize member {{mtc.member.name}}
 {%endif-%}
 {
+    {% if mtc.member %}
+    ARVIDA_RDF_SCOPE(ctx, "{{ mtc.get_class().full_name }}::{{ mtc.member.name }}");
+    {% endif %}
     {% if mtc.has_that_or_that_element_ref() %}
-    const auto & _that = {{ member_ref(mtc) }};
+    {{ define_that(mtc) }}
     if (Arvida::RDF::isValidValue(_that))
     {
     {%endif%}
     {# Triples with only that reference or no that references #}
-    {% if mtc.has_that_ref() %}
-    Sord::Node that_node({{ create_rdf_node(dont_serialize_flag=mtc.has_that_element_ref(), ctx="ctx", value="_that",
+    {% if mtc.packed and mtc.has_that_ref() %}
+    Node that_node(Arvida::RDF::packedToRDF(ctx, _that));
+    {% elif mtc.has_that_ref() %}
+    Node that_node({{ create_rdf_node(dont_serialize_flag=mtc.has_that_element_ref(), ctx="ctx", value="_that",
                          member_path_type=mtc.path_type, member_path=mtc.pp_path) }});
     {%endif%}
     {# Begin of triples #}
@@ -91,22 +151,22 @@ Arvida::RDF::createRDFNodeAndSerialize
 {%endif%}
 {% endmacro %}
 
-{% macro make_pathOf(c) %}
+{% macro make_pathOf(c, inline=True) %}
 {% if c.use_visitor %}
-inline PathType pathTypeOf_impl(const Context &ctx, const {{c.full_name}} &value)
+{{ 'inline ' if inline else '' }}PathType pathTypeOf_impl(const Context &ctx, const {{c.full_name}} &value)
 {% else %}
 template<>
-inline PathType pathTypeOf(const Context &ctx, const {{c.full_name}} &value)
+{{ 'inline ' if inline else '' }}PathType pathTypeOf(const Context &ctx, const {{c.full_name}} &value)
 {% endif %}
 {
     return {{ c.path_type }};
 }
 
 {% if c.use_visitor %}
-inline std::string pathOf_impl(const Context &ctx, const {{ c.full_name }} &value)
+{{ 'inline ' if inline else '' }}std::string pathOf_impl(const Context &ctx, const {{ c.full_name }} &value)
 {% else %}
 template<>
-inline std::string pathOf(const Context &ctx, const {{ c.full_name }} &value)
+{{ 'inline ' if inline else '' }}std::string pathOf(const Context &ctx, const {{ c.full_name }} &value)
 {% endif %}
 {
 {% if c.uid_method %}
@@ -116,17 +176,33 @@ inline std::string pathOf(const Context &ctx, const {{ c.full_name }} &value)
     return {{ c.pp_path }};
 {% endif %}
 }
+{% if not c.use_visitor %}
+
+template<>
+{{ 'inline ' if inline else '' }}void appendPathOf(const Context &ctx, std::string &path, const {{ c.full_name }} &value)
+{
+{% if c.uid_method %}
+    Arvida::RDF::appendPath(path, value.{{ c.uid_method | first }}());
+{% else %}
+    const auto _this = &value;
+{% for it in c.pp_path_segments %}
+    Arvida::RDF::appendPath(path, {{ it }});
+{% endfor %}
+{% endif %}
+}
+{% endif %}
 {% endmacro %}
 
 
-{% macro make_toRDF(c) %}
+{% macro make_toRDF(c, inline=True) %}
 {% if c.use_visitor %}
-inline NodeRef toRDF_impl(const Context &ctx, NodeRef _this, const {{ c.full_name }} &value)
+{{ 'inline ' if inline else '' }}NodeRef toRDF_impl(const Context &ctx, NodeRef _this, const {{ c.full_name }} &value)
 {% else %}
 template<>
-inline NodeRef toRDF(const Context &ctx, NodeRef _this, const {{ c.full_name }} &value)
+{{ 'inline ' if inline else '' }}NodeRef toRDF(const Context &ctx, NodeRef _this, const {{ c.full_name }} &value)
 {% endif %}
 {
+    ARVIDA_RDF_SCOPE(ctx, "{{ c.full_name }}");
     {% for it in c.annotated_base_classes %}
     {{ make_toRDF_call(it) }}
     {% endfor %}
@@ -151,46 +227,149 @@ toRDF(ctx, _this, static_cast<const {{ c.full_name }} &>(value));
 {% endif %}
 {% endmacro %}
 
+{# ---------------------------------------------------------------------------- #}
+{# Delta writer #}
+
+{% macro make_delta_triple_statement(mtc, triple) %}
+Arvida::RDF::addDeltaStatement(_member, {{make_writer_node_expr(mtc=mtc, value=triple.subject)}}, {{make_writer_node_expr(mtc=mtc, value=triple.predicate)}}, {{make_writer_node_expr(mtc=mtc, value=triple.object)}});
+{% endmacro %}
+
+{% macro create_delta_node(dont_serialize_flag, slot, value, member_path_type, member_path) %}
+Arvida::RDF::createDeltaNode(ctx, delta, Arvida::RDF::deltaNodeSlot(_member, {{slot}}), {{value}}, Arvida::RDF::{{ member_path_type }}, {%if member_path%}{{member_path}}{%else%}""{%endif%}, {% if dont_serialize_flag %}false{% else %}true{% endif %})
+{%- endmacro -%}
+
+{% macro make_delta_member_statements(mtc, index) %}
+{% if mtc.is_for_writer() %}
+{% if mtc.member %}
+// Serialize member {{mtc.member.name}}
+{%endif-%}
+{
+    Arvida::RDF::DeltaMember &_member = _subject.members[{{ index }}];
+    {% if mtc.has_that_or_that_element_ref() %}
+    {{ define_that(mtc) }}
+    if (Arvida::RDF::beginDeltaMember(_member, _that))
+    {
+        if (Arvida::RDF::isValidValue(_that))
+        {
+    {% else %}
+    if (Arvida::RDF::beginDeltaMember(_member))
+    {
+        {
+    {% endif %}
+    {% if mtc.packed and mtc.has_that_ref() %}
+            Node that_node(Arvida::RDF::packedToRDF(ctx, _that));
+    {% elif mtc.has_that_ref() %}
+            Node that_node({{ create_delta_node(dont_serialize_flag=mtc.has_that_element_ref(), slot=0, value="_that",
+                                 member_path_type=mtc.path_type, member_path=mtc.pp_path) }});
+    {% endif %}
+    {% for it in mtc.triples %}
+      {% if not it.has_that_element_ref() %}
+            {{ make_delta_triple_statement(mtc=mtc, triple=it) }}
+      {% endif %}
+    {% endfor %}
+    {% if mtc.has_that_element_ref() %}
+            size_t _element_index = 0;
+            for (auto it = std::begin(_that); it != std::end(_that); ++it, ++_element_index)
+            {
+                const auto & _element = *it;
+
+                Node element_node({{ create_delta_node(slot="_element_index + 1", value="_element",
+                                  member_path_type=mtc.element_path_type, member_path=mtc.pp_element_path) }});
+
+      {% for it in mtc.triples %}
+        {% if it.has_that_element_ref() %}
+                {{ make_delta_triple_statement(mtc=mtc, triple=it) }}
+        {% endif %}
+      {% endfor %}
+            }
+            Arvida::RDF::endDeltaElements(delta, _member, _element_index);
+    {% endif %}
+        }
+        Arvida::RDF::endDeltaMember(delta, _member);
+    }
+}
+{% endif %}
+{% endmacro %}
+
+{% macro make_toRDFDelta(c, inline=True) %}
+{% if c.use_visitor %}
+{{ 'inline ' if inline else '' }}NodeRef toRDFDelta_impl(const Context &ctx, Delta &delta, NodeRef _this, const {{ c.full_name }} &value)
+{% else %}
+template<>
+{{ 'inline ' if inline else '' }}NodeRef toRDFDelta(const Context &ctx, Delta &delta, NodeRef _this, const {{ c.full_name }} &value)
+{% endif %}
+{
+    {% for it in c.annotated_base_classes %}
+    {{ make_toRDFDelta_call(it) }}
+    {% endfor %}
+    Arvida::RDF::DeltaSubject &_subject = delta.subject<{{ c.full_name }}>(ctx, _this, {{ c.blanks | length }}, {{ c.mtcs | length }});
+    {% for it in c.blanks.values() %}
+    const Node &{{ it.var_name }} = _subject.blanks[{{ it.index }}];
+    {% endfor %}
+    {% for it in c.mtcs -%}
+       {{ make_delta_member_statements(it, loop.index0)|indent(4, True) }}
+    {% endfor %}
+
+    return _this;
+}
+{% endmacro %}
+
+{% macro make_toRDFDelta_call(c) %}
+{% if c.use_visitor %}
+toRDFDelta_impl(ctx, delta, _this, static_cast<const {{ c.full_name }} &>(value));
+{% else %}
+toRDFDelta(ctx, delta, _this, static_cast<const {{ c.full_name }} &>(value));
+{% endif %}
+{% endmacro %}
+
 {# ---------------------------------------------------------------------------- #}
 {# Reader #}
 
 {% macro make_reader_triple_statement(mtc, triple) %}
-triple = Arvida::RDF::find_triple(ctx.model, {{make_reader_node_expr(mtc=mtc, value=triple.subject)}}, {{make_reader_node_expr(mtc=mtc, value=triple.predicate)}}, {{make_reader_node_expr(mtc=mtc, value=triple.object)}});
+triple = Arvida::RDF::find_triple(ctx, {{make_reader_node_expr(mtc=mtc, value=triple.subject)}}, {{make_reader_node_expr(mtc=mtc, value=triple.predicate)}}, {{make_reader_node_expr(mtc=mtc, value=triple.object)}});
+ARVIDA_RDF_COUNT(ctx, lookups, 1);
 if (!triple.is_valid())
+{
+    ARVIDA_RDF_COUNT(ctx, lookup_misses, 1);
     return false;
+}
 {{post_reader_node_expr(mtc, triple, 'subject')}}
 {{post_reader_node_expr(mtc, triple, 'object')}}
 {% endmacro %}
 
 {% macro make_reader_pre_element_triple_statement(mtc, triple) %}
-triples = Arvida::RDF::find_triples(ctx.model, {{make_reader_node_expr(mtc=mtc, value=triple.subject)}}, {{make_reader_node_expr(mtc=mtc, value=triple.predicate)}}, {{make_reader_node_expr(mtc=mtc, value=triple.object)}});
+Arvida::RDF::TripleRange triples(ctx, {{make_reader_node_expr(mtc=mtc, value=triple.subject)}}, {{make_reader_node_expr(mtc=mtc, value=triple.predicate)}}, {{make_reader_node_expr(mtc=mtc, value=triple.object)}});
+ARVIDA_RDF_COUNT(ctx, lookups, 1);
 if (triples.empty())
+{
+    ARVIDA_RDF_COUNT(ctx, lookup_misses, 1);
     return false;
+}
 typedef {{mtc.get_setter_value_type()}} _that_container_type;
 _that_container_type _that_value;
 for (auto it = std::begin(triples); it != std::end(triples); ++it)
 {
-     auto & _element_node = it->{{ triple.that_element_position }};
+    auto _element_node = it->get_{{ triple.that_element_position }}();
     _that_container_type::value_type _element{% if mtc.create_element %} = {{ mtc.create_element }}(ctx, _element_node){% endif %};
 {% endmacro %}
 
 {% macro make_reader_post_element_triple_statement(mtc, triple) %}
 {{post_reader_element_node_expr(mtc, triple, 'subject')}}
 {{post_reader_element_node_expr(mtc, triple, 'object')}}
-_that_value.push_back(_element);
+_that_value.push_back(std::move(_element));
 }
-{{member_ref(mtc, arg='_that_value')}};
+{{member_ref(mtc, arg='std::move(_that_value)')}};
 {% endmacro %}
 
 {% macro post_reader_element_node_expr(mtc, triple, position) %}
 {% set value = triple[position] -%}
 {% if value.is_this_ref() -%}
-_this = it->{{ position }};
+_this = it->get_{{ position }}();
 {%- elif value.is_that_ref() -%}
 {
     if (!Arvida::RDF::fromRDF(ctx, triple.{{ position }}, tmp_value))
         return false;
-    {{member_ref(mtc, arg='tmp_value')}};
+    {{member_ref(mtc, arg=mtc.get_setter_argument('tmp_value'))}};
 }
 {%- elif value.is_that_element_ref() -%}
 if (!Arvida::RDF::fromRDF(ctx, _element_node, _element))
@@ -208,12 +387,15 @@ UNKNOWN EXPR
 {% set value = triple[position] -%}
 {% if value.is_this_ref() -%}
 _this = triple.{{ position }};
+{%- elif value.is_that_ref() and mtc.is_field() -%}
+if (!{{ from_rdf_function(mtc) }}(ctx, triple.{{ position }}, value.{{ mtc.member.name }}))
+    return false;
 {%- elif value.is_that_ref() -%}
 {
     {{mtc.get_setter_value_type()}} tmp_value;
-    if (!Arvida::RDF::fromRDF(ctx, triple.{{ position }}, tmp_value))
+    if (!{{ from_rdf_function(mtc) }}(ctx, triple.{{ position }}, tmp_value))
         return false;
-    {{member_ref(mtc, arg='tmp_value')}};
+    {{member_ref(mtc, arg=mtc.get_setter_argument('tmp_value'))}};
 }
 {%- elif value.is_that_element_ref() -%}
 // THAT_ELEMENT_REF
@@ -221,7 +403,7 @@ _this = triple.{{ position }};
     {{mtc.get_setter_value_type()}} tmp_value;
     if (!Arvida::RDF::fromRDF(ctx, triple.{{ position }}, tmp_value))
         return false;
-    {{member_ref(mtc, arg='tmp_value')}};
+    {{member_ref(mtc, arg=mtc.get_setter_argument('tmp_value'))}};
 }
 {%- elif value.is_prefixed_name() -%}
 {# Empty since it is a constant #}
@@ -237,13 +419,13 @@ UNKNOWN EXPR
 {% if value.is_this_ref() -%}
 _this
 {%- elif value.is_that_ref() -%}
-Sord::Node()
+Node()
 {%- elif value.is_that_element_ref() -%}
-Sord::Node()
+Node()
 {%- elif value.is_prefixed_name() -%}
-Sord::Curie(ctx.model.world(), {{ value.value }})
+{{ vocabulary_node_expr(value) }}
 {%- elif value.that_element_ref -%}
-Sord::Node()
+Node()
 {%- elif value.is_blank_node() -%}
 {{ value.var_name }}
 {%- else -%}
@@ -258,6 +440,9 @@ UNKNOWN EXPR
 // Deserialize member {{mtc.member.name}}
 {%endif-%}
 {
+    {% if mtc.member %}
+    ARVIDA_RDF_SCOPE(ctx, "{{ mtc.get_class().full_name }}::{{ mtc.member.name }}");
+    {% endif %}
     {# Triples with only that reference or no that references #}
     {# Begin of member triples #}
     {% for it in mtc.member_triples -%}
@@ -281,27 +466,25 @@ UNKNOWN EXPR
 
 {# --- make_fromRDF --- #}
 
-{% macro make_fromRDF(c) %}
+{% macro make_fromRDF(c, inline=True) %}
 
 {% if c.use_visitor %}
-inline bool fromRDF_impl(const Context &ctx, const NodeRef _this0, {{ c.full_name }} &value)
+{{ 'inline ' if inline else '' }}bool fromRDF_impl(const Context &ctx, const NodeRef _this0, {{ c.full_name }} &value)
 {% else %}
 template<>
-inline bool fromRDF(const Context &ctx, const NodeRef _this0, {{ c.full_name }} &value)
+{{ 'inline ' if inline else '' }}bool fromRDF(const Context &ctx, const NodeRef _this0, {{ c.full_name }} &value)
 {% endif %}
 {
+    ARVIDA_RDF_SCOPE(ctx, "{{ c.full_name }}");
     Arvida::RDF::Triple triple;
-    {% if c.has_element_refs %}
-    std::vector<Arvida::RDF::Triple> triples;
-    {% endif %}
-    Sord::Node _this = _this0;
+    Node _this = _this0;
 
     {% for it in c.annotated_base_classes %}
     {{ make_fromRDF_call(it) }}
     {% endfor %}
 
     {% for it in c.blanks.values() %}
-    Sord::Node {{ it.var_name }};
+    Node {{ it.var_name }};
     {% endfor %}
 
     {% for it in c.mtcs -%}
@@ -323,11 +506,55 @@ fromRDF(ctx, _this, static_cast<{{ c.full_name }} &>(value));
 {% endif %}
 {% endmacro %}
 
+{# ---------------------------------------------------------------------------- #}
+{# Declarations of out-of-line definitions #}
+
+{% macro make_declarations(c, delta) %}
+{% if c.use_visitor %}
+PathType pathTypeOf_impl(const Context &ctx, const {{ c.full_name }} &value);
+std::string pathOf_impl(const Context &ctx, const {{ c.full_name }} &value);
+NodeRef toRDF_impl(const Context &ctx, NodeRef _this, const {{ c.full_name }} &value);
+{% if delta %}
+NodeRef toRDFDelta_impl(const Context &ctx, Delta &delta, NodeRef _this, const {{ c.full_name }} &value);
+{% endif %}
+bool fromRDF_impl(const Context &ctx, const NodeRef _this0, {{ c.full_name }} &value);
+{% else %}
+template<>
+PathType pathTypeOf(const Context &ctx, const {{ c.full_name }} &value);
+template<>
+std::string pathOf(const Context &ctx, const {{ c.full_name }} &value);
+template<>
+void appendPathOf(const Context &ctx, std::string &path, const {{ c.full_name }} &value);
+template<>
+NodeRef toRDF(const Context &ctx, NodeRef _this, const {{ c.full_name }} &value);
+{% if delta %}
+template<>
+NodeRef toRDFDelta(const Context &ctx, Delta &delta, NodeRef _this, const {{ c.full_name }} &value);
+{% endif %}
+template<>
+bool fromRDF(const Context &ctx, const NodeRef _this0, {{ c.full_name }} &value);
+extern template Node toRDF<{{ c.full_name }}>(const Context &ctx, const {{ c.full_name }} &value);
+extern template bool fromRDF<{{ c.full_name }}>(const Context &ctx, const NodeRef thisNode, std::shared_ptr<{{ c.full_name }}> &value);
+{% endif %}
+{% endmacro %}
+
+{# Generic functions of the traits instantiated once in the file of definitions #}
+
+{% macro make_explicit_instantiations(c) %}
+{% if not c.use_visitor %}
+template Node toRDF<{{ c.full_name }}>(const Context &ctx, const {{ c.full_name }} &value);
+template bool fromRDF<{{ c.full_name }}>(const Context &ctx, const NodeRef thisNode, std::shared_ptr<{{ c.full_name }}> &value);
+{% endif %}
+{% endmacro %}
+
 {# ---------------------------------------------------------------------------- #}
 {# Main #}
 
 {% macro main(env, include_files, include_file) %}
 /** This file was generated by ARVIDA C++ preprocessor **/
+{% if env.split == 'definitions' %}
+#include "{{ env.declarations_header }}"
+{% else %}
 {% for it in env.prolog %}
 {{ it }}
 {% endfor %}
@@ -335,29 +562,50 @@ fromRDF(ctx, _this, static_cast<{{ c.full_name }} &>(value));
 {% for it in env.includes %}
 #include {{it}}
 {% endfor %}
+{% endif %}
 namespace Arvida
 {
 namespace RDF
 {
 
+{% if env.split == 'declarations' %}
 {% for c in env.annotated_classes %}
-{{ make_pathOf(c)}}
+{{ make_declarations(c, env.delta) }}
+{% endfor %}
+{% else %}
+{% set inline = not env.split %}
+{{ make_vocabulary(env.vocabulary) }}
+{% for c in env.annotated_classes %}
+{{ make_pathOf(c, inline)}}
 {% endfor %}
 
 {% for c in env.annotated_classes %}
-{{ make_toRDF(c)}}
+{{ make_toRDF(c, inline)}}
 {% endfor %}
 
+{% if env.delta %}
+{% for c in env.annotated_classes %}
+{{ make_toRDFDelta(c, inline)}}
+{% endfor %}
+{% endif %}
 
 {% for c in env.annotated_classes %}
-{{ make_fromRDF(c)}}
+{{ make_fromRDF(c, inline)}}
 {% endfor %}
 
+{% if env.split %}
+{% for c in env.annotated_classes %}
+{{ make_explicit_instantiations(c) }}
+{% endfor %}
+{% endif %}
+{% endif %}
 
 } // namespace Arvida
 } // namespace RDF
+{% if env.split != 'definitions' %}
 {% for it in env.epilog %}
 {{ it }}
 {% endfor %}
+{% endif %}
 
 {% endmacro %}
@@ -0,0 +1,255 @@
+{# Table-driven variant of the sord template: one descriptor per class is interpreted by SordTableRDFTraits.hpp #}
+{% import 'sord.cpp' as unrolled %}
+
+{% macro table_term(value) %}
+{% if value.is_this_ref() -%}
+{Arvida::RDF::Table::THIS, 0}
+{%- elif value.is_that_ref() -%}
+{Arvida::RDF::Table::THAT, 0}
+{%- elif value.is_blank_node() -%}
+{Arvida::RDF::Table::BLANK, {{ value.index }}}
+{%- elif value.is_prefixed_name() -%}
+{Arvida::RDF::Table::TERM, {{ value.vocabulary_index }}} /* {{ value.value }} */
+{%- else -%}
+UNKNOWN TERM
+{%- endif -%}
+{% endmacro %}
+
+{% macro is_code_member(mtc) %}
+{%- if mtc.member_element_triples -%}true{%- endif -%}
+{% endmacro %}
+
+{% macro bind_blanks(mtc) %}
+{% for it in mtc.blanks() %}
+    Sord::Node &{{ it.var_name }} = _blanks[{{ it.index }}];
+{% endfor %}
+{% endmacro %}
+
+{# Accessors of members whose statements are in the table #}
+
+{% macro make_value_accessors(c, mtc) %}
+{% if mtc.is_for_writer() and mtc.has_that_ref() %}
+    static bool write_value_{{ mtc.id }}(const Context &ctx, const void *object, Sord::Node &that_node)
+    {
+        const {{ c.full_name }} &value = *static_cast<const {{ c.full_name }} *>(object);
+        {{ unrolled.define_that(mtc) }}
+        if (!Arvida::RDF::isValidValue(_that))
+            return false;
+        {% if mtc.packed %}
+        that_node = Arvida::RDF::packedToRDF(ctx, _that);
+        {% else %}
+        that_node = {{ unrolled.create_rdf_node(dont_serialize_flag=False, ctx="ctx", value="_that",
+                                                member_path_type=mtc.path_type, member_path=mtc.pp_path) }};
+        {% endif %}
+        return true;
+    }
+
+{% endif %}
+{% if mtc.is_for_reader() and mtc.has_that_ref() %}
+    static bool read_value_{{ mtc.id }}(const Context &ctx, Sord::Node &that_node, void *object)
+    {
+        {{ c.full_name }} &value = *static_cast<{{ c.full_name }} *>(object);
+        {% if mtc.is_field() %}
+        return {{ unrolled.from_rdf_function(mtc) }}(ctx, that_node, value.{{ mtc.member.name }});
+        {% else %}
+        {{ mtc.get_setter_value_type() }} tmp_value;
+        if (!{{ unrolled.from_rdf_function(mtc) }}(ctx, that_node, tmp_value))
+            return false;
+        {{ unrolled.member_ref(mtc, arg=mtc.get_setter_argument('tmp_value')) }};
+        return true;
+        {% endif %}
+    }
+
+{% endif %}
+{% endmacro %}
+
+{# Members that refer to container elements are generated like in the sord template #}
+
+{% macro make_member_functions(c, mtc) %}
+{% if mtc.is_for_writer() %}
+    static void write_member_{{ mtc.id }}(const Context &ctx, Sord::Node &_this, Sord::Node *_blanks, const void *object)
+    {
+        const {{ c.full_name }} &value = *static_cast<const {{ c.full_name }} *>(object);
+        {{ bind_blanks(mtc) }}
+        {{ unrolled.make_writer_member_statements(mtc) | indent(8) }}
+    }
+
+{% endif %}
+{% if mtc.is_for_reader() %}
+    static bool read_member_{{ mtc.id }}(const Context &ctx, Sord::Node &_this, Sord::Node *_blanks, void *object)
+    {
+        {{ c.full_name }} &value = *static_cast<{{ c.full_name }} *>(object);
+        Arvida::RDF::Triple triple;
+        {{ bind_blanks(mtc) }}
+        {{ unrolled.make_reader_member_statements(mtc) | indent(8) }}
+        return true;
+    }
+
+{% endif %}
+{% endmacro %}
+
+{% macro member_function(mtc, kind, condition) %}
+{%- if condition -%}
+&{{ kind }}_{{ mtc.id }}
+{%- else -%}
+nullptr
+{%- endif -%}
+{% endmacro %}
+
+{% macro make_descriptor(env, c) %}
+template<>
+struct TableDescriptor<{{ c.full_name }}>
+{
+{% for mtc in c.mtcs %}
+{% if is_code_member(mtc) %}
+{{ make_member_functions(c, mtc) }}
+{%- else %}
+{{ make_value_accessors(c, mtc) }}
+{%- endif %}
+{% endfor %}
+    static const Arvida::RDF::Table::Class & get()
+    {
+        {% set ns = namespace(num_statements=0, first_statement=0) %}
+        {% for mtc in c.mtcs if not is_code_member(mtc) %}
+        {% set ns.num_statements = ns.num_statements + mtc.member_triples | length %}
+        {% endfor %}
+        {% if ns.num_statements %}
+        static constexpr Arvida::RDF::Table::Statement statements[] = {
+            {% for mtc in c.mtcs if not is_code_member(mtc) %}
+            {% for it in mtc.member_triples %}
+            { {{ table_term(it.subject) }}, {{ table_term(it.predicate) }}, {{ table_term(it.object) }} },
+            {% endfor %}
+            {% endfor %}
+        };
+        {% endif %}
+        {% if c.mtcs %}
+        static constexpr Arvida::RDF::Table::Member members[] = {
+            {% for mtc in c.mtcs %}
+            {% set code = is_code_member(mtc) %}
+            {% set num_statements = 0 if code else mtc.member_triples | length %}
+            {
+                {% if mtc.member %}"{{ c.full_name }}::{{ mtc.member.name }}"{% else %}nullptr{% endif %},
+                {{ 'true' if mtc.is_for_writer() else 'false' }}, {{ 'true' if mtc.is_for_reader() else 'false' }},
+                {{ ns.first_statement }}, {{ num_statements }},
+                {{ member_function(mtc, 'write_value', not code and mtc.is_for_writer() and mtc.has_that_ref()) }},
+                {{ member_function(mtc, 'read_value', not code and mtc.is_for_reader() and mtc.has_that_ref()) }},
+                {{ member_function(mtc, 'write_member', code and mtc.is_for_writer()) }},
+                {{ member_function(mtc, 'read_member', code and mtc.is_for_reader()) }}
+            }{% if not loop.last %},{% endif %}
+
+            {% set ns.first_statement = ns.first_statement + num_statements %}
+            {% endfor %}
+        };
+        {% endif %}
+        static constexpr Arvida::RDF::Table::Class descriptor = {
+            {{ c.blanks | length }},
+            {{ 'statements' if ns.num_statements else 'nullptr' }},
+            {{ 'members' if c.mtcs else 'nullptr' }}, {{ c.mtcs | length }},
+            {% if env.vocabulary %}&Arvida::RDF::vocabularyNode<{{ env.vocabulary.name }}>{% else %}nullptr{% endif %}
+
+        };
+        return descriptor;
+    }
+};
+{% endmacro %}
+
+{% macro make_toRDF(c, inline=True) %}
+{% if c.use_visitor %}
+{{ 'inline ' if inline else '' }}NodeRef toRDF_impl(const Context &ctx, NodeRef _this, const {{ c.full_name }} &value)
+{% else %}
+template<>
+{{ 'inline ' if inline else '' }}NodeRef toRDF(const Context &ctx, NodeRef _this, const {{ c.full_name }} &value)
+{% endif %}
+{
+    ARVIDA_RDF_SCOPE(ctx, "{{ c.full_name }}");
+    {% for it in c.annotated_base_classes %}
+    {{ unrolled.make_toRDF_call(it) }}
+    {% endfor %}
+    Arvida::RDF::Table::toRDF(ctx, _this, TableDescriptor<{{ c.full_name }}>::get(), &value);
+    {% for it in c.writer.defs %}{{ it }}{% endfor %}
+    {% for it in c.writer.statements %}{{ it }}{% endfor %}
+
+    return _this;
+}
+{% endmacro %}
+
+{% macro make_fromRDF(c, inline=True) %}
+{% if c.use_visitor %}
+{{ 'inline ' if inline else '' }}bool fromRDF_impl(const Context &ctx, const NodeRef _this0, {{ c.full_name }} &value)
+{% else %}
+template<>
+{{ 'inline ' if inline else '' }}bool fromRDF(const Context &ctx, const NodeRef _this0, {{ c.full_name }} &value)
+{% endif %}
+{
+    ARVIDA_RDF_SCOPE(ctx, "{{ c.full_name }}");
+    Sord::Node _this = _this0;
+
+    {% for it in c.annotated_base_classes %}
+    {{ unrolled.make_fromRDF_call(it) }}
+    {% endfor %}
+
+    if (!Arvida::RDF::Table::fromRDF(ctx, _this, TableDescriptor<{{ c.full_name }}>::get(), &value))
+        return false;
+
+    {% for it in c.reader.defs %}{{ it }}{% endfor %}
+    {% for it in c.reader.statements %}{{ it }}{% endfor %}
+
+    return true;
+}
+{% endmacro %}
+
+{# ---------------------------------------------------------------------------- #}
+{# Main #}
+
+{% macro main(env, include_files, include_file) %}
+/** This file was generated by ARVIDA C++ preprocessor **/
+{% if env.split == 'definitions' %}
+#include "{{ env.declarations_header }}"
+{% else %}
+{% for it in env.prolog %}
+{{ it }}
+{% endfor %}
+#include "SordTableRDFTraits.hpp"
+{% for it in env.includes %}
+#include {{it}}
+{% endfor %}
+{% endif %}
+namespace Arvida
+{
+namespace RDF
+{
+
+{% if env.split == 'declarations' %}
+{% for c in env.annotated_classes %}
+{{ unrolled.make_declarations(c, False) }}
+{% endfor %}
+{% else %}
+{% set inline = not env.split %}
+{{ unrolled.make_vocabulary(env.vocabulary) }}
+{% for c in env.annotated_classes %}
+{{ unrolled.make_pathOf(c, inline)}}
+{% endfor %}
+
+{# Classes are in dependency order, descriptors may use toRDF and fromRDF of preceding classes #}
+{% for c in env.annotated_classes %}
+{{ make_descriptor(env, c) }}
+{{ make_toRDF(c, inline)}}
+{{ make_fromRDF(c, inline)}}
+{% endfor %}
+
+{% if env.split %}
+{% for c in env.annotated_classes %}
+{{ unrolled.make_explicit_instantiations(c) }}
+{% endfor %}
+{% endif %}
+{% endif %}
+
+} // namespace Arvida
+} // namespace RDF
+{% if env.split != 'definitions' %}
+{% for it in env.epilog %}
+{{ it }}
+{% endfor %}
+{% endif %}
+
+{% endmacro %}
@@ -0,0 +1,83 @@
+/*  ARVIDAPP - ARVIDA C++ Preprocessor
+ *
+ *  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef ARVIDA_TEST_HARNESS_HPP_INCLUDED
+#define ARVIDA_TEST_HARNESS_HPP_INCLUDED
+
+#include <cstdio>
+#include <exception>
+#include <initializer_list>
+#include <utility>
+
+// Reports a failed condition and continues the test
+#define ARVIDA_CHECK(condition) \
+    Arvida::Test::check((condition), #condition, __FILE__, __LINE__)
+
+namespace Arvida
+{
+namespace Test
+{
+
+typedef void (*TestFunction)();
+
+inline int & failures()
+{
+    static int count = 0;
+    return count;
+}
+
+inline bool check(bool condition, const char *expression, const char *file, int line)
+{
+    if (!condition)
+    {
+        ++failures();
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+    }
+    return condition;
+}
+
+/**
+ * Runs the tests in order and prints one line per test, returns the exit code of
+ * the test executable. An exception fails the test that threw it.
+ */
+inline int run(std::initializer_list<std::pair<const char *, TestFunction> > tests)
+{
+    int failed = 0;
+    for (const auto &test : tests)
+    {
+        const int before = failures();
+        try
+        {
+            test.second();
+        }
+        catch (const std::exception &e)
+        {
+            ++failures();
+            std::fprintf(stderr, "%s: exception: %s\n", test.first, e.what());
+        }
+        const bool ok = failures() == before;
+        if (!ok)
+            ++failed;
+        std::printf("%-40s %s\n", test.first, ok ? "ok" : "FAILED");
+    }
+    return failed == 0 ? 0 : 1;
+}
+
+} // namespace Test
+} // namespace Arvida
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef TEST_MODEL
+#define TEST_MODEL
+
+#include "arvida_pp_annotation.h"
+#include <string>
+#include <vector>
+
+arvida_global_annotation(
+    arvida_include("TestModel.h"),
+    arvida_prolog("#ifndef TEST_MODEL_TRAITS"),
+    arvida_prolog("#define TEST_MODEL_TRAITS"),
+    arvida_prolog(""),
+    arvida_epilog(""),
+    arvida_epilog("#endif")
+)
+
+// Point, value without path that is written as blank node
+class
+
+RdfStmt($this, "rdf:type", "maths:Vector2D")
+RdfStmt($this, "vom:quantityValue", _:1)
+
+Point
+{
+public:
+    Point() : x_(0), y_(0) { }
+    Point(double x, double y) : x_(x), y_(y) { }
+
+    RdfStmt(_:1, "maths:x", $that)
+    double getX() const { return x_; }
+
+    RdfStmt(_:1, "maths:y", $that)
+    double getY() const { return y_; }
+
+    RdfStmt(_:1, "maths:x", $that)
+    void setX(double x) { x_ = x; }
+
+    RdfStmt(_:1, "maths:y", $that)
+    void setY(double y) { y_ = y; }
+
+    bool operator==(const Point &other) const { return x_ == other.x_ && y_ == other.y_; }
+
+private:
+    double x_;
+    double y_;
+};
+
+// Polyline
+class
+
+RdfStmt($this, "rdf:type", "spatial:Polyline")
+
+Polyline
+{
+public:
+
+    RdfStmt($this, "core:name", $that)
+    const std::string & getName() const { return name_; }
+
+    RdfStmt($this, "core:name", $that)
+    void setName(const std::string &name) { name_ = name; }
+
+    RdfStmt($this, "spatial:vertex", $that.element)
+    const std::vector<Point> & getVertices() const { return vertices_; }
+
+    RdfStmt($this, "spatial:vertex", $that.element)
+    void setVertices(const std::vector<Point> &vertices) { vertices_ = vertices; }
+
+    // Written as core:Container node
+    RdfPath("/corners")
+    RdfStmt($this, "spatial:corners", $that)
+    const std::vector<Point> & getCorners() const { return corners_; }
+
+    RdfStmt($this, "spatial:corners", $that)
+    void setCorners(const std::vector<Point> &corners) { corners_ = corners; }
+
+    // Written as one literal with all elements
+    RdfPacked()
+    RdfStmt($this, "spatial:weights", $that)
+    const std::vector<double> & getWeights() const { return weights_; }
+
+    RdfPacked()
+    RdfStmt($this, "spatial:weights", $that)
+    void setWeights(const std::vector<double> &weights) { weights_ = weights; }
+
+private:
+    std::string name_;
+    std::vector<Point> vertices_;
+    std::vector<Point> corners_;
+    std::vector<double> weights_;
+};
+
+#endif
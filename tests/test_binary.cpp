@@ -0,0 +1,196 @@
+/*  ARVIDAPP - ARVIDA C++ Preprocessor
+ *
+ *  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Round trip of code generated by the binary template, which shares its macros
+// with the sord template, through Encoder and Graph
+
+#include "TestModel.h"
+#include "TestModel_binary.hpp"
+#include "TestHarness.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const std::string PATH("http://example.com/test/a");
+const std::string OTHER_PATH("http://example.com/test/b");
+const char CORNERS[] = "http://vocab.arvida.de/2015/06/spatial/corners";
+const char MEMBER[] = "http://vocab.arvida.de/2015/06/core/member";
+
+Polyline makePolyline()
+{
+    Polyline value;
+    value.setName("a");
+    value.setVertices({Point(1, 2), Point(3, 4.5)});
+    value.setCorners({Point(0, 0), Point(-1, 1)});
+    value.setWeights({0.25, -1e300, 3});
+    return value;
+}
+
+// Graph decoded from the encoding of value, core:Container and core:member of the
+// traits are expanded with the prefixes of state
+struct Encoded
+{
+    Arvida::RDF::ContextState state;
+    Arvida::RDF::Graph graph;
+    bool decoded;
+
+    explicit Encoded(const Polyline &value)
+    {
+        state.vocabulary.add_prefix("core", "http://vocab.arvida.de/2015/06/core/");
+        Arvida::RDF::Encoder encoder;
+        {
+            Arvida::RDF::Context ctx(encoder, PATH, 0, 0, &state);
+            Arvida::RDF::Node node = Arvida::RDF::Node::make_uri_node(PATH);
+            Arvida::RDF::toRDF(ctx, node, value);
+        }
+        decoded = graph.decode(encoder.buffer());
+    }
+};
+
+void testRoundTrip()
+{
+    Encoded encoded(makePolyline());
+    ARVIDA_CHECK(encoded.decoded);
+
+    Arvida::RDF::Context ctx(encoded.graph, PATH, 0, 0, &encoded.state);
+    Arvida::RDF::Node node = Arvida::RDF::Node::make_uri_node(PATH);
+    Polyline value;
+    ARVIDA_CHECK(Arvida::RDF::fromRDF(ctx, node, value));
+    ARVIDA_CHECK(value.getName() == "a");
+    ARVIDA_CHECK(value.getVertices() == makePolyline().getVertices());
+    ARVIDA_CHECK(value.getCorners() == makePolyline().getCorners());
+    ARVIDA_CHECK(value.getWeights() == makePolyline().getWeights());
+}
+
+// Containers referenced by $that are written as core:Container node
+void testContainer()
+{
+    Encoded encoded(makePolyline());
+    ARVIDA_CHECK(encoded.decoded);
+
+    Arvida::RDF::Context ctx(encoded.graph, PATH, 0, 0, &encoded.state);
+    const Arvida::RDF::Triple corners = Arvida::RDF::find_triple(
+        ctx, Arvida::RDF::Node::make_uri_node(PATH), Arvida::RDF::Node::make_uri_node(CORNERS), Arvida::RDF::Node());
+    ARVIDA_CHECK(corners.is_valid());
+
+    std::vector<Point> points;
+    Arvida::RDF::TripleRange members(ctx, corners.object, Arvida::RDF::Node::make_uri_node(MEMBER), Arvida::RDF::Node());
+    for (auto it = members.begin(); it != members.end(); ++it)
+    {
+        Point point;
+        Arvida::RDF::Node element = it->get_object();
+        ARVIDA_CHECK(Arvida::RDF::fromRDF(ctx, element, point));
+        points.push_back(point);
+    }
+    ARVIDA_CHECK(points == makePolyline().getCorners());
+}
+
+// Packed literals of another element type are not read
+void testPackedDatatype()
+{
+    Encoded encoded(makePolyline());
+    ARVIDA_CHECK(encoded.decoded);
+
+    Arvida::RDF::Context ctx(encoded.graph, PATH, 0, 0, &encoded.state);
+    const Arvida::RDF::Triple weights = Arvida::RDF::find_triple(
+        ctx, Arvida::RDF::Node::make_uri_node(PATH),
+        Arvida::RDF::Node::make_uri_node("http://vocab.arvida.de/2015/06/spatial/weights"), Arvida::RDF::Node());
+    ARVIDA_CHECK(weights.is_valid());
+    std::vector<float> floats;
+    ARVIDA_CHECK(!Arvida::RDF::packedFromRDF(ctx, weights.object, floats));
+    std::vector<double> doubles;
+    ARVIDA_CHECK(Arvida::RDF::packedFromRDF(ctx, weights.object, doubles) && doubles.size() == 3);
+}
+
+// Nodes of a previous document of the same Graph are looked up by value
+void testNodesOfPreviousDocument()
+{
+    Encoded encoded(makePolyline());
+    ARVIDA_CHECK(encoded.decoded);
+    const Arvida::RDF::Node path = Arvida::RDF::Node::make_uri_node(PATH);
+    const uint32_t index = encoded.graph.find_term(path);
+    ARVIDA_CHECK(index != Arvida::RDF::Graph::NO_TERM);
+    if (index == Arvida::RDF::Graph::NO_TERM)
+        return;
+    const Arvida::RDF::Node decoded = encoded.graph.terms()[index];
+
+    // The second document has its terms in another order and does not contain PATH
+    Arvida::RDF::Encoder encoder;
+    {
+        Arvida::RDF::Context ctx(encoder, OTHER_PATH, 0, 0, &encoded.state);
+        Arvida::RDF::Node node = Arvida::RDF::Node::make_uri_node(OTHER_PATH);
+        Polyline other = makePolyline();
+        other.setVertices({Point(7, 8)});
+        Arvida::RDF::toRDF(ctx, node, other);
+    }
+    ARVIDA_CHECK(encoded.graph.decode(encoder.buffer()));
+    ARVIDA_CHECK(encoded.graph.find_term(decoded) == Arvida::RDF::Graph::NO_TERM);
+    const uint32_t other = encoded.graph.find_term(Arvida::RDF::Node::make_uri_node(OTHER_PATH));
+    ARVIDA_CHECK(other != Arvida::RDF::Graph::NO_TERM);
+    if (other != Arvida::RDF::Graph::NO_TERM)
+        ARVIDA_CHECK(encoded.graph.terms()[other] != decoded);
+}
+
+// Only literals are read into strings
+void testStringFromNonLiteral()
+{
+    Encoded encoded(makePolyline());
+    ARVIDA_CHECK(encoded.decoded);
+    Arvida::RDF::Context ctx(encoded.graph, PATH, 0, 0, &encoded.state);
+    std::string value = "unchanged";
+    Arvida::RDF::Node uri = Arvida::RDF::Node::make_uri_node(PATH);
+    ARVIDA_CHECK(!Arvida::RDF::fromRDF(ctx, uri, value));
+    Arvida::RDF::Node blank = Arvida::RDF::Node::make_blank_node("b0");
+    ARVIDA_CHECK(!Arvida::RDF::fromRDF(ctx, blank, value));
+    Arvida::RDF::Node invalid;
+    ARVIDA_CHECK(!Arvida::RDF::fromRDF(ctx, invalid, value));
+    ARVIDA_CHECK(value == "unchanged");
+}
+
+// Copies of a root context keep the state it owns
+void testCopyOfRootContext()
+{
+    Arvida::RDF::Encoder encoder;
+    std::unique_ptr<Arvida::RDF::Context> copy;
+    {
+        Arvida::RDF::Context ctx(encoder, PATH);
+        copy.reset(new Arvida::RDF::Context(ctx));
+    }
+    Arvida::RDF::Node node = Arvida::RDF::Node::make_uri_node(PATH);
+    Arvida::RDF::toRDF(*copy, node, Point(1, 2));
+    Arvida::RDF::Graph graph;
+    ARVIDA_CHECK(graph.decode(encoder.buffer()));
+    ARVIDA_CHECK(graph.find_term(node) != Arvida::RDF::Graph::NO_TERM);
+}
+
+} // namespace
+
+int main()
+{
+    return Arvida::Test::run({
+        {"round trip", &testRoundTrip},
+        {"container", &testContainer},
+        {"packed datatype", &testPackedDatatype},
+        {"nodes of previous document", &testNodesOfPreviousDocument},
+        {"string from non-literal", &testStringFromNonLiteral},
+        {"copy of root context", &testCopyOfRootContext},
+    });
+}
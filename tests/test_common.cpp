@@ -0,0 +1,345 @@
+/*  ARVIDAPP - ARVIDA C++ Preprocessor
+ *
+ *  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Parts of RDFTraitsCommon.hpp that need neither generated code nor an RDF library
+
+#include "RDFTraitsCommon.hpp"
+#include "TestHarness.hpp"
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+
+template <class T>
+bool parse(const std::string &literal, T &value)
+{
+    return Arvida::RDF::parseNumericLiteral(literal.data(), literal.data() + literal.size(), value);
+}
+
+template <class T>
+std::string format(T value)
+{
+    char buffer[Arvida::RDF::NUMERIC_LITERAL_BUFFER_SIZE];
+    return std::string(buffer, Arvida::RDF::formatNumericLiteral(buffer, value));
+}
+
+// Adds one to the magnitude of a decimal integer literal
+std::string nextMagnitude(std::string literal)
+{
+    size_t i = literal.size();
+    while (i > 0 && literal[i - 1] == '9')
+        literal[--i] = '0';
+    if (i == 0 || literal[i - 1] == '-')
+        literal.insert(i, 1, '1');
+    else
+        ++literal[i - 1];
+    return literal;
+}
+
+template <class T>
+void checkIntegerLimits()
+{
+    T value = 7;
+    ARVIDA_CHECK(parse(format(std::numeric_limits<T>::max()), value) && value == std::numeric_limits<T>::max());
+    ARVIDA_CHECK(parse(format(std::numeric_limits<T>::min()), value) && value == std::numeric_limits<T>::min());
+
+    value = 7;
+    ARVIDA_CHECK(!parse(nextMagnitude(format(std::numeric_limits<T>::max())), value));
+    if (std::is_signed<T>::value)
+        ARVIDA_CHECK(!parse(nextMagnitude(format(std::numeric_limits<T>::min())), value));
+    ARVIDA_CHECK(value == 7);
+}
+
+template <class T>
+void checkUnsignedNegative()
+{
+    T value = 7;
+    ARVIDA_CHECK(!parse("-1", value));
+    ARVIDA_CHECK(!parse(" -1 ", value));
+    ARVIDA_CHECK(!parse("-" + format(std::numeric_limits<T>::max()), value));
+    ARVIDA_CHECK(value == 7);
+    ARVIDA_CHECK(parse("-0", value) && value == 0);
+}
+
+void testNegativeIntoUnsigned()
+{
+    checkUnsignedNegative<unsigned char>();
+    checkUnsignedNegative<unsigned short>();
+    checkUnsignedNegative<unsigned int>();
+    checkUnsignedNegative<unsigned long>();
+    checkUnsignedNegative<unsigned long long>();
+}
+
+void testIntegerLimits()
+{
+    checkIntegerLimits<signed char>();
+    checkIntegerLimits<unsigned char>();
+    checkIntegerLimits<std::int16_t>();
+    checkIntegerLimits<std::uint16_t>();
+    checkIntegerLimits<std::int32_t>();
+    checkIntegerLimits<std::uint32_t>();
+    checkIntegerLimits<std::int64_t>();
+    checkIntegerLimits<std::uint64_t>();
+
+    std::int64_t value = 7;
+    ARVIDA_CHECK(!parse("9223372036854775808", value));
+    ARVIDA_CHECK(!parse("-9223372036854775809", value));
+    ARVIDA_CHECK(!parse("99999999999999999999", value));
+    ARVIDA_CHECK(value == 7);
+    std::uint64_t unsignedValue = 7;
+    ARVIDA_CHECK(!parse("18446744073709551616", unsignedValue));
+    ARVIDA_CHECK(unsignedValue == 7);
+}
+
+void testIntegerSyntax()
+{
+    int value = 7;
+    ARVIDA_CHECK(!parse("", value));
+    ARVIDA_CHECK(!parse("-", value));
+    ARVIDA_CHECK(!parse("1x", value));
+    ARVIDA_CHECK(!parse("1.0", value));
+    ARVIDA_CHECK(value == 7);
+    ARVIDA_CHECK(parse(" +42\n", value) && value == 42);
+}
+
+void testFloatingPointLimits()
+{
+    double value = 7;
+    ARVIDA_CHECK(parse(format(std::numeric_limits<double>::max()), value) && value == std::numeric_limits<double>::max());
+    ARVIDA_CHECK(parse(format(std::numeric_limits<double>::lowest()), value) && value == std::numeric_limits<double>::lowest());
+    value = 7;
+    ARVIDA_CHECK(!parse("1e309", value));
+    ARVIDA_CHECK(!parse("-1e309", value));
+    ARVIDA_CHECK(value == 7);
+    ARVIDA_CHECK(parse("INF", value) && value == std::numeric_limits<double>::infinity());
+
+    float single = 7;
+    ARVIDA_CHECK(parse(format(std::numeric_limits<float>::max()), single) && single == std::numeric_limits<float>::max());
+    single = 7;
+    ARVIDA_CHECK(!parse("3.5e38", single));
+    ARVIDA_CHECK(!parse("0x1p3", single));
+    ARVIDA_CHECK(single == 7);
+}
+
+void testFloatingPointRoundTrip()
+{
+    const double doubles[] = {0.1, 1.0 / 3.0, -2.5e-300, 123456789.123456789};
+    for (double expected : doubles)
+    {
+        double value = 0;
+        ARVIDA_CHECK(parse(format(expected), value) && value == expected);
+    }
+    const float floats[] = {0.1f, 1.0f / 3.0f, -2.5e-30f};
+    for (float expected : floats)
+    {
+        float value = 0;
+        ARVIDA_CHECK(parse(format(expected), value) && value == expected);
+    }
+}
+
+// Each object is in exactly one shard and each shard is finished once on the calling thread
+void testRunShards()
+{
+    const size_t count = 103;
+    for (size_t num_workers = 1; num_workers <= 4; ++num_workers)
+    {
+        const size_t num_shards = Arvida::RDF::batchShardCount(count, num_workers);
+        std::vector<int> objects(count, 0);
+        std::vector<int> shards(num_shards, 0);
+        std::vector<int> finished(num_shards, 0);
+        const std::thread::id caller = std::this_thread::get_id();
+        bool on_caller = true;
+        Arvida::RDF::runShards(count, num_workers, num_shards, [&](size_t index, size_t begin, size_t end)
+        {
+            ++shards[index];
+            for (size_t i = begin; i != end; ++i)
+                ++objects[i];
+        },
+        [&](size_t index)
+        {
+            ++finished[index];
+            on_caller = on_caller && std::this_thread::get_id() == caller;
+        });
+        ARVIDA_CHECK(std::vector<int>(count, 1) == objects);
+        ARVIDA_CHECK(std::vector<int>(num_shards, 1) == shards);
+        ARVIDA_CHECK(std::vector<int>(num_shards, 1) == finished);
+        ARVIDA_CHECK(on_caller);
+    }
+    ARVIDA_CHECK(Arvida::RDF::batchShardCount(3, 4) == 3);
+    ARVIDA_CHECK(Arvida::RDF::batchShardCount(100, 1) == 1);
+}
+
+// Shards that threw are not finished, the exception is rethrown after all threads joined
+void testRunShardsErrors()
+{
+    const size_t num_shards = Arvida::RDF::batchShardCount(40, 3);
+    std::vector<int> finished(num_shards, 0);
+    bool thrown = false;
+    try
+    {
+        Arvida::RDF::runShards(40, 3, num_shards, [&](size_t index, size_t, size_t)
+        {
+            if (index == 2)
+                throw std::runtime_error("shard");
+        },
+        [&](size_t index) { ++finished[index]; });
+    }
+    catch (const std::runtime_error &e)
+    {
+        thrown = std::string(e.what()) == "shard";
+    }
+    ARVIDA_CHECK(thrown);
+    ARVIDA_CHECK(finished[2] == 0);
+    for (size_t index = 0; index != num_shards; ++index)
+        ARVIDA_CHECK(index == 2 || finished[index] == 1);
+
+    // After finished threw no further shard is finished
+    size_t calls = 0;
+    thrown = false;
+    try
+    {
+        Arvida::RDF::runShards(40, 3, num_shards, [](size_t, size_t, size_t) { },
+                               [&](size_t) { ++calls; throw std::logic_error("finished"); });
+    }
+    catch (const std::logic_error &e)
+    {
+        thrown = std::string(e.what()) == "finished";
+    }
+    ARVIDA_CHECK(thrown);
+    ARVIDA_CHECK(calls == 1);
+}
+
+// Buffer of a Pipeline that serializes its text, clear() throws when fail_clear is set
+struct TextBuffer
+{
+    std::string text;
+    bool fail_clear;
+
+    TextBuffer() : fail_clear(false) { }
+
+    void serialize(std::string &data) { data = text; }
+
+    void clear()
+    {
+        text.clear();
+        if (fail_clear)
+        {
+            fail_clear = false;
+            throw std::runtime_error("clear");
+        }
+    }
+};
+
+// The buffer is free again when the future of its submission is ready
+void testPipelineBufferFreeAfterFuture()
+{
+    std::string output;
+    Arvida::RDF::Pipeline<TextBuffer> pipeline([&output](const std::string &data) { output += data; }, 1);
+    for (int i = 0; i < 100; ++i)
+    {
+        TextBuffer &buffer = pipeline.acquire();
+        buffer.text = "x";
+        pipeline.submit(buffer).get();
+        TextBuffer *next = pipeline.tryAcquire();
+        ARVIDA_CHECK(next != 0);
+        if (next)
+            pipeline.release(*next);
+    }
+    pipeline.close();
+    ARVIDA_CHECK(output == std::string(100, 'x'));
+}
+
+// An exception of clear() fails the submission and does not stop the pipeline
+void testPipelineClearError()
+{
+    std::string output;
+    Arvida::RDF::Pipeline<TextBuffer> pipeline([&output](const std::string &data) { output += data; }, 1);
+    TextBuffer &buffer = pipeline.acquire();
+    buffer.text = "a";
+    buffer.fail_clear = true;
+    bool thrown = false;
+    try
+    {
+        pipeline.submit(buffer).get();
+    }
+    catch (const std::runtime_error &)
+    {
+        thrown = true;
+    }
+    ARVIDA_CHECK(thrown);
+
+    TextBuffer *next = pipeline.tryAcquire();
+    ARVIDA_CHECK(next != 0);
+    if (next)
+    {
+        next->text = "b";
+        pipeline.submit(*next).get();
+    }
+    pipeline.close();
+    ARVIDA_CHECK(output == "ab");
+}
+
+// close() called from a completion does not wait for the pipeline thread
+void testPipelineCloseFromCompletion()
+{
+    std::string output;
+    Arvida::RDF::Pipeline<TextBuffer> pipeline([&output](const std::string &data) { output += data; }, 2);
+    TextBuffer &first = pipeline.acquire();
+    first.text = "a";
+    std::future<void> closed = pipeline.submit(first, [&pipeline](std::exception_ptr) { pipeline.close(); });
+    closed.get();
+    pipeline.close();
+
+    TextBuffer &second = pipeline.acquire();
+    bool thrown = false;
+    try
+    {
+        pipeline.submit(second).get();
+    }
+    catch (const std::logic_error &)
+    {
+        thrown = true;
+    }
+    ARVIDA_CHECK(thrown);
+    ARVIDA_CHECK(output == "a");
+}
+
+} // namespace
+
+int main()
+{
+    return Arvida::Test::run({
+        {"negative into unsigned", &testNegativeIntoUnsigned},
+        {"integer limits", &testIntegerLimits},
+        {"integer syntax", &testIntegerSyntax},
+        {"floating point limits", &testFloatingPointLimits},
+        {"floating point round trip", &testFloatingPointRoundTrip},
+        {"run shards", &testRunShards},
+        {"run shards errors", &testRunShardsErrors},
+        {"pipeline buffer free after future", &testPipelineBufferFreeAfterFuture},
+        {"pipeline clear error", &testPipelineClearError},
+        {"pipeline close from completion", &testPipelineCloseFromCompletion},
+    });
+}
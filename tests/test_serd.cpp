@@ -0,0 +1,153 @@
+/*  ARVIDAPP - ARVIDA C++ Preprocessor
+ *
+ *  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Round trip of code generated by the serd template: objects are written to Turtle
+// with a SerdWriter and read back by the streaming Reader
+
+#include "TestModel.h"
+#include "TestModel_serd.hpp"
+#include "TestHarness.hpp"
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const std::string PATH("http://example.com/test/a");
+
+// Prefixes of the CURIE nodes of the traits, the generated vocabulary is expanded
+const char * const PREFIXES[][2] = {
+    {"rdf", "http://www.w3.org/1999/02/22-rdf-syntax-ns#"},
+    {"core", "http://vocab.arvida.de/2015/06/core/"},
+};
+
+class Env
+{
+public:
+    Env() : env_(serd_env_new(NULL))
+    {
+        for (const auto &prefix : PREFIXES)
+            serd_env_set_prefix_from_strings(env_, reinterpret_cast<const uint8_t *>(prefix[0]),
+                                             reinterpret_cast<const uint8_t *>(prefix[1]));
+    }
+
+    ~Env() { serd_env_free(env_); }
+
+    SerdEnv * get() const { return env_; }
+
+private:
+    Env(const Env &);
+    Env & operator=(const Env &);
+
+    SerdEnv *env_;
+};
+
+std::string write(const Polyline &value)
+{
+    Env env;
+    SerdChunk chunk = {NULL, 0};
+    SerdWriter *writer = serd_writer_new(SERD_TURTLE, static_cast<SerdStyle>(SERD_STYLE_ABBREVIATED | SERD_STYLE_CURIED),
+                                         env.get(), NULL, serd_chunk_sink, &chunk);
+    serd_env_foreach(env.get(), reinterpret_cast<SerdPrefixSink>(serd_writer_set_prefix), writer);
+    {
+        Arvida::RDF::Writer sink(writer);
+        Arvida::RDF::Context ctx(sink, PATH);
+        Arvida::RDF::Node node = Arvida::RDF::Node::make_uri_node(PATH);
+        Arvida::RDF::toRDF(ctx, node, value);
+    }
+    serd_writer_finish(writer);
+    serd_writer_free(writer);
+    uint8_t *data = serd_chunk_sink_finish(&chunk);
+    const std::string result(reinterpret_cast<const char *>(data));
+    std::free(data);
+    return result;
+}
+
+bool read(const std::string &document, Polyline &value, bool grouped = true)
+{
+    Arvida::RDF::Reader reader;
+    reader.set_subjects_grouped(grouped);
+    reader.bind(Arvida::RDF::Node::make_uri_node(PATH), value);
+    const bool read = reader.read_string(document) == SERD_SUCCESS;
+    reader.finish();
+    return read;
+}
+
+Polyline makePolyline()
+{
+    Polyline value;
+    value.setName("a");
+    value.setVertices({Point(1, 2), Point(3, 4.5), Point(-1e300, 0.1)});
+    value.setWeights({0.25, -1e300, 3});
+    return value;
+}
+
+void testRoundTrip()
+{
+    const std::string document = write(makePolyline());
+    Polyline value;
+    ARVIDA_CHECK(read(document, value));
+    ARVIDA_CHECK(value.getName() == "a");
+    ARVIDA_CHECK(value.getVertices() == makePolyline().getVertices());
+    ARVIDA_CHECK(value.getWeights() == makePolyline().getWeights());
+}
+
+// Statements of blank nodes that precede the statement referring to them are
+// buffered until the node is bound
+void testStatementsBeforeBinding()
+{
+    const std::string document =
+        "@prefix maths: <http://vocab.arvida.de/2015/06/maths/> .\n"
+        "@prefix vom: <http://vocab.arvida.de/2015/06/vom/> .\n"
+        "@prefix spatial: <http://vocab.arvida.de/2015/06/spatial/> .\n"
+        "_:q maths:x 5.0 ; maths:y 6.0 .\n"
+        "_:p a maths:Vector2D ; vom:quantityValue _:q .\n"
+        "<" + PATH + "> a spatial:Polyline ; spatial:vertex _:p .\n";
+    Polyline value;
+    ARVIDA_CHECK(read(document, value));
+    ARVIDA_CHECK(value.getVertices() == std::vector<Point>({Point(5, 6)}));
+}
+
+// Subjects mentioned again later are only complete in finish() when subjects are not grouped
+void testUngroupedSubjects()
+{
+    const std::string document =
+        "@prefix maths: <http://vocab.arvida.de/2015/06/maths/> .\n"
+        "@prefix vom: <http://vocab.arvida.de/2015/06/vom/> .\n"
+        "@prefix spatial: <http://vocab.arvida.de/2015/06/spatial/> .\n"
+        "@prefix core: <http://vocab.arvida.de/2015/06/core/> .\n"
+        "<" + PATH + "> spatial:vertex <" + PATH + "/p> .\n"
+        "<" + PATH + "/p> vom:quantityValue [ maths:x 1.0 ; maths:y 2.0 ] .\n"
+        "<" + PATH + "> core:name \"b\" .\n";
+    Polyline value;
+    ARVIDA_CHECK(read(document, value, false));
+    ARVIDA_CHECK(value.getName() == "b");
+    ARVIDA_CHECK(value.getVertices() == std::vector<Point>({Point(1, 2)}));
+}
+
+} // namespace
+
+int main()
+{
+    return Arvida::Test::run({
+        {"round trip", &testRoundTrip},
+        {"statements before binding", &testStatementsBeforeBinding},
+        {"ungrouped subjects", &testUngroupedSubjects},
+    });
+}
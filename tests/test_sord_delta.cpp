@@ -0,0 +1,203 @@
+/*  ARVIDAPP - ARVIDA C++ Preprocessor
+ *
+ *  Copyright (C) 2015-2019 German Research Center for Artificial Intelligence (DFKI)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// toRDFDelta of code generated by the sord template with --delta. Updates are
+// serialized with a context of an empty model and applied to a separate target
+// model, like a publisher that only sends the differences.
+
+#include "TestModel.h"
+#include "TestModel_sord_delta.hpp"
+#include "TestHarness.hpp"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const char BASE_URI[] = "http://example.com/test";
+
+class Publisher
+{
+public:
+    Publisher() : target_(world_, BASE_URI)
+    {
+        world_.add_prefix("rdf", "http://www.w3.org/1999/02/22-rdf-syntax-ns#");
+        world_.add_prefix("core", "http://vocab.arvida.de/2015/06/core/");
+    }
+
+    void update(const std::string &path, const Polyline &value)
+    {
+        Sord::Model model(world_, BASE_URI);
+        Arvida::RDF::Context ctx(model, path);
+        Sord::URI node(world_, path);
+        delta_.begin();
+        Arvida::RDF::toRDFDelta(ctx, delta_, node, value);
+        Arvida::RDF::applyDelta(target_, delta_);
+    }
+
+    bool read(const std::string &path, Polyline &value)
+    {
+        Arvida::RDF::Context ctx(target_, path);
+        Sord::URI node(world_, path);
+        return Arvida::RDF::fromRDF(ctx, node, value);
+    }
+
+    std::vector<Arvida::RDF::Triple> find(const Sord::Node &subject, const std::string &predicate = std::string())
+    {
+        return Arvida::RDF::find_triples(target_, subject,
+                                         predicate.empty() ? Sord::Node() : Sord::URI(world_, predicate),
+                                         Sord::Node());
+    }
+
+    Sord::World & world() { return world_; }
+    Sord::Model & model() { return target_; }
+
+private:
+    Sord::World world_;
+    Sord::Model target_;
+    Arvida::RDF::Delta delta_;
+};
+
+const char VERTEX[] = "http://vocab.arvida.de/2015/06/spatial/vertex";
+const char CORNERS[] = "http://vocab.arvida.de/2015/06/spatial/corners";
+const char MEMBER[] = "http://vocab.arvida.de/2015/06/core/member";
+
+bool contains(const std::vector<Point> &points, const Point &point)
+{
+    return std::find(points.begin(), points.end(), point) != points.end();
+}
+
+Polyline makePolyline(const std::string &name, const std::vector<Point> &vertices)
+{
+    Polyline value;
+    value.setName(name);
+    value.setVertices(vertices);
+    return value;
+}
+
+// Blank nodes kept in the Delta must not be reused by the root context of the next update
+void testNewBlankSubjectsOfSuccessiveUpdates()
+{
+    Publisher publisher;
+    publisher.update(BASE_URI + std::string("/a"), makePolyline("a", {Point(1, 2)}));
+    publisher.update(BASE_URI + std::string("/a"), makePolyline("a", {Point(1, 2), Point(3, 4)}));
+    publisher.update(BASE_URI + std::string("/b"), makePolyline("b", {Point(5, 6)}));
+
+    const std::vector<Arvida::RDF::Triple> a = publisher.find(Sord::URI(publisher.world(), BASE_URI + std::string("/a")), VERTEX);
+    const std::vector<Arvida::RDF::Triple> b = publisher.find(Sord::URI(publisher.world(), BASE_URI + std::string("/b")), VERTEX);
+    ARVIDA_CHECK(a.size() == 2);
+    ARVIDA_CHECK(b.size() == 1);
+    if (a.size() == 2 && b.size() == 1)
+    {
+        ARVIDA_CHECK(a[0].object.c_obj() != a[1].object.c_obj());
+        ARVIDA_CHECK(a[0].object.c_obj() != b[0].object.c_obj());
+        ARVIDA_CHECK(a[1].object.c_obj() != b[0].object.c_obj());
+    }
+
+    Polyline value;
+    ARVIDA_CHECK(publisher.read(BASE_URI + std::string("/a"), value));
+    ARVIDA_CHECK(value.getName() == "a");
+    ARVIDA_CHECK(value.getVertices().size() == 2);
+    ARVIDA_CHECK(contains(value.getVertices(), Point(1, 2)));
+    ARVIDA_CHECK(contains(value.getVertices(), Point(3, 4)));
+    ARVIDA_CHECK(publisher.read(BASE_URI + std::string("/b"), value));
+    ARVIDA_CHECK(value.getVertices() == std::vector<Point>({Point(5, 6)}));
+}
+
+// Elements removed from a $that.element member are removed with their statements
+void testRemovedElements()
+{
+    Publisher publisher;
+    const std::string path = BASE_URI + std::string("/a");
+    const Sord::URI node(publisher.world(), path);
+    publisher.update(path, makePolyline("a", {Point(1, 2), Point(3, 4)}));
+    const std::vector<Arvida::RDF::Triple> before = publisher.find(node, VERTEX);
+    ARVIDA_CHECK(before.size() == 2);
+
+    publisher.update(path, makePolyline("a", {Point(1, 2)}));
+    const std::vector<Arvida::RDF::Triple> after = publisher.find(node, VERTEX);
+    ARVIDA_CHECK(after.size() == 1);
+    for (const auto &it : before)
+    {
+        if (!after.empty() && it.object.c_obj() == after[0].object.c_obj())
+            continue;
+        ARVIDA_CHECK(publisher.find(it.object).empty());
+    }
+
+    Polyline value;
+    ARVIDA_CHECK(publisher.read(path, value));
+    ARVIDA_CHECK(value.getVertices() == std::vector<Point>({Point(1, 2)}));
+}
+
+// Containers referenced by $that emit their statements to the delta
+void testContainerDelta()
+{
+    Publisher publisher;
+    const std::string path = BASE_URI + std::string("/a");
+    const Sord::URI node(publisher.world(), path);
+    Polyline value = makePolyline("a", {Point(5, 5)});
+    value.setCorners({Point(0, 0), Point(1, 1)});
+    publisher.update(path, value);
+
+    const std::vector<Arvida::RDF::Triple> corners = publisher.find(node, CORNERS);
+    ARVIDA_CHECK(corners.size() == 1);
+    if (corners.size() != 1)
+        return;
+    const Sord::Node container = corners[0].object;
+    const std::vector<Arvida::RDF::Triple> members = publisher.find(container, MEMBER);
+    ARVIDA_CHECK(members.size() == 2);
+
+    value.setCorners({Point(0, 0), Point(2, 2)});
+    publisher.update(path, value);
+    ARVIDA_CHECK(publisher.find(container, MEMBER).size() == 2);
+
+    value.setCorners({Point(0, 0)});
+    publisher.update(path, value);
+    const std::vector<Arvida::RDF::Triple> remaining = publisher.find(container, MEMBER);
+    ARVIDA_CHECK(remaining.size() == 1);
+    for (const auto &it : members)
+    {
+        if (!remaining.empty() && it.object.c_obj() == remaining[0].object.c_obj())
+            continue;
+        ARVIDA_CHECK(publisher.find(it.object).empty());
+    }
+    if (remaining.size() == 1)
+    {
+        Point corner;
+        Arvida::RDF::Context ctx(publisher.model(), path);
+        Sord::Node cornerNode = remaining[0].object;
+        ARVIDA_CHECK(Arvida::RDF::fromRDF(ctx, cornerNode, corner));
+        ARVIDA_CHECK(corner == Point(0, 0));
+    }
+
+    Polyline read;
+    ARVIDA_CHECK(publisher.read(path, read));
+    ARVIDA_CHECK(read.getCorners() == std::vector<Point>({Point(0, 0)}));
+}
+
+} // namespace
+
+int main()
+{
+    return Arvida::Test::run({
+        {"new blank subjects of successive updates", &testNewBlankSubjectsOfSuccessiveUpdates},
+        {"removed elements", &testRemovedElements},
+        {"container delta", &testContainerDelta},
+    });
+}